@@ -110,6 +110,18 @@ CREATE TABLE IF NOT EXISTS Folder_Aliases (
 );
 CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_name ON Folder_Aliases(name);
 CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_alias ON Folder_Aliases(alias);
+
+-- lower(name)/lower(alias) lookups used by `nls db --show-*`
+CREATE INDEX IF NOT EXISTS IX_Files_lower_name ON Files(lower(name));
+CREATE INDEX IF NOT EXISTS IX_Folders_lower_name ON Folders(lower(name));
+CREATE INDEX IF NOT EXISTS IX_File_Aliases_lower_name ON File_Aliases(lower(name));
+CREATE INDEX IF NOT EXISTS IX_File_Aliases_lower_alias ON File_Aliases(lower(alias));
+CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_lower_name ON Folder_Aliases(lower(name));
+CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_lower_alias ON Folder_Aliases(lower(alias));
+
+-- Full-text index for `nls db --search` (rebuilt after loading)
+CREATE VIRTUAL TABLE IF NOT EXISTS Files_fts USING fts5(name, description, used_by, content='Files', content_rowid='id');
+CREATE VIRTUAL TABLE IF NOT EXISTS Folders_fts USING fts5(name, description, used_by, content='Folders', content_rowid='id');
 """
 
 def load_yaml(path):
@@ -283,6 +295,8 @@ def main():
                          Icon_Hex_Code=excluded.Icon_Hex_Code
                     """,
                     (fid, ext, desc, used, icon if isinstance(icon, str) else None, icon_class, cp, cphex))
+    cur.execute("INSERT INTO Files_fts(Files_fts) VALUES ('rebuild')")
+    cur.execute("INSERT INTO Folders_fts(Folders_fts) VALUES ('rebuild')")
     conn.commit()
     conn.close()
 
@@ -10,6 +10,7 @@
 #include "git_status.h"
 #include "renderer.h"
 #include "symlink_resolver.h"
+#include "xattr_resolver.h"
 
 namespace nls {
 
@@ -23,11 +24,13 @@ private:
     Renderer& renderer() { return *renderer_; }
 
     int runDatabaseCommand(Config::DbAction action);
+    int runPromptSummary();
 
     CommandLineParser parser_{};
     Config* config_{nullptr};
     FileOwnershipResolver ownership_resolver_{};
     SymlinkResolver symlink_resolver_{};
+    XattrResolver xattr_resolver_{};
     GitStatus git_status_{};
     std::unique_ptr<FileScanner> scanner_{};
     std::unique_ptr<Renderer> renderer_{};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+
+namespace nls {
+
+// Process-wide stop request, raised once standard output can no longer be
+// written: the reader of a pipe exited (`nls -R / | head`), the disk filled
+// up, or a write failed for any other reason. Traversal loops and worker
+// pools poll Requested() and unwind without doing more work, so an early
+// exiting consumer costs only the output it actually read.
+class Cancellation {
+public:
+    // A relaxed load, cheap enough for per-entry loops on any thread.
+    [[nodiscard]] static bool Requested() noexcept { return requested_.load(std::memory_order_relaxed); }
+    static void Request() noexcept { requested_.store(true, std::memory_order_relaxed); }
+
+    // Ignores SIGPIPE so a closed pipe surfaces as a failed write the run
+    // can shut down from, instead of killing the process mid-scan.
+    static void InterceptBrokenPipe();
+
+    // Checks standard output for a failed write and, when it is a pipe, for
+    // a reader that has gone away even though nothing was flushed yet. The
+    // pipe is polled at most every few milliseconds, so this is called once
+    // per directory. Returns false, and requests cancellation, once output
+    // has failed.
+    static bool CheckOutput();
+
+    // Flushes standard output and turns a write failure into the exit
+    // status: a broken pipe ends the process through SIGPIPE when that was
+    // its inherited disposition, as if the signal had never been caught;
+    // other errors are reported and exit with 2. Returns rc otherwise.
+    [[nodiscard]] static int Finish(int rc);
+
+private:
+    inline static std::atomic<bool> requested_{false};
+};
+
+}  // namespace nls
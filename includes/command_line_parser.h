@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <string>
 #include <optional>
@@ -27,6 +28,7 @@ private:
     bool MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintmax_t& result) const;
     bool PowWithOverflow(uintmax_t base, unsigned exponent, uintmax_t& result) const;
     std::optional<SizeSpec> ParseSizeSpec(const std::string& text) const;
+    std::optional<std::chrono::milliseconds> ParseDuration(const std::string& text) const;
 };
 
 } // namespace nls
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
@@ -21,8 +22,10 @@ public:
     enum class IndicatorStyle { None, Slash };
     enum class ColorMode { Auto, Always, Never };
     enum class ColorTheme { Default, Light, Dark };
-    enum class Sort { Name, Time, Size, Extension, None };
+    enum class Sort { Name, Time, Size, Extension, Version, None };
+    enum class Collate { Ascii, Locale };
     enum class Report { None, Short, Long };
+    enum class HashAlgorithm { None, Xxh3, Sha256 };
     enum class QuotingStyle {
         Literal,
         Locale,
@@ -68,6 +71,9 @@ public:
     Sort sort() const;
     void set_sort(Sort value);
 
+    Collate collate() const;
+    void set_collate(Collate value);
+
     Report report() const;
     void set_report(Report value);
 
@@ -83,6 +89,27 @@ public:
     bool git_status() const;
     void set_git_status(bool value);
 
+    bool git_diffstat() const;
+    void set_git_diffstat(bool value);
+
+    std::size_t git_jobs() const;
+    void set_git_jobs(std::size_t value);
+
+    bool prompt_summary() const;
+    void set_prompt_summary(bool value);
+
+    bool prompt_cache() const;
+    void set_prompt_cache(bool value);
+
+    bool progress() const;
+    void set_progress(bool value);
+
+    bool background() const;
+    void set_background(bool value);
+
+    std::uint64_t max_ops_per_sec() const;
+    void set_max_ops_per_sec(std::uint64_t value);
+
     bool group_dirs_first() const;
     void set_group_dirs_first(bool value);
 
@@ -149,6 +176,15 @@ public:
     bool show_block_size() const;
     void set_show_block_size(bool value);
 
+    bool sniff() const;
+    void set_sniff(bool value);
+
+    HashAlgorithm hash_algorithm() const;
+    void set_hash_algorithm(HashAlgorithm value);
+
+    bool dupes() const;
+    void set_dupes(bool value);
+
     bool perf_logging() const;
     void set_perf_logging(bool value);
 
@@ -176,6 +212,9 @@ public:
     const DbAliasEntry& db_alias_entry() const;
     void set_db_alias_entry(DbAliasEntry value);
 
+    const std::string& db_search() const;
+    void set_db_search(std::string value);
+
     const std::optional<std::string>& theme_name() const;
     void set_theme_name(std::optional<std::string> value);
 
@@ -187,6 +226,42 @@ public:
     void set_output_width(std::optional<int> value);
     void clear_output_width();
 
+    const std::optional<uintmax_t>& memory_limit() const;
+    void set_memory_limit(std::optional<uintmax_t> value);
+    void clear_memory_limit();
+
+    // Slice of a recursive listing handled by this process (--shard=I/N);
+    // index is zero-based.
+    struct Shard {
+        std::size_t index = 0;
+        std::size_t count = 1;
+    };
+
+    const std::optional<Shard>& shard() const;
+    void set_shard(std::optional<Shard> value);
+    void clear_shard();
+
+    std::size_t shard_depth() const;
+    void set_shard_depth(std::size_t value);
+
+    // File that -R periodically saves its traversal state to (--checkpoint).
+    const std::string& checkpoint_file() const;
+    void set_checkpoint_file(std::string value);
+
+    bool resume() const;
+    void set_resume(bool value);
+
+    bool one_file_system() const;
+    void set_one_file_system(bool value);
+
+    // File system types -R and --tree do not descend into (--skip-fs).
+    const std::vector<std::string>& skip_fs() const;
+    void set_skip_fs(std::vector<std::string> value);
+
+    const std::optional<std::chrono::milliseconds>& stat_timeout() const;
+    void set_stat_timeout(std::optional<std::chrono::milliseconds> value);
+    void clear_stat_timeout();
+
     const std::string& time_style() const;
     void set_time_style(std::string value);
 
@@ -225,12 +300,20 @@ private:
     ColorMode color_mode_ = ColorMode::Auto;
     ColorTheme color_theme_ = ColorTheme::Default;
     Sort sort_ = Sort::Name;
+    Collate collate_ = Collate::Ascii;
     Report report_ = Report::None;
     QuotingStyle quoting_style_ = QuotingStyle::Literal;
 
     bool all_ = false;
     bool almost_all_ = false;
     bool git_status_ = false;
+    bool git_diffstat_ = false;
+    std::size_t git_jobs_ = 0;
+    bool prompt_summary_ = false;
+    bool prompt_cache_ = false;
+    bool progress_ = false;
+    bool background_ = false;
+    std::uint64_t max_ops_per_sec_ = 0;
     bool group_dirs_first_ = false;
     bool sort_files_first_ = false;
     bool dots_first_ = false;
@@ -253,15 +336,27 @@ private:
     bool hide_control_chars_ = false;
     bool zero_terminate_ = false;
     bool show_block_size_ = false;
+    bool sniff_ = false;
+    HashAlgorithm hash_algorithm_ = HashAlgorithm::None;
+    bool dupes_ = false;
     bool perf_logging_ = false;
     DbAction db_action_ = DbAction::None;
     DbIconEntry db_icon_entry_{};
     DbAliasEntry db_alias_entry_{};
+    std::string db_search_{};
 
     std::optional<std::string> theme_name_{};
 
     std::optional<std::size_t> tree_depth_;
     std::optional<int> output_width_;
+    std::optional<uintmax_t> memory_limit_;
+    std::optional<std::chrono::milliseconds> stat_timeout_;
+    std::optional<Shard> shard_;
+    std::size_t shard_depth_ = 1;
+    std::string checkpoint_file_;
+    bool resume_ = false;
+    bool one_file_system_ = false;
+    std::vector<std::string> skip_fs_;
 
     std::string time_style_;
     std::vector<std::string> hide_patterns_;
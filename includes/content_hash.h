@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "fs_scanner.h"
+
+namespace nls {
+
+// Computes content hashes for --hash/--dupes. Files are read sequentially
+// in large blocks on a few threads, and digests are remembered on disk keyed
+// by (device, inode, size, mtime) so unchanged files are never read twice.
+// The cache file is rewritten whole, without digests of files that have
+// changed since and capped at a fixed number of records.
+class ContentHasher {
+public:
+    ContentHasher(Config::HashAlgorithm algorithm, std::filesystem::path cache_file);
+    ~ContentHasher();
+
+    ContentHasher(const ContentHasher&) = delete;
+    ContentHasher& operator=(const ContentHasher&) = delete;
+
+    // Fills FileInfo::content_hash for the regular files in entries. With
+    // only_size_collisions, files whose size no other entry shares are
+    // skipped since they cannot have a duplicate.
+    void HashEntries(std::vector<Entry>& entries, bool only_size_collisions);
+
+    // Default cache location under the user configuration directory.
+    [[nodiscard]] static std::filesystem::path DefaultCacheFile();
+
+private:
+    struct FileKey {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::uint64_t size = 0;
+        std::int64_t mtime_ns = 0;
+        bool operator==(const FileKey&) const = default;
+    };
+
+    struct FileKeyHash {
+        [[nodiscard]] std::size_t operator()(const FileKey& key) const noexcept {
+            std::size_t seed = std::hash<std::uint64_t>{}(key.inode);
+            seed ^= std::hash<std::uint64_t>{}(key.device) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            seed ^= std::hash<std::uint64_t>{}(key.size) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            seed ^= std::hash<std::int64_t>{}(key.mtime_ns) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    // Builds the cache key from the metadata the scan already read.
+    [[nodiscard]] static bool KeyFor(const FileInfo& info, FileKey& key);
+    [[nodiscard]] const char* AlgorithmName() const noexcept;
+    void LoadCache();
+    void SaveCache();
+    void Remember(const FileKey& key, std::string digest);
+
+    Config::HashAlgorithm algorithm_;
+    std::filesystem::path cache_file_;
+    bool cache_loaded_ = false;
+    // Set when the file on disk no longer matches what SaveCache would write.
+    bool cache_dirty_ = false;
+    std::unordered_map<FileKey, std::string, FileKeyHash> cache_;
+    // Newest key seen for each (device, inode), with size and mtime zeroed
+    // in the map key.
+    std::unordered_map<FileKey, FileKey, FileKeyHash> latest_;
+    // Keys oldest first; a key is appended again when it is used, so the
+    // records that are dropped first are those not used for longest.
+    std::vector<FileKey> order_;
+    // Records of the other algorithm, kept as they were read.
+    std::vector<std::string> foreign_lines_;
+};
+
+}  // namespace nls
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace nls {
+
+// Icon keys for a file recognised by its leading bytes. fallback is tried
+// when the active theme has no icon for key.
+struct SniffResult {
+    std::string_view key;
+    std::string_view fallback;
+
+    [[nodiscard]] bool matched() const noexcept { return !key.empty(); }
+};
+
+// Classifies files without a recognised name or extension (--sniff) by
+// matching the first kHeadBytes bytes against a fixed table of magic
+// signatures.
+class ContentSniffer {
+public:
+    static constexpr std::size_t kHeadBytes = 512;
+
+    [[nodiscard]] static SniffResult Classify(std::string_view head) noexcept;
+
+    // Reads and classifies every path, spreading the reads over a few
+    // threads for large batches. Unreadable files yield an unmatched result.
+    [[nodiscard]] static std::vector<SniffResult> ClassifyFiles(const std::vector<std::filesystem::path>& paths);
+
+private:
+    [[nodiscard]] static SniffResult ClassifyShebang(std::string_view head) noexcept;
+    [[nodiscard]] static std::size_t ReadHead(const std::filesystem::path& path, char* buffer) noexcept;
+};
+
+}  // namespace nls
@@ -5,7 +5,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <sqlite3.h>
@@ -21,59 +21,38 @@ public:
     explicit DatabaseInspector(std::vector<std::filesystem::path> candidates);
     int Execute(Config::DbAction action,
                 const Config::DbIconEntry& icon_entry,
-                const Config::DbAliasEntry& alias_entry);
+                const Config::DbAliasEntry& alias_entry,
+                std::string_view search = {});
 
 private:
-    struct IconRecord {
-        std::string name;
-        std::string icon;
-        std::string icon_class;
-        std::optional<std::uint32_t> icon_utf16;
-        std::optional<std::uint32_t> icon_hex;
-        std::string description;
-        std::string used_by;
+    // One configuration database attached to the merged view, in priority
+    // order (the first source overrides later ones).
+    struct Source {
+        std::string schema;
+        std::filesystem::path path;
+        std::unordered_set<std::string> tables;
     };
 
-    struct AliasRecord {
-        std::string alias;
-        std::string target_name;
-        std::string target_key;
-    };
-
-    struct AliasPresentation {
-        std::string name;
-        std::string alias;
-        std::string icon;
-        std::string icon_class;
-        std::optional<std::uint32_t> icon_utf16;
-        std::optional<std::uint32_t> icon_hex;
-        std::string description;
-        std::string used_by;
-        bool missing_target = false;
-    };
-
-    using IconMap = std::unordered_map<std::string, IconRecord>;
-    using AliasMap = std::unordered_map<std::string, AliasRecord>;
-
     enum class IconTarget { Files, Folders };
     enum class AliasTarget { Files, Folders };
 
-    [[nodiscard]] bool EnsureLoaded();
-    [[nodiscard]] bool LoadAllSources();
-    [[nodiscard]] bool LoadSingleSource(const std::filesystem::path& path);
+    [[nodiscard]] bool EnsureOpened();
+    [[nodiscard]] bool OpenSources();
+    [[nodiscard]] bool AttachSource(const std::filesystem::path& path);
+    [[nodiscard]] bool HasSourceWith(std::string_view table) const;
+    void WarnMissingTable(std::string_view table) const;
 
     [[nodiscard]] static std::vector<std::filesystem::path>
         FilterReadable(std::vector<std::filesystem::path> paths);
 
     [[nodiscard]] static std::unique_ptr<sqlite3, void(*)(sqlite3*)>
         OpenDatabase(const std::filesystem::path& path, int flags, std::string& error);
-    [[nodiscard]] static std::optional<std::string>
-        LoadIconTable(sqlite3* db, std::string_view sql, IconMap& target);
-    [[nodiscard]] static std::optional<std::string>
-        LoadAliasTable(sqlite3* db, std::string_view sql, AliasMap& target);
+    [[nodiscard]] static std::optional<std::unordered_set<std::string>>
+        ReadTableNames(sqlite3* db, std::string_view schema);
 
     [[nodiscard]] static bool IsElevated();
     [[nodiscard]] static bool EnsureSchema(sqlite3* db);
+    [[nodiscard]] static bool EnsureSearchIndex(sqlite3* db, std::string_view table);
     [[nodiscard]] static bool ExecuteSimple(sqlite3* db, std::string_view sql);
     [[nodiscard]] static std::optional<std::uint32_t> ParseUnicode(std::string_view text);
     [[nodiscard]] static std::optional<std::uint32_t> ParseHex(std::string_view text);
@@ -89,17 +68,27 @@ private:
     [[nodiscard]] static std::string FormatUtf16(std::optional<std::uint32_t> code);
     [[nodiscard]] static std::string FormatHex(std::optional<std::uint32_t> code);
 
-    void PrintIcons(const IconMap& icons, std::string_view filter) const;
-    void PrintAliases(const AliasMap& aliases,
-                      const IconMap& icons,
-                      std::string_view filter) const;
+    [[nodiscard]] std::string ShadowFilter(std::size_t index,
+                                           std::string_view table,
+                                           std::string_view column) const;
+    [[nodiscard]] std::string BuildIconQuery(std::string_view table,
+                                             std::string_view filter,
+                                             std::string_view search) const;
+    [[nodiscard]] std::string BuildAliasQuery(std::string_view table,
+                                              std::string_view icon_table,
+                                              std::string_view filter) const;
+
+    [[nodiscard]] int PrintIcons(std::string_view table,
+                                 std::string_view filter,
+                                 std::string_view search) const;
+    [[nodiscard]] int PrintAliases(std::string_view table,
+                                   std::string_view icon_table,
+                                   std::string_view filter) const;
 
     std::vector<std::filesystem::path> candidates_;
-    IconMap files_;
-    IconMap folders_;
-    AliasMap file_aliases_;
-    AliasMap folder_aliases_;
-    bool loaded_ = false;
+    std::unique_ptr<sqlite3, void(*)(sqlite3*)> view_{nullptr, nullptr};
+    std::vector<Source> sources_;
+    bool opened_ = false;
     bool had_error_ = false;
     std::string last_error_;
     mutable std::filesystem::path writable_cache_{};
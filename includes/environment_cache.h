@@ -0,0 +1,54 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace nls {
+
+// Remembers the search directories ResourceManager resolved at startup for
+// the current terminal session, so scripts that run nls in a loop skip
+// canonicalising a dozen candidate paths on every invocation. Which of those
+// directories hold a database is still checked live, one stat each.
+class EnvironmentCache {
+public:
+    struct Snapshot {
+        std::vector<std::filesystem::path> directories;
+        std::filesystem::path user_config_dir;
+        std::filesystem::path env_override_dir;
+    };
+
+    EnvironmentCache(std::filesystem::path file, std::string key);
+
+    // Identifies what resolution depends on: the terminal (device and
+    // $TERM), the working directory, how nls was invoked and the variables
+    // that name configuration directories.
+    [[nodiscard]] static std::string SessionKey(const char* argv0, const std::filesystem::path& cwd);
+
+    // Cache location next to the other per-user caches, derived from $HOME
+    // (%APPDATA% on Windows) without touching the file system. Empty unless
+    // NLS_ENV_CACHE=1 enables the cache and a home directory is known.
+    [[nodiscard]] static std::filesystem::path DefaultFile();
+
+    // Fills snapshot from a record for this session that is younger than an
+    // hour, the bound on how long a retargeted symlink can go unnoticed.
+    [[nodiscard]] bool Load(Snapshot& snapshot);
+    // Adds or replaces this session's record, keeping the most recent few.
+    void Store(const Snapshot& snapshot);
+
+private:
+    struct Record {
+        std::string key;
+        long long saved = 0;
+        Snapshot snapshot;
+    };
+
+    void ReadRecords();
+
+    std::filesystem::path file_;
+    std::string key_;
+    bool loaded_ = false;
+    std::vector<Record> records_;
+};
+
+}  // namespace nls
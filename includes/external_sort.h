@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fs_scanner.h"
+#include "name_store.h"
+
+namespace nls {
+
+// Bounded-memory sorter for very large listings. Entries are buffered until
+// their estimated footprint exceeds the budget; each full buffer is sorted
+// and stored as one run. Merge() then replays all runs in order through a
+// k-way merge, so peak memory stays near the budget plus what each run keeps
+// resident: a read buffer for a spilled run, the packed bytes otherwise.
+class ExternalEntrySorter {
+public:
+    // The front record of one run during Merge(), with the key SetMergeKey
+    // derived from it when it got there.
+    struct MergeHead {
+        Entry entry;
+        std::string key;
+    };
+
+    using RunSorter = std::function<void(std::vector<Entry>&)>;
+    using HeadLess = std::function<bool(const MergeHead&, const MergeHead&)>;
+    using MergeKey = std::function<std::string(const Entry&)>;
+    using BatchSink = std::function<void(std::vector<Entry>&)>;
+    using RunObserver = std::function<void(const std::vector<Entry>&)>;
+
+    enum class Storage {
+        // Runs go to an anonymous temporary file and are read back through
+        // one buffer each (--memory-limit).
+        TemporaryFile,
+        // Runs stay in memory as packed records with front-coded names and
+        // paths, a fraction of the size of the Entry objects they replace.
+        Packed,
+    };
+
+    // sort_run must produce the same order as less (with equal entries kept
+    // in arrival order, or reversed when reverse_ties is set).
+    ExternalEntrySorter(std::uintmax_t memory_limit,
+                        Storage storage,
+                        RunSorter sort_run,
+                        HeadLess less,
+                        bool reverse_ties);
+    ~ExternalEntrySorter();
+
+    ExternalEntrySorter(const ExternalEntrySorter&) = delete;
+    ExternalEntrySorter& operator=(const ExternalEntrySorter&) = delete;
+
+    void Add(Entry entry);
+
+    // Shown every sorted run once, before it is stored or, for the unspilled
+    // tail, merged; lets callers gather column widths only for listings that
+    // actually spill.
+    void SetRunObserver(RunObserver observer) { observer_ = std::move(observer); }
+
+    // Derives a key once per record as it becomes the head of its run, for
+    // orders that are costly to recompute on every heap comparison (version
+    // sort tokenises names). Without one, MergeHead::key stays empty.
+    void SetMergeKey(MergeKey key) { merge_key_ = std::move(key); }
+
+    [[nodiscard]] bool spilled() const noexcept { return !runs_.empty() || !packed_runs_.empty(); }
+    // True once a run could not be written to the temporary file. That run
+    // and every later one are packed in memory instead, so the listing is
+    // still complete but no longer held to the memory budget.
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+    [[nodiscard]] std::vector<Entry> TakeBuffered();
+
+    // Emits the merged listing in batches of at most batch_size entries.
+    // Returns false when the temporary file could not be read back.
+    bool Merge(std::size_t batch_size, const BatchSink& sink);
+
+    [[nodiscard]] static std::size_t EstimateBytes(const Entry& entry) noexcept;
+
+private:
+    struct Run {
+        std::int64_t offset = 0;
+        std::size_t count = 0;
+    };
+
+    struct PackedRun {
+        // Back-to-back records holding everything but the name and path.
+        std::string records;
+        NameStore names;
+        NameStore paths;
+    };
+
+    class RunReader;
+    class PackedRunReader;
+
+    void SpillBuffer();
+    bool WriteRun();
+    void PackRun();
+
+    std::uintmax_t memory_limit_;
+    Storage storage_;
+    RunSorter sort_run_;
+    HeadLess less_;
+    bool reverse_ties_;
+    RunObserver observer_;
+    MergeKey merge_key_;
+
+    std::vector<Entry> buffer_;
+    std::uintmax_t buffered_bytes_ = 0;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_;
+    std::vector<Run> runs_;
+    std::vector<PackedRun> packed_runs_;
+    bool failed_ = false;
+};
+
+}  // namespace nls
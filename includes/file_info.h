@@ -42,6 +42,12 @@ public:
     bool has_symlink_status = false;
     std::filesystem::file_status target_status{};
     bool has_target_status = false;
+    bool stat_timed_out = false;
+    uintmax_t device = 0;
+    std::int64_t ctime_ns = 0;
+    bool is_automount = false;
+    // '+' (ACL), '.' (security context) or 0; only filled for long listings.
+    char xattr_indicator = 0;
 #ifdef _WIN32
     unsigned long nlink = 1;
     std::string owner = "";
@@ -55,6 +61,8 @@ public:
     std::string color_fg;
     std::string color_reset;
     std::string git_prefix;
+    std::string git_diffstat;
+    std::string content_hash;
 };
 
 } // namespace nls
@@ -8,10 +8,18 @@ namespace nls {
 class FileOwnershipResolver {
 private:
 #ifndef _WIN32
-    bool MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintmax_t& result) const;
+    static bool MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintmax_t& result);
 #endif
 public:
     void Populate(FileInfo& file_info, bool dereference) const;
+
+    // The two halves of Populate. ReadStat makes the lstat/stat calls and
+    // touches nothing but file_info, so stat probe workers can run it;
+    // ResolveOwners turns the ids it found into user and group names. On
+    // Windows ownership comes from the security descriptor and ResolveOwners
+    // does all of the work.
+    static void ReadStat(FileInfo& file_info, bool dereference);
+    void ResolveOwners(FileInfo& file_info, bool dereference) const;
 };
 
 } // namespace nls
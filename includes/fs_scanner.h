@@ -1,8 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
+#include <system_error>
 #include <type_traits>
 #include <vector>
 
@@ -37,28 +42,59 @@ public:
 };
 
 class FileOwnershipResolver;
+class RateLimiter;
+class StatProbePool;
 class SymlinkResolver;
+class XattrResolver;
 
 class FileScanner {
 public:
+    using EntryBatchSink = std::function<void(std::vector<Entry>&)>;
+
     FileScanner(const Config& config,
                 FileOwnershipResolver& ownership_resolver,
-                SymlinkResolver& symlink_resolver);
+                SymlinkResolver& symlink_resolver,
+                XattrResolver& xattr_resolver);
+    ~FileScanner();
 
     VisitResult collect_entries(const std::filesystem::path& dir,
                                 std::vector<Entry>& out,
                                 bool is_top_level) const;
+    // Like collect_entries, but hands entries to sink in batches of at most
+    // batch_size so callers never hold a whole directory at once.
+    VisitResult stream_entries(const std::filesystem::path& dir,
+                               std::size_t batch_size,
+                               const EntryBatchSink& sink,
+                               bool is_top_level) const;
     VisitResult collect_child_directories(const std::filesystem::path& dir,
                                           std::vector<std::filesystem::path>& out,
                                           bool is_top_level) const;
 
 private:
+    VisitResult collect_entries_impl(const std::filesystem::path& dir,
+                                     std::vector<Entry>& out,
+                                     bool is_top_level,
+                                     const EntryBatchSink* sink,
+                                     std::size_t batch_size) const;
     bool matches_any_pattern(const std::string& name,
                              const std::vector<std::string>& patterns) const;
     bool should_include(const std::string& name, bool is_explicit) const;
     void populate_entry(const std::filesystem::directory_entry& de, Entry& entry) const;
+    // The two halves of populate_entry. read_entry_metadata makes the
+    // per-entry syscalls and touches only its arguments, so stat probe
+    // workers can run it; resolve_entry_metadata goes through the shared
+    // resolver caches and stays on the scanning thread. The probe path reads
+    // the attribute indicator itself and passes read_xattr = false.
+    static void read_entry_metadata(const std::filesystem::directory_entry& de,
+                                    bool dereference,
+                                    Entry& entry);
+    void resolve_entry_metadata(Entry& entry, bool read_xattr = true) const;
     void apply_symlink_metadata(Entry& entry) const;
     void apply_icon_and_color(Entry& entry) const;
+    void apply_color(Entry& entry) const;
+    // With --sniff: classifies entries[from..] that have no recognised icon
+    // by their leading bytes.
+    void sniff_entries(std::vector<Entry>& entries, std::size_t from) const;
     void report_path_error(const std::filesystem::path& path,
                            const std::error_code& ec,
                            const char* fallback) const;
@@ -67,10 +103,34 @@ private:
                    std::vector<Entry>& out,
                    std::string override_name,
                    bool is_explicit) const;
+    // Applies the dirs-only/files-only filters to a populated entry
+    // and appends it to out.
+    bool keep_entry(Entry&& entry, std::vector<Entry>& out) const;
+    // With --stat-timeout: reads the pending entries' metadata, symlink
+    // targets and attributes on the worker pool and adds them, substituting
+    // a placeholder for any that did not answer.
+    VisitResult flush_probed_entries(std::vector<std::filesystem::directory_entry>& pending,
+                                     std::vector<Entry>& out) const;
+    // With --stat-timeout: appends the pending children that answered and
+    // are directories to recurse into.
+    void flush_probed_directories(std::vector<std::filesystem::directory_entry>& pending,
+                                  std::vector<std::filesystem::path>& out) const;
+    // Opens dir on the worker pool when --stat-timeout is set; a directory
+    // that does not answer is reported and comes back as errc::timed_out.
+    std::filesystem::directory_iterator open_directory(const std::filesystem::path& dir,
+                                                       std::error_code& ec) const;
+    void add_timed_out_entry(const std::filesystem::directory_entry& de,
+                             std::vector<Entry>& out) const;
+    // With --max-ops-per-sec: waits until count more directory opens or
+    // stats fit in the budget.
+    void throttle(std::uint64_t count = 1) const;
 
     const Config& config_;
     FileOwnershipResolver& ownership_resolver_;
     SymlinkResolver& symlink_resolver_;
+    XattrResolver& xattr_resolver_;
+    std::unique_ptr<StatProbePool> stat_probe_;
+    std::unique_ptr<RateLimiter> rate_limiter_;
 };
 
 }  // namespace nls
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <cstddef>
 #include <memory>
 #include <set>
 #include <string>
@@ -8,9 +9,18 @@
 
 namespace nls {
 
+struct GitDiffStat {
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    bool binary = false;
+};
+
 struct GitStatusResult {
     std::unordered_map<std::string, std::set<std::string>> entries;
     std::set<std::string> default_modes;
+    // Line changes of modified files against HEAD, keyed by the path relative
+    // to the listed directory. Only filled when requested from GetStatus.
+    std::unordered_map<std::string, GitDiffStat> diffstats;
     bool repository_found = false;
 
     const std::set<std::string>* ModesFor(const std::string& rel_path) const;
@@ -18,6 +28,7 @@ struct GitStatusResult {
                                 bool is_dir,
                                 bool is_empty_dir,
                                 bool no_color) const;
+    std::string FormatDiffStatFor(const std::string& rel_path, bool no_color) const;
 
 private:
     std::string FormatPrefix(const std::set<std::string>* modes,
@@ -36,10 +47,23 @@ public:
     GitStatus(const GitStatus&) = delete;
     GitStatus& operator=(const GitStatus&) = delete;
 
-    GitStatusResult GetStatus(const std::filesystem::path& dir, bool recursive = false);
+    // With diffstat, modified files that will be displayed also get their
+    // added/removed line counts (see GitStatusResult::diffstats).
+    GitStatusResult GetStatus(const std::filesystem::path& dir,
+                              bool recursive = false,
+                              bool diffstat = false);
+
+    // Caps the worker threads used for submodule statuses and diff stats;
+    // 0 uses one per CPU, up to eight.
+    void SetMaxJobs(std::size_t jobs);
 
 private:
+    // Creates the backend on first use, so runs without --gs never
+    // initialise libgit2.
+    GitStatusImpl& impl();
+
     std::unique_ptr<GitStatusImpl> impl_;
+    std::size_t max_jobs_ = 0;
 };
 
 } // namespace nls
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace nls {
+
+// Decides which subdirectories -R and --tree may descend into under
+// --one-file-system and --skip-fs, so pruned mounts are never opened.
+class MountFilter {
+public:
+    MountFilter(bool one_file_system, std::vector<std::string> skip_types);
+
+    [[nodiscard]] bool active() const noexcept { return one_file_system_ || !skip_types_.empty(); }
+
+    // Sets the listed PATH whose file system --one-file-system stays on.
+    void SetRoot(const std::filesystem::path& root);
+
+    // False when dir is a mount point of a skipped type or lies on another
+    // file system than the root. device, when the caller already has it
+    // from the directory's metadata, saves a stat.
+    [[nodiscard]] bool Allows(const std::filesystem::path& dir, std::optional<std::uintmax_t> device = std::nullopt);
+
+    // Whether a file system type from the mount table matches the skip
+    // list: "fuse" also matches subtypes such as "fuse.sshfs".
+    [[nodiscard]] static bool TypeMatches(const std::string& type, const std::vector<std::string>& skip_types);
+
+private:
+    void LoadMountTable();
+    [[nodiscard]] static std::optional<std::uintmax_t> DeviceOf(const std::filesystem::path& dir);
+
+    bool one_file_system_;
+    std::vector<std::string> skip_types_;
+    bool mounts_loaded_ = false;
+    // Absolute mount points whose file system type is skipped.
+    std::unordered_set<std::string> skipped_mounts_;
+
+    std::filesystem::path root_;
+    std::filesystem::path absolute_root_;
+    std::optional<std::uintmax_t> root_device_;
+};
+
+}  // namespace nls
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nls {
+
+// Append-only store for strings that arrive sorted, such as the names and
+// paths of one sorted run of a listing. Neighbours share long prefixes
+// (`part-000123.parquet`, `part-000124.parquet`), so each string keeps only
+// the length of the prefix it shares with its predecessor and the bytes that
+// follow (front coding). Every kRestartInterval-th string is stored whole;
+// these restart points let Get() reach any string by decoding one block.
+class NameStore {
+public:
+    static constexpr std::size_t kRestartInterval = 16;
+
+    void Append(std::string_view value);
+    // Returns the slack left by growing the buffers once no more strings
+    // will be added.
+    void ShrinkToFit();
+
+    [[nodiscard]] std::size_t size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+    // Memory held by the encoded strings and the restart index.
+    [[nodiscard]] std::size_t bytes() const noexcept;
+    // Combined length of the strings as appended.
+    [[nodiscard]] std::size_t raw_bytes() const noexcept { return raw_bytes_; }
+
+    // Decodes the string at index into out. Returns false when index is out
+    // of range.
+    bool Get(std::size_t index, std::string& out) const;
+
+    // Decodes strings in order, rewriting only the suffix of the previous
+    // one, which is how a run is read back while it is rendered.
+    class Cursor {
+    public:
+        explicit Cursor(const NameStore& store) : store_(&store) {}
+
+        // The view stays valid until the next call.
+        [[nodiscard]] bool Next(std::string_view& value);
+
+    private:
+        const NameStore* store_;
+        std::size_t index_ = 0;
+        std::size_t offset_ = 0;
+        std::string current_;
+    };
+
+private:
+    // Applies the record at offset to current, which holds the previous
+    // string, and returns the offset of the next record.
+    std::size_t DecodeAt(std::size_t offset, std::string& current) const;
+
+    std::string data_;
+    std::vector<std::size_t> restarts_;
+    std::string last_;
+    std::size_t count_ = 0;
+    std::size_t raw_bytes_ = 0;
+};
+
+}  // namespace nls
@@ -1,33 +1,87 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_set>
 #include <vector>
 
 #include "config.h"
+#include "external_sort.h"
 #include "fs_scanner.h"
 #include "git_status.h"
+#include "mount_filter.h"
 #include "renderer.h"
+#include "scan_checkpoint.h"
 
 namespace nls {
 
+class ContentHasher;
+
 class PathProcessor {
 public:
     PathProcessor(const Config& config,
                   FileScanner& scanner,
                   Renderer& renderer,
                   GitStatus& git_status) noexcept;
+    ~PathProcessor();
 
     [[nodiscard]] VisitResult process(const std::filesystem::path& path);
 
 private:
+    struct DirectoryId {
+        std::uintmax_t device = 0;
+        std::uintmax_t inode = 0;
+        bool operator==(const DirectoryId&) const = default;
+    };
+
+    struct DirectoryIdHash {
+        [[nodiscard]] std::size_t operator()(const DirectoryId& id) const noexcept {
+            return std::hash<std::uintmax_t>{}(id.inode) ^ (std::hash<std::uintmax_t>{}(id.device) << 1);
+        }
+    };
+
+    enum class ShardOwnership : std::uint8_t { Pending, Owned, Foreign };
+
+    // A directory waiting on the -R traversal stack.
+    struct RecursiveFrame {
+        std::filesystem::path dir;
+        std::size_t depth = 0;
+        ShardOwnership inherited = ShardOwnership::Pending;
+        bool is_top_level = false;
+    };
+
+    [[nodiscard]] ShardOwnership shardOwnership(const std::filesystem::path& dir,
+                                                std::size_t depth,
+                                                ShardOwnership inherited) const;
+    [[nodiscard]] bool markDirectoryVisited(const std::filesystem::path& dir);
     [[nodiscard]] VisitResult listPath(const std::filesystem::path& path);
     [[nodiscard]] VisitResult listRecursiveFlat(const std::filesystem::path& path);
-    [[nodiscard]] VisitResult listRecursiveDirectory(const std::filesystem::path& dir, bool is_top_level);
+    // Lists one directory and pushes its subdirectories onto pending in
+    // reverse, so popping the stack walks the tree depth-first in order.
+    [[nodiscard]] VisitResult listRecursiveDirectory(const RecursiveFrame& frame,
+                                                     std::vector<RecursiveFrame>& pending);
+    [[nodiscard]] bool openCheckpoint();
+    void saveCheckpoint(std::size_t path_index, bool fresh, const std::vector<RecursiveFrame>& pending);
     [[nodiscard]] std::vector<TreeItem> buildTreeItems(const std::filesystem::path& dir,
                                                        std::size_t depth,
                                                        std::vector<Entry>& flat,
                                                        VisitResult& status);
+    [[nodiscard]] VisitResult listExternallySorted(const std::filesystem::path& dir,
+                                                   bool is_top_level,
+                                                   const std::function<void()>& print_header);
+    [[nodiscard]] bool useExternalSort() const;
+    [[nodiscard]] GitStatusResult fetchGitStatus(const std::filesystem::path& dir);
     void applyGitStatus(std::vector<Entry>& items, const std::filesystem::path& dir);
+    void applyContentHashes(std::vector<Entry>& items);
+    void applyGitStatus(std::vector<Entry>& items,
+                        const std::filesystem::path& dir,
+                        const GitStatusResult& status) const;
+    [[nodiscard]] bool entryPrecedes(const ExternalEntrySorter::MergeHead& a,
+                                     const ExternalEntrySorter::MergeHead& b) const;
     void sortEntries(std::vector<Entry>& entries) const;
 
     [[nodiscard]] const Config& options() const noexcept { return config_; }
@@ -40,6 +94,15 @@ private:
     Renderer& renderer_;
     GitStatus& git_status_;
     bool recursive_block_printed_ = false;
+    std::filesystem::path recursive_root_;
+    std::unordered_set<DirectoryId, DirectoryIdHash> visited_directories_;
+    std::unique_ptr<ContentHasher> content_hasher_;
+    MountFilter mount_filter_;
+    std::size_t path_index_ = 0;
+    std::unique_ptr<ScanCheckpoint> checkpoint_;
+    bool checkpoint_failed_ = false;
+    std::optional<ScanCheckpoint::State> resume_;
+    std::uint64_t directories_listed_ = 0;
 };
 
 }  // namespace nls
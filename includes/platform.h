@@ -8,6 +8,10 @@ public:
 
     static bool enableVirtualTerminal();
     static bool isOutputTerminal();
+    static bool isErrorTerminal();
+    // Drops to idle I/O priority and the lowest CPU priority (--background).
+    // Returns false if either could not be applied.
+    static bool enterBackgroundMode();
     static int terminalWidth();
     static SystemTheme detectSystemTheme();
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace nls::progress {
+
+// Blocking operations whose age --progress reports as "slowest".
+enum class Operation : std::size_t {
+    ReadDirectory,
+    Stat,
+    GitStatus,
+    Hash,
+};
+
+// Live scan statistics for --progress. The scanner bumps relaxed atomic
+// counters; a reporter thread samples them at a fixed rate and rewrites a
+// status line on stderr, so the scan itself never waits on the output.
+class Tracker {
+public:
+    static Tracker& Instance();
+
+    [[nodiscard]] bool enabled() const noexcept { return enabled_; }
+
+    // Starts the reporter thread. On a terminal the line is rewritten in
+    // place; otherwise one line is appended per interval.
+    void Start(std::ostream& os, bool terminal, std::chrono::milliseconds interval);
+    // Stops the reporter and clears the status line.
+    void Stop();
+
+    // Called once per directory, so the path is published under a mutex
+    // the reporter only holds long enough to copy it.
+    void EnterDirectory(const std::filesystem::path& dir);
+    void AddEntry(std::uintmax_t bytes) noexcept
+    {
+        entries_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void BeginOperation(Operation op) noexcept;
+    void EndOperation(Operation op) noexcept;
+
+private:
+    Tracker() = default;
+
+    void ReportLoop(std::ostream& os, bool terminal, std::chrono::milliseconds interval);
+    [[nodiscard]] std::string FormatLine(std::uint64_t rate) const;
+
+    static constexpr std::size_t kOperationCount = 4;
+
+    bool enabled_ = false;
+    std::atomic<std::uint64_t> directories_{0};
+    std::atomic<std::uint64_t> entries_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    // steady_clock ticks at which each operation started; zero when idle.
+    std::array<std::atomic<std::int64_t>, kOperationCount> started_{};
+
+    mutable std::mutex directory_mutex_;
+    std::string current_directory_;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_requested_ = false;
+    std::thread reporter_;
+};
+
+// Marks op as in flight for the lifetime of the scope when --progress is on.
+class Scope {
+public:
+    explicit Scope(Operation op) noexcept
+        : op_(op), active_(Tracker::Instance().enabled())
+    {
+        if (active_) Tracker::Instance().BeginOperation(op_);
+    }
+    ~Scope()
+    {
+        if (active_) Tracker::Instance().EndOperation(op_);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Operation op_;
+    bool active_;
+};
+
+}  // namespace nls::progress
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nls {
+
+// One-line directory summary for shell prompts (--prompt-summary). It skips
+// everything a listing needs: entry kinds come from the directory stream,
+// only regular files are stat'ed (for their size), and the git flag is taken
+// from the stat data cached in the repository index.
+class PromptSummary final {
+public:
+    struct Counts {
+        std::uint64_t entries = 0;
+        std::uint64_t dirs = 0;
+        std::uint64_t files = 0;
+        std::uint64_t links = 0;
+        std::uint64_t other = 0;
+        std::uint64_t hidden = 0;
+        std::uint64_t size = 0;
+    };
+
+    enum class GitState { None, Clean, Dirty, Unknown };
+
+    // An empty cache_file disables the summary cache.
+    explicit PromptSummary(std::filesystem::path cache_file);
+
+    // Prints "entries=N dirs=N files=N links=N other=N hidden=N size=BYTES
+    // git=none|clean|dirty|unknown", followed by " path=DIR" when
+    // with_path is set. Returns false when the directory cannot be read.
+    bool Print(const std::filesystem::path& dir, bool with_path, std::ostream& out);
+
+    // Default cache location under the user configuration directory.
+    [[nodiscard]] static std::filesystem::path DefaultCacheFile();
+
+    // Whether any tracked file's size or modification time differs from the
+    // index; stops at the first difference.
+    [[nodiscard]] static GitState CheckGit(const std::filesystem::path& dir);
+
+private:
+    struct CacheRecord {
+        std::int64_t mtime_ns = 0;
+        Counts counts;
+        std::string_view key;
+        // Lines [first_file, end) of the cache hold the regular file names.
+        std::size_t first_file = 0;
+        std::size_t end = 0;
+    };
+
+    // Also collects the names of regular files into files when given.
+    [[nodiscard]] static bool CountEntries(const std::filesystem::path& dir, Counts& counts,
+                                           std::vector<std::string>* files);
+    [[nodiscard]] static bool SumFileSizes(const std::filesystem::path& dir, const std::vector<std::string>& files,
+                                           std::uint64_t& size);
+    [[nodiscard]] static std::optional<std::int64_t> DirectoryMtime(const std::filesystem::path& dir);
+    [[nodiscard]] static bool ParseRecord(const std::vector<std::string>& lines, std::size_t index,
+                                          CacheRecord& record);
+    [[nodiscard]] bool LoadCached(const std::string& key, std::int64_t mtime_ns, Counts& counts,
+                                  std::vector<std::string>& files);
+    void StoreCached(const std::string& key, std::int64_t mtime_ns, const Counts& counts,
+                     const std::vector<std::string>& files);
+
+    std::filesystem::path cache_file_;
+    bool cache_loaded_ = false;
+    std::vector<std::string> cache_lines_;
+};
+
+}  // namespace nls
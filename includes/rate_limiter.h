@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace nls {
+
+// Token bucket that paces file-system operations for --max-ops-per-sec.
+// Tokens refill continuously at the configured rate and up to a tenth of a
+// second's worth may accumulate, so short bursts pass at full speed while
+// the long-run rate stays at the limit. Not thread-safe: the scanner calls
+// it from the listing thread only.
+class RateLimiter {
+public:
+    explicit RateLimiter(std::uint64_t ops_per_second);
+
+    // Blocks until count operations may proceed.
+    void Acquire(std::uint64_t count = 1);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double rate_;
+    double capacity_;
+    double tokens_;
+    Clock::time_point last_refill_;
+};
+
+}  // namespace nls
@@ -29,6 +29,16 @@ public:
 
     void TerminateLine() const;
 
+    // Column widths and report totals gathered across every batch of a
+    // listing that is rendered incrementally (see --memory-limit).
+    class StreamLayout;
+
+    [[nodiscard]] bool SupportsStreaming() const noexcept;
+    void AccumulateStream(StreamLayout& layout, const std::vector<Entry>& batch) const;
+    void BeginStream(StreamLayout& layout) const;
+    void RenderStreamBatch(const StreamLayout& layout, const std::vector<Entry>& batch) const;
+    void RenderStreamReport(const StreamLayout& layout) const;
+
 private:
     struct LongFormatColumns {
         size_t inode_width = 0;
@@ -40,6 +50,8 @@ private:
         size_t size_width = 0;
         size_t time_width = 0;
         size_t git_width = 0;
+        size_t diffstat_width = 0;
+        size_t hash_width = 0;
     };
 
     struct ReportStats {
@@ -49,6 +61,7 @@ private:
         size_t unrecognized_files = 0;
         size_t links = 0;
         size_t dead_links = 0;
+        size_t timed_out = 0;
         uintmax_t total_size = 0;
 
         size_t files() const { return recognized_files + unrecognized_files; }
@@ -59,6 +72,15 @@ private:
     TimeFormatter time_formatter_;
     PermissionFormatter permission_formatter_;
 
+    // Encoded "file://" URI of the directory most recently hyperlinked, keyed
+    // by the raw parent portion of the entry path.
+    struct HyperlinkPrefix {
+        std::filesystem::path::string_type directory;
+        std::string encoded;
+        bool valid = false;
+    };
+    mutable HyperlinkPrefix hyperlink_prefix_{};
+
     std::string ApplyControlCharHandling(const std::string& name) const;
     std::string ApplyQuoting(const std::string& name) const;
     std::string StyledName(const Entry& entry) const;
@@ -109,5 +131,13 @@ private:
     std::string TreePrefix(const std::vector<bool>& branches, bool is_last) const;
 };
 
+class Renderer::StreamLayout {
+    friend class Renderer;
+    size_t inode_width = 0;
+    size_t block_width = 0;
+    LongFormatColumns long_columns{};
+    ReportStats stats{};
+};
+
 }  // namespace nls
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nls {
+
+// Persists the state of a recursive listing (--checkpoint) so an
+// interrupted run can continue with --resume. The traversal is a
+// depth-first walk over an explicit stack, so the stack of directories not
+// yet listed is the whole frontier: every directory outside it has already
+// been written.
+class ScanCheckpoint {
+public:
+    struct Frame {
+        std::filesystem::path dir;
+        std::size_t depth = 0;
+        std::uint8_t ownership = 0;
+        bool is_top_level = false;
+    };
+
+    struct DirectoryId {
+        std::uintmax_t device = 0;
+        std::uintmax_t inode = 0;
+    };
+
+    struct State {
+        // Index into the listed paths of the one in progress. When fresh is
+        // set that path has not been started and pending is empty.
+        std::size_t path_index = 0;
+        bool fresh = true;
+        std::filesystem::path root;
+        bool block_printed = false;
+        // Bytes of standard output written so far, when it is a regular file.
+        std::optional<std::uint64_t> output_offset;
+        std::uint64_t directories_listed = 0;
+        std::vector<Frame> pending;
+        // Directories already entered through symlinks (-L cycle detection).
+        std::vector<DirectoryId> visited;
+    };
+
+    explicit ScanCheckpoint(std::filesystem::path file);
+
+    // Reads the checkpoint. A missing file yields a fresh state; false means
+    // the file could not be parsed.
+    [[nodiscard]] bool Load(State& state) const;
+
+    // True once enough time has passed since the last save that writing one
+    // stays within the overhead budget.
+    [[nodiscard]] bool Due() const;
+    // Flushes standard output, records its position and replaces the
+    // checkpoint file atomically.
+    void Save(State& state);
+    void Remove() const;
+
+    [[nodiscard]] const std::filesystem::path& file() const noexcept { return file_; }
+
+    // Cuts standard output back to offset so a resumed run overwrites
+    // anything written after the checkpoint. Returns false with a message
+    // when the output cannot be rewound; a message on success is a warning.
+    [[nodiscard]] static bool RewindOutput(std::uint64_t offset, std::string& error);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::filesystem::path file_;
+    Clock::time_point last_save_;
+    Clock::duration interval_;
+};
+
+}  // namespace nls
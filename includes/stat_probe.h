@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nls {
+
+// Runs the metadata syscalls that can block forever on an unresponsive
+// mount (lstat/stat) on a small pool of detached worker threads, so the
+// caller can give up on a path after a deadline and keep what the workers
+// read for the paths that did answer. A worker stuck inside the
+// kernel is abandoned and replaced; the abandoned thread exits on its own if
+// the call ever returns.
+class StatProbePool {
+public:
+    StatProbePool(std::chrono::milliseconds timeout, std::size_t workers);
+    ~StatProbePool();
+
+    StatProbePool(const StatProbePool&) = delete;
+    StatProbePool& operator=(const StatProbePool&) = delete;
+
+    struct Probe {
+        std::filesystem::path path;
+        // Reads the metadata of path. It may still be running on an abandoned
+        // worker after ProbeAll gave up on it, so it must own (or share
+        // ownership of) everything it writes to.
+        std::function<void()> read;
+    };
+
+    // Runs every probe concurrently; result[i] is true once probe i has
+    // finished and false when it did not finish within the deadline.
+    [[nodiscard]] std::vector<bool> ProbeAll(std::vector<Probe> probes);
+
+private:
+    struct Job;
+    struct Shared;
+
+    static void WorkerLoop(std::shared_ptr<Shared> shared);
+    void SpawnWorker();
+
+    std::chrono::milliseconds timeout_;
+    std::shared_ptr<Shared> shared_;
+};
+
+}  // namespace nls
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <string_view>
 
@@ -18,6 +19,18 @@ public:
                ascii_to_lower(static_cast<unsigned char>(b));
     }
 
+    // Same order as ToLower(a) < ToLower(b), without building either copy.
+    static constexpr bool LessIgnoreCase(std::string_view a, std::string_view b) noexcept
+    {
+        const std::size_t common = a.size() < b.size() ? a.size() : b.size();
+        for (std::size_t i = 0; i < common; ++i) {
+            const unsigned char lhs = ascii_to_lower(static_cast<unsigned char>(a[i]));
+            const unsigned char rhs = ascii_to_lower(static_cast<unsigned char>(b[i]));
+            if (lhs != rhs) return lhs < rhs;
+        }
+        return a.size() < b.size();
+    }
+
     static std::string ToLower(std::string_view value);
     static std::string Trim(std::string_view value);
 
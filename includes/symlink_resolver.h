@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
 
 #include "file_info.h"
 
@@ -9,7 +13,37 @@ namespace nls {
 
 class SymlinkResolver {
 public:
-    std::optional<std::filesystem::path> ResolveTarget(const FileInfo& file_info) const;
+    struct TargetStat {
+        std::filesystem::file_status status{};
+        std::error_code status_error{};
+        bool broken = false;
+        bool has_details = false;
+        uintmax_t size = 0;
+        bool has_size = false;
+        std::filesystem::file_time_type mtime{};
+        bool has_mtime = false;
+    };
+
+    static std::optional<std::filesystem::path> ResolveTarget(const FileInfo& file_info);
+
+    // Follows a symlink once per distinct target for the whole run; links
+    // whose targets resolve from the same real directory to the same path
+    // reuse the first result. Size and mtime are only
+    // fetched when with_details is requested (dereferencing listings).
+    const TargetStat& StatTarget(const FileInfo& file_info, bool with_details) const;
+
+    // Follows the link without touching the caches, so a stat probe worker
+    // can call it; Remember then files the result as StatTarget would have.
+    static TargetStat ReadTarget(const FileInfo& file_info, bool with_details);
+    void Remember(const FileInfo& file_info, const TargetStat& stat) const;
+
+private:
+    // The real parent directory joined with the link text, or the link's own
+    // path when the parent cannot be resolved.
+    std::filesystem::path CacheKey(const FileInfo& file_info) const;
+
+    mutable std::unordered_map<std::filesystem::path::string_type, TargetStat> target_cache_;
+    mutable std::unordered_map<std::filesystem::path::string_type, std::filesystem::path> canonical_parents_;
 };
 
 } // namespace nls
@@ -51,6 +51,9 @@ public:
     IconResult get_file_icon(std::string_view filename, bool is_executable);
     IconResult get_folder_icon(std::string_view folder_name);
     IconResult get_icon(std::string_view name, bool is_dir, bool is_executable);
+    // Looks up a file-type key (e.g. "py") directly, as used for types
+    // detected from content rather than the name.
+    IconResult get_type_icon(std::string_view type_key);
 
     static std::string ApplyColor(const std::string& color,
                                   std::string_view text,
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "file_info.h"
+
+namespace nls {
+
+// Works out the GNU ls -l indicator that follows the mode string: '+' for a
+// file with an ACL, '.' for one with only a security context.
+class XattrResolver {
+public:
+    // The outcome of listing one file's attribute names.
+    struct Reading {
+        char indicator = 0;
+        int error = 0;
+        std::uint64_t syscalls = 0;
+    };
+
+    // Returns '+', '.' or 0 (no extended metadata). Results are cached per
+    // inode and revalidated against its change time, and filesystems that do
+    // not support extended attributes are only asked once. A reading taken
+    // earlier by Read is used instead of asking the filesystem again.
+    char Indicator(const FileInfo& file_info, bool dereference, const Reading* reading = nullptr) const;
+
+    // Lists the attribute names without touching the caches, so a stat
+    // probe worker can call it.
+    static Reading Read(const FileInfo& file_info, bool dereference);
+
+private:
+    struct InodeKey {
+        uintmax_t device = 0;
+        uintmax_t inode = 0;
+        bool operator==(const InodeKey&) const = default;
+    };
+
+    struct InodeKeyHash {
+        std::size_t operator()(const InodeKey& key) const noexcept {
+            return std::hash<uintmax_t>{}(key.inode) ^ (std::hash<uintmax_t>{}(key.device) << 1);
+        }
+    };
+
+    struct CachedIndicator {
+        std::int64_t ctime_ns = 0;
+        char indicator = 0;
+    };
+
+    mutable std::unordered_map<InodeKey, CachedIndicator, InodeKeyHash> cache_;
+    mutable std::unordered_set<uintmax_t> unsupported_devices_;
+};
+
+} // namespace nls
@@ -1,16 +1,20 @@
 #include "app.h"
 
+#include <chrono>
 #include <filesystem>
 #include <iostream>
 #include <optional>
 #include <system_error>
 
+#include "cancellation.h"
 #include "db_command.h"
 #include "file_ownership_resolver.h"
 #include "git_status.h"
 #include "path_processor.h"
 #include "perf.h"
 #include "platform.h"
+#include "progress.h"
+#include "prompt_summary.h"
 #include "resources.h"
 #include "symlink_resolver.h"
 #include "theme.h"
@@ -21,10 +25,15 @@ namespace nls {
 
 int App::run(int argc, char** argv) {
     const bool virtual_terminal_enabled = Platform::enableVirtualTerminal();
+    Cancellation::InterceptBrokenPipe();
     ResourceManager::initPaths(argc > 0 ? argv[0] : nullptr);
 
     config_ = &parser_.Parse(argc, argv);
 
+    if (config_->background() && !Platform::enterBackgroundMode()) {
+        std::cerr << "nls: warning: could not lower I/O or CPU priority\n";
+    }
+
     if (config_->db_action() != Config::DbAction::None) {
         int db_rc = runDatabaseCommand(config_->db_action());
         config_ = nullptr;
@@ -41,6 +50,16 @@ int App::run(int argc, char** argv) {
         config_->set_no_color(true);
     }
 
+    if (options().prompt_summary()) {
+        const int prompt_rc = runPromptSummary();
+        config_ = nullptr;
+        if (perf_manager.enabled()) {
+            run_timer.reset();
+            perf_manager.Report(std::cerr);
+        }
+        return prompt_rc;
+    }
+
     ColorScheme scheme = ColorScheme::Dark;
     switch (options().color_theme()) {
         case Config::ColorTheme::Light:
@@ -64,12 +83,24 @@ int App::run(int argc, char** argv) {
     }
     Theme::instance().initialize(scheme, options().theme_name());
 
-    scanner_ = std::make_unique<FileScanner>(options(), ownership_resolver_, symlink_resolver_);
+    scanner_ = std::make_unique<FileScanner>(options(), ownership_resolver_, symlink_resolver_, xattr_resolver_);
     renderer_ = std::make_unique<Renderer>(options());
+    git_status_.SetMaxJobs(options().git_jobs());
     PathProcessor processor{options(), *scanner_, *renderer_, git_status_};
 
+    auto& progress_tracker = progress::Tracker::Instance();
+    if (options().progress()) {
+        // A terminal line is cheap to rewrite; logs get one line every few seconds.
+        const bool terminal = Platform::isErrorTerminal();
+        progress_tracker.Start(std::cerr, terminal,
+                               terminal ? std::chrono::milliseconds(250) : std::chrono::milliseconds(2000));
+    }
+
     VisitResult rc = VisitResult::Ok;
     for (const auto& path : options().paths()) {
+        if (!Cancellation::CheckOutput()) {
+            break;
+        }
         VisitResult path_result = VisitResult::Ok;
         try {
             path_result = processor.process(fs::path(path));
@@ -79,6 +110,7 @@ int App::run(int argc, char** argv) {
         }
         rc = VisitResultAggregator::Combine(rc, path_result);
     }
+    progress_tracker.Stop();
 
     renderer_.reset();
     scanner_.reset();
@@ -95,7 +127,22 @@ int App::run(int argc, char** argv) {
 int App::runDatabaseCommand(Config::DbAction action)
 {
     DatabaseInspector inspector = DatabaseInspector::CreateFromResourceManager();
-    return inspector.Execute(action, options().db_icon_entry(), options().db_alias_entry());
+    return inspector.Execute(action, options().db_icon_entry(), options().db_alias_entry(), options().db_search());
+}
+
+int App::runPromptSummary()
+{
+    // Shell prompts run this before every command, so it bypasses the
+    // theme, scanner and renderer entirely.
+    PromptSummary summary(options().prompt_cache() ? PromptSummary::DefaultCacheFile() : fs::path{});
+    const auto& paths = options().paths();
+    int rc = 0;
+    for (const auto& path : paths) {
+        if (!summary.Print(fs::path(path), paths.size() > 1, std::cout)) {
+            rc = 2;
+        }
+    }
+    return rc;
 }
 
 }  // namespace nls
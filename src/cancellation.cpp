@@ -0,0 +1,170 @@
+#include "cancellation.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX 1
+#    endif
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <poll.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "perf.h"
+
+namespace nls {
+
+namespace {
+
+// Directories are usually listed far faster than this, so the poll costs a
+// few system calls per second while still noticing a closed pipe promptly.
+constexpr std::chrono::milliseconds kPollInterval{20};
+
+struct OutputState {
+    bool inspected = false;
+    bool is_pipe = false;
+    bool sigpipe_default = false;
+    std::chrono::steady_clock::time_point last_poll{};
+    // errno of the failed write, EPIPE when the reader went away and 0
+    // when the cause is unknown.
+    int error = 0;
+};
+
+OutputState& State() {
+    static OutputState state;
+    return state;
+}
+
+bool StdoutIsPipe() {
+#ifdef _WIN32
+    const auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(stdout)));
+    return handle != INVALID_HANDLE_VALUE && GetFileType(handle) == FILE_TYPE_PIPE;
+#else
+    struct stat st {};
+    return ::fstat(STDOUT_FILENO, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+#endif
+}
+
+// A pipe whose read end is closed reports POLLERR (Linux) or POLLHUP
+// (macOS) on the write end before anything is written to it.
+bool ReaderGone() {
+#ifdef _WIN32
+    return false;
+#else
+    pollfd fd{STDOUT_FILENO, POLLOUT, 0};
+    return ::poll(&fd, 1, 0) > 0 && (fd.revents & (POLLERR | POLLHUP)) != 0;
+#endif
+}
+
+// stdio drops the buffered data of a failed flush, so the failure cannot be
+// reproduced; errno still holds it unless a later call failed too. Only
+// codes a write can produce are trusted, anything else is reported plainly.
+int LastWriteError(int saved_errno) {
+    switch (saved_errno) {
+        case ENOSPC:
+        case EFBIG:
+        case EIO:
+        case EPIPE:
+#ifdef EDQUOT
+        case EDQUOT:
+#endif
+            return saved_errno;
+        default:
+            return 0;
+    }
+}
+
+bool WriteFailed() {
+    return !std::cout || std::ferror(stdout) != 0;
+}
+
+void RecordFailure(OutputState& state, int saved_errno) {
+    state.error = state.is_pipe ? EPIPE : LastWriteError(saved_errno);
+    auto& perf_manager = perf::Manager::Instance();
+    if (perf_manager.enabled()) {
+        perf_manager.IncrementCounter("cancellation::output_failed");
+    }
+    Cancellation::Request();
+}
+
+}  // namespace
+
+void Cancellation::InterceptBrokenPipe() {
+#ifndef _WIN32
+    // A parent that already ignores SIGPIPE expects write errors instead, so
+    // only the default disposition is re-raised at exit.
+    State().sigpipe_default = std::signal(SIGPIPE, SIG_IGN) == SIG_DFL;
+#endif
+}
+
+bool Cancellation::CheckOutput() {
+    if (Requested()) {
+        return false;
+    }
+    const int saved_errno = errno;
+    auto& state = State();
+    if (!state.inspected) {
+        state.inspected = true;
+        state.is_pipe = StdoutIsPipe();
+    }
+
+    bool failed = WriteFailed();
+    if (!failed && state.is_pipe) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - state.last_poll >= kPollInterval) {
+            state.last_poll = now;
+            failed = ReaderGone();
+        }
+    }
+    if (!failed) {
+        return true;
+    }
+
+    RecordFailure(state, saved_errno);
+    return false;
+}
+
+int Cancellation::Finish(int rc) {
+    // Only a write that actually failed counts here: a reader that left
+    // after taking all of the output did not cut the listing short.
+    auto& state = State();
+    errno = 0;
+    std::cout.flush();
+    if (!Requested() && WriteFailed()) {
+        const int saved_errno = errno;
+        state.is_pipe = StdoutIsPipe();
+        RecordFailure(state, saved_errno);
+    }
+    if (!Requested()) {
+        return rc;
+    }
+
+    if (state.error == EPIPE) {
+#ifndef _WIN32
+        if (state.sigpipe_default) {
+            std::cerr.flush();
+            std::signal(SIGPIPE, SIG_DFL);
+            std::raise(SIGPIPE);
+        }
+#endif
+        // The consumer chose to stop reading; that is not worth a message.
+        return 2;
+    }
+    std::cerr << "nls: write error";
+    if (state.error != 0) {
+        std::cerr << ": " << std::strerror(state.error);
+    }
+    std::cerr << "\n";
+    return 2;
+}
+
+}  // namespace nls
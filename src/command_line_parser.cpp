@@ -4,6 +4,7 @@
 #include <array>
 #include <cctype>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <limits>
@@ -70,6 +71,36 @@ public:
         actions_.emplace_back([value](Config& cfg) { cfg.set_recursive_flat(value); });
     }
 
+    void SetCheckpointFile(std::string file)
+    {
+        actions_.emplace_back([file = std::move(file)](Config& cfg) { cfg.set_checkpoint_file(file); });
+    }
+
+    void SetResume(bool value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_resume(value); });
+    }
+
+    void SetOneFileSystem(bool value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_one_file_system(value); });
+    }
+
+    void SetSkipFs(std::vector<std::string> types)
+    {
+        actions_.emplace_back([types = std::move(types)](Config& cfg) { cfg.set_skip_fs(types); });
+    }
+
+    void SetShard(Config::Shard shard)
+    {
+        actions_.emplace_back([shard](Config& cfg) { cfg.set_shard(shard); });
+    }
+
+    void SetShardDepth(std::size_t depth)
+    {
+        actions_.emplace_back([depth](Config& cfg) { cfg.set_shard_depth(depth); });
+    }
+
     void SetReport(Config::Report report)
     {
         actions_.emplace_back([report](Config& cfg) { cfg.set_report(report); });
@@ -116,6 +147,41 @@ public:
         actions_.emplace_back([sort](Config& cfg) { cfg.set_sort(sort); });
     }
 
+    void SetCollate(Config::Collate collate)
+    {
+        actions_.emplace_back([collate](Config& cfg) { cfg.set_collate(collate); });
+    }
+
+    void SetMemoryLimit(uintmax_t value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_memory_limit(value); });
+    }
+
+    void SetSniff(bool value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_sniff(value); });
+    }
+
+    void SetHashAlgorithm(Config::HashAlgorithm algorithm)
+    {
+        actions_.emplace_back([algorithm](Config& cfg) { cfg.set_hash_algorithm(algorithm); });
+    }
+
+    void SetDupes()
+    {
+        actions_.emplace_back([](Config& cfg) {
+            cfg.set_dupes(true);
+            if (cfg.hash_algorithm() == Config::HashAlgorithm::None) {
+                cfg.set_hash_algorithm(Config::HashAlgorithm::Xxh3);
+            }
+        });
+    }
+
+    void SetStatTimeout(std::chrono::milliseconds value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_stat_timeout(value); });
+    }
+
     void SetReverse(bool value)
     {
         actions_.emplace_back([value](Config& cfg) { cfg.set_reverse(value); });
@@ -281,6 +347,11 @@ public:
         db_alias_entry_.alias = std::move(value);
     }
 
+    void SetDbSearch(std::string value)
+    {
+        actions_.emplace_back([value = std::move(value)](Config& cfg) { cfg.set_db_search(value); });
+    }
+
     Config::DbAction db_action() const
     {
         return db_action_;
@@ -306,6 +377,44 @@ public:
         actions_.emplace_back([value](Config& cfg) { cfg.set_git_status(value); });
     }
 
+    void SetGitJobs(std::size_t value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_git_jobs(value); });
+    }
+
+    void SetGitDiffstat()
+    {
+        actions_.emplace_back([](Config& cfg) {
+            cfg.set_git_diffstat(true);
+            cfg.set_git_status(true);
+        });
+    }
+
+    void SetBackground(bool value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_background(value); });
+    }
+
+    void SetMaxOpsPerSec(std::uint64_t value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_max_ops_per_sec(value); });
+    }
+
+    void SetProgress(bool value)
+    {
+        actions_.emplace_back([value](Config& cfg) { cfg.set_progress(value); });
+    }
+
+    void SetPromptSummary(bool with_cache)
+    {
+        actions_.emplace_back([with_cache](Config& cfg) {
+            cfg.set_prompt_summary(true);
+            if (with_cache) {
+                cfg.set_prompt_cache(true);
+            }
+        });
+    }
+
     Config& Build()
     {
         Config& cfg = Config::Instance();
@@ -455,6 +564,33 @@ std::optional<CommandLineParser::SizeSpec> CommandLineParser::ParseSizeSpec(cons
     return spec;
 }
 
+std::optional<std::chrono::milliseconds> CommandLineParser::ParseDuration(const std::string& text) const {
+    size_t pos = 0;
+    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+        ++pos;
+    }
+    if (pos == 0 || pos > 9) {
+        return std::nullopt;
+    }
+
+    const long long number = std::stoll(text.substr(0, pos));
+    std::string suffix = text.substr(pos);
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+
+    if (suffix.empty() || suffix == "ms") {
+        return std::chrono::milliseconds(number);
+    }
+    if (suffix == "s") {
+        return std::chrono::milliseconds(number * 1000);
+    }
+    if (suffix == "m" || suffix == "min") {
+        return std::chrono::milliseconds(number * 60 * 1000);
+    }
+    return std::nullopt;
+}
+
 const std::map<std::string, Config::QuotingStyle>& CommandLineParser::QuotingStyleMap() const {
     static const std::map<std::string, Config::QuotingStyle> map{
         {"literal", Config::QuotingStyle::Literal},
@@ -518,83 +654,108 @@ Exit status:
 
     program.add_option("paths", builder.paths(), "paths to list")->type_name("PATH");
 
-    auto* db_command = program.add_subcommand("db", "Inspect configuration database tables");
-    db_command->fallthrough(false);
-    db_command->configurable(false);
-    db_command->allow_extras(false);
-    db_command->callback([&]() {
-        builder.EnableDbMode();
-        if (builder.paths().empty()) {
-            return;
-        }
-        builder.paths().clear();
+    // Listings never use the db subcommand's seventeen options, so they are
+    // only built when an argument could select it or help is requested. The
+    // listing options above stay eager: any of them may appear on a listing's
+    // command line, and CLI11 must know every option before it parses.
+    const bool wants_db_command = std::any_of(argv + 1, argv + argc, [](const char* arg) {
+        const std::string_view value(arg != nullptr ? arg : "");
+        return value == "db" || value == "--help" ||
+               (value.size() > 1 && value[0] == '-' && value[1] != '-' && value.find('h') != std::string_view::npos);
     });
+    CLI::Option* name_option = nullptr;
+    CLI::Option* icon_option = nullptr;
+    CLI::Option* icon_class_option = nullptr;
+    CLI::Option* icon_utf_option = nullptr;
+    CLI::Option* icon_hex_option = nullptr;
+    CLI::Option* description_option = nullptr;
+    CLI::Option* used_by_option = nullptr;
+    CLI::Option* alias_option = nullptr;
+    CLI::Option* search_option = nullptr;
+    if (wants_db_command) {
+        auto* db_command = program.add_subcommand("db", "Inspect configuration database tables");
+        db_command->fallthrough(false);
+        db_command->configurable(false);
+        db_command->allow_extras(false);
+        db_command->callback([&]() {
+            builder.EnableDbMode();
+            if (builder.paths().empty()) {
+                return;
+            }
+            builder.paths().clear();
+        });
 
-    db_command->add_flag_callback("--show-files",
-        [&]() { builder.SetDbAction(Config::DbAction::ShowFiles); },
-        "list file icon metadata from the merged configuration database");
-    db_command->add_flag_callback("--show-folders",
-        [&]() { builder.SetDbAction(Config::DbAction::ShowFolders); },
-        "list folder icon metadata from the merged configuration database");
-    db_command->add_flag_callback("--show-file-aliases",
-        [&]() { builder.SetDbAction(Config::DbAction::ShowFileAliases); },
-        "list file alias metadata along with resolved icons");
-    db_command->add_flag_callback("--show-folder-aliases",
-        [&]() { builder.SetDbAction(Config::DbAction::ShowFolderAliases); },
-        "list folder alias metadata along with resolved icons");
-
-    db_command->add_flag_callback("--set-file",
-        [&]() { builder.SetDbAction(Config::DbAction::SetFile); },
-        "add or update a file icon entry; supply all metadata fields");
-    db_command->add_flag_callback("--set-folder",
-        [&]() { builder.SetDbAction(Config::DbAction::SetFolder); },
-        "add or update a folder icon entry; supply all metadata fields");
-    db_command->add_flag_callback("--set-file-aliases",
-        [&]() { builder.SetDbAction(Config::DbAction::SetFileAlias); },
-        "add, update, or remove a file alias entry");
-    db_command->add_flag_callback("--set-folder-aliases",
-        [&]() { builder.SetDbAction(Config::DbAction::SetFolderAlias); },
-        "add, update, or remove a folder alias entry");
-
-    auto name_option = db_command->add_option_function<std::string>("--name",
-        [&](const std::string& value) { builder.SetDbName(value); },
-        "entry name (extension or folder label)");
-    name_option->type_name("TEXT");
-
-    auto icon_option = db_command->add_option_function<std::string>("--icon",
-        [&](const std::string& value) { builder.SetDbIcon(value); },
-        "icon glyph to associate with the entry");
-    icon_option->type_name("TEXT");
-
-    auto icon_class_option = db_command->add_option_function<std::string>("--icon_class",
-        [&](const std::string& value) { builder.SetDbIconClass(value); },
-        "icon class identifier");
-    icon_class_option->type_name("TEXT");
-
-    auto icon_utf_option = db_command->add_option_function<std::string>("--icon_utf_16_codes",
-        [&](const std::string& value) { builder.SetDbIconUtf16(value); },
-        "icon UTF-16 codepoint (format \\uXXXX)");
-    icon_utf_option->type_name("CODE");
-
-    auto icon_hex_option = db_command->add_option_function<std::string>("--icon_hex_code",
-        [&](const std::string& value) { builder.SetDbIconHex(value); },
-        "icon hexadecimal codepoint (format 0xXXXX)");
-    icon_hex_option->type_name("CODE");
-
-    auto description_option = db_command->add_option_function<std::string>("--description",
-        [&](const std::string& value) { builder.SetDbDescription(value); },
-        "entry description");
-    description_option->type_name("TEXT");
-
-    auto used_by_option = db_command->add_option_function<std::string>("--used_by",
-        [&](const std::string& value) { builder.SetDbUsedBy(value); },
-        "entry usage notes");
-    used_by_option->type_name("TEXT");
-
-    auto alias_option = db_command->add_option_function<std::string>("--alias",
-        [&](const std::string& value) { builder.SetDbAlias(value); },
-        "alias to assign (empty string removes alias)");
-    alias_option->type_name("TEXT");
+        db_command->add_flag_callback("--show-files",
+            [&]() { builder.SetDbAction(Config::DbAction::ShowFiles); },
+            "list file icon metadata from the merged configuration database");
+        db_command->add_flag_callback("--show-folders",
+            [&]() { builder.SetDbAction(Config::DbAction::ShowFolders); },
+            "list folder icon metadata from the merged configuration database");
+        db_command->add_flag_callback("--show-file-aliases",
+            [&]() { builder.SetDbAction(Config::DbAction::ShowFileAliases); },
+            "list file alias metadata along with resolved icons");
+        db_command->add_flag_callback("--show-folder-aliases",
+            [&]() { builder.SetDbAction(Config::DbAction::ShowFolderAliases); },
+            "list folder alias metadata along with resolved icons");
+
+        db_command->add_flag_callback("--set-file",
+            [&]() { builder.SetDbAction(Config::DbAction::SetFile); },
+            "add or update a file icon entry; supply all metadata fields");
+        db_command->add_flag_callback("--set-folder",
+            [&]() { builder.SetDbAction(Config::DbAction::SetFolder); },
+            "add or update a folder icon entry; supply all metadata fields");
+        db_command->add_flag_callback("--set-file-aliases",
+            [&]() { builder.SetDbAction(Config::DbAction::SetFileAlias); },
+            "add, update, or remove a file alias entry");
+        db_command->add_flag_callback("--set-folder-aliases",
+            [&]() { builder.SetDbAction(Config::DbAction::SetFolderAlias); },
+            "add, update, or remove a folder alias entry");
+
+        name_option = db_command->add_option_function<std::string>("--name",
+            [&](const std::string& value) { builder.SetDbName(value); },
+            "entry name (extension or folder label)");
+        name_option->type_name("TEXT");
+
+        icon_option = db_command->add_option_function<std::string>("--icon",
+            [&](const std::string& value) { builder.SetDbIcon(value); },
+            "icon glyph to associate with the entry");
+        icon_option->type_name("TEXT");
+
+        icon_class_option = db_command->add_option_function<std::string>("--icon_class",
+            [&](const std::string& value) { builder.SetDbIconClass(value); },
+            "icon class identifier");
+        icon_class_option->type_name("TEXT");
+
+        icon_utf_option = db_command->add_option_function<std::string>("--icon_utf_16_codes",
+            [&](const std::string& value) { builder.SetDbIconUtf16(value); },
+            "icon UTF-16 codepoint (format \\uXXXX)");
+        icon_utf_option->type_name("CODE");
+
+        icon_hex_option = db_command->add_option_function<std::string>("--icon_hex_code",
+            [&](const std::string& value) { builder.SetDbIconHex(value); },
+            "icon hexadecimal codepoint (format 0xXXXX)");
+        icon_hex_option->type_name("CODE");
+
+        description_option = db_command->add_option_function<std::string>("--description",
+            [&](const std::string& value) { builder.SetDbDescription(value); },
+            "entry description");
+        description_option->type_name("TEXT");
+
+        used_by_option = db_command->add_option_function<std::string>("--used_by",
+            [&](const std::string& value) { builder.SetDbUsedBy(value); },
+            "entry usage notes");
+        used_by_option->type_name("TEXT");
+
+        alias_option = db_command->add_option_function<std::string>("--alias",
+            [&](const std::string& value) { builder.SetDbAlias(value); },
+            "alias to assign (empty string removes alias)");
+        alias_option->type_name("TEXT");
+
+        search_option = db_command->add_option_function<std::string>("--search",
+            [&](const std::string& value) { builder.SetDbSearch(value); },
+            "only list entries whose name, description or used-by has words starting with TEXT");
+        search_option->type_name("TEXT");
+    }
 
     const std::map<std::string, Config::Format> format_map{
         {"long", Config::Format::Long},
@@ -622,6 +783,14 @@ Exit status:
         {"size", Config::Sort::Size},
         {"extension", Config::Sort::Extension},
         {"ext", Config::Sort::Extension},
+        {"version", Config::Sort::Version},
+        {"v", Config::Sort::Version},
+    };
+
+    const std::map<std::string, Config::Collate> collate_map{
+        {"ascii", Config::Collate::Ascii},
+        {"c", Config::Collate::Ascii},
+        {"locale", Config::Collate::Locale},
     };
 
     const std::map<std::string, Config::IndicatorStyle> indicator_map{
@@ -638,6 +807,11 @@ Exit status:
         {"short", Config::Report::Short},
     };
 
+    const std::map<std::string, Config::HashAlgorithm> hash_map{
+        {"xxh3", Config::HashAlgorithm::Xxh3},
+        {"sha256", Config::HashAlgorithm::Sha256},
+    };
+
     const std::map<std::string, ColorMode> color_map{
         {"auto", ColorMode::Auto},
         {"always", ColorMode::Always},
@@ -704,6 +878,86 @@ or comma (-m) (default: vertical))");
     recursive_option->excludes(tree_option);
     tree_option->excludes(recursive_option);
 
+    auto shard_option = layout->add_option_function<std::string>("--shard",
+        [&](const std::string& text) {
+            const auto slash = text.find('/');
+            std::size_t index = 0;
+            std::size_t count = 0;
+            try {
+                if (slash == std::string::npos) {
+                    throw std::invalid_argument(text);
+                }
+                std::size_t index_end = 0;
+                std::size_t count_end = 0;
+                const std::string index_text = text.substr(0, slash);
+                const std::string count_text = text.substr(slash + 1);
+                index = std::stoul(index_text, &index_end);
+                count = std::stoul(count_text, &count_end);
+                if (index_end != index_text.size() || count_end != count_text.size()) {
+                    throw std::invalid_argument(text);
+                }
+            } catch (const std::exception&) {
+                throw CLI::ValidationError("--shard", "invalid value '" + text + "'");
+            }
+            if (count == 0 || index == 0 || index > count) {
+                throw CLI::ValidationError("--shard", "invalid value '" + text + "'");
+            }
+            builder.SetShard(Config::Shard{index - 1, count});
+        },
+        R"(with -R, list only slice I of N (1-based); N runs
+with the same arguments cover the tree exactly once)");
+    shard_option->type_name("I/N");
+    shard_option->needs(recursive_option);
+
+    auto shard_depth_option = layout->add_option_function<std::size_t>("--shard-depth",
+        [&](const std::size_t& depth) {
+            if (depth == 0) {
+                throw CLI::ValidationError("--shard-depth", "invalid value '0'");
+            }
+            builder.SetShardDepth(depth);
+        },
+        "with --shard, assign directories to slices at DEPTH below each PATH");
+    shard_depth_option->type_name("DEPTH");
+    shard_depth_option->default_str("1");
+    shard_depth_option->needs(shard_option);
+
+    auto checkpoint_option = layout->add_option_function<std::string>("--checkpoint",
+        [&](const std::string& file) { builder.SetCheckpointFile(file); },
+        R"(with -R, save the traversal state to FILE every few
+seconds so an interrupted listing can be resumed)");
+    checkpoint_option->type_name("FILE");
+    checkpoint_option->needs(recursive_option);
+    auto resume_option = layout->add_flag_callback("--resume", [&]() { builder.SetResume(true); },
+        R"(continue the listing saved by --checkpoint, cutting
+the output (appended with >>) back to the saved point)");
+    resume_option->needs(checkpoint_option);
+
+    layout->add_flag_callback("--one-file-system", [&]() { builder.SetOneFileSystem(true); },
+        R"(with -R or --tree, do not descend into directories
+on other file systems than the listed PATH)");
+    auto skip_fs_option = layout->add_option_function<std::string>("--skip-fs",
+        [&](const std::string& text) {
+            std::vector<std::string> types;
+            std::size_t start = 0;
+            while (start <= text.size()) {
+                const auto comma = text.find(',', start);
+                const std::string type = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+                if (!type.empty()) {
+                    types.push_back(type);
+                }
+                if (comma == std::string::npos) break;
+                start = comma + 1;
+            }
+            if (types.empty()) {
+                throw CLI::ValidationError("--skip-fs", "invalid value '" + text + "'");
+            }
+            builder.SetSkipFs(std::move(types));
+        },
+        R"(with -R or --tree, do not descend into mounts of
+the listed types (e.g. proc,sysfs,nfs,fuse; fuse
+also matches fuse.sshfs))");
+    skip_fs_option->type_name("TYPES");
+
     std::string report_value;
     auto report_option = layout->add_flag("--report{long}", report_value,
         R"(show summary report: short, long (default: long)
@@ -746,6 +1000,8 @@ PATTERN (overridden by -a or -A))");
         "sort by file size, largest first");
     sorting->add_flag_callback("-X", [&]() { builder.SetSort(Config::Sort::Extension); },
         "sort by file extension");
+    sorting->add_flag_callback("-v", [&]() { builder.SetSort(Config::Sort::Version); },
+        "natural sort of (version) numbers within text");
     sorting->add_flag_callback("-U", [&]() { builder.SetSort(Config::Sort::None); },
         "do not sort; list entries in directory order");
     sorting->add_flag_callback("-r,--reverse", [&]() { builder.SetReverse(true); },
@@ -754,11 +1010,31 @@ PATTERN (overridden by -a or -A))");
     auto sort_option = sorting->add_option_function<Config::Sort>("--sort",
         [&](const Config::Sort& sort) { builder.SetSort(sort); },
         R"(sort by WORD instead of name: none, size,
-time, extension (default: name))");
+time, extension, version (default: name))");
     sort_option->type_name("WORD");
     sort_option->transform(CLI::CheckedTransformer(sort_map, CLI::ignore_case).description(""));
     sort_option->default_str("name");
 
+    auto collate_option = sorting->add_option_function<Config::Collate>("--collate",
+        [&](const Config::Collate& collate) { builder.SetCollate(collate); },
+        R"(compare names using WORD: ascii (case-folded
+bytes) or locale (LC_COLLATE rules))");
+    collate_option->type_name("WORD");
+    collate_option->transform(CLI::CheckedTransformer(collate_map, CLI::ignore_case).description(""));
+    collate_option->default_str("ascii");
+
+    auto memory_option = sorting->add_option_function<std::string>("--memory-limit",
+        [&](const std::string& text) {
+            auto spec = ParseSizeSpec(text);
+            if (!spec || spec->value == 0) {
+                throw CLI::ValidationError("--memory-limit", "invalid value '" + text + "'");
+            }
+            builder.SetMemoryLimit(spec->value);
+        },
+        R"(with -1 or -l, spill sorted runs to a temporary
+file once a listing needs more than SIZE)");
+    memory_option->type_name("SIZE");
+
     sorting->add_flag_callback("--sd,--sort-dirs,--group-directories-first", [&]() {
         builder.SetGroupDirsFirst();
     }, "sort directories before files");
@@ -900,8 +1176,66 @@ FORMAT (default: local))");
     information->add_flag_callback("-L,--dereference", [&]() { builder.SetDereference(true); },
         R"(when showing file information for a symbolic link,
 show information for the file the link references)");
+    information->add_flag_callback("--sniff", [&]() { builder.SetSniff(true); },
+        R"(pick icons for files with an unrecognised name by
+reading their first 512 bytes)");
+    auto hash_option = information->add_option_function<Config::HashAlgorithm>("--hash",
+        [&](const Config::HashAlgorithm& algorithm) { builder.SetHashAlgorithm(algorithm); },
+        "with -l, show a content hash of each regular file: xxh3, sha256");
+    hash_option->type_name("WORD");
+    hash_option->transform(CLI::CheckedTransformer(hash_map, CLI::ignore_case).description(""));
+    information->add_flag_callback("--dupes", [&]() { builder.SetDupes(); },
+        R"(list only files whose content matches another file
+in the same listing (hashes with xxh3 unless --hash is given))");
+    auto stat_timeout_option = information->add_option_function<std::string>("--stat-timeout",
+        [&](const std::string& text) {
+            auto duration = ParseDuration(text);
+            if (!duration || duration->count() == 0) {
+                throw CLI::ValidationError("--stat-timeout", "invalid value '" + text + "'");
+            }
+            builder.SetStatTimeout(*duration);
+        },
+        R"(give up on an entry whose metadata takes longer
+than DURATION to read (e.g. 500ms, 2s) and show it as ?)");
+    stat_timeout_option->type_name("DURATION");
     information->add_flag_callback("--gs,--git-status", [&]() { builder.SetGitStatus(true); },
         "show git status for each file");
+    information->add_flag_callback("--git-diffstat", [&]() { builder.SetGitDiffstat(); },
+        R"(with -l, show lines added and removed in each
+modified file against HEAD (implies --git-status))");
+    auto git_jobs_option = information->add_option_function<int>("--git-jobs",
+        [&](const int& jobs) {
+            if (jobs < 1) {
+                throw CLI::ValidationError("--git-jobs", "N must be at least 1");
+            }
+            builder.SetGitJobs(static_cast<std::size_t>(jobs));
+        },
+        R"(use at most N threads for git status of submodules
+and --git-diffstat (default: one per CPU, up to 8))");
+    git_jobs_option->type_name("N");
+    information->add_flag_callback("--background", [&]() { builder.SetBackground(true); },
+        R"(run at idle I/O priority and lowest CPU priority so
+long scans do not compete with other work)");
+    auto max_ops_option = information->add_option_function<std::int64_t>("--max-ops-per-sec",
+        [&](const std::int64_t& ops) {
+            if (ops < 1) {
+                throw CLI::ValidationError("--max-ops-per-sec", "N must be at least 1");
+            }
+            builder.SetMaxOpsPerSec(static_cast<std::uint64_t>(ops));
+        },
+        R"(open and stat at most N directories and entries per
+second (short bursts of up to N/10 are allowed))");
+    max_ops_option->type_name("N");
+    information->add_flag_callback("--progress", [&]() { builder.SetProgress(true); },
+        R"(report directories and entries scanned, entries/s,
+bytes, the current directory and the slowest operation
+in flight on stderr while listing)");
+    information->add_flag_callback("--prompt-summary", [&]() { builder.SetPromptSummary(false); },
+        R"(print a one-line, machine-parseable summary of each
+directory (entry counts, size, git dirty flag) for shell prompts)");
+    information->add_flag_callback("--prompt-cache", [&]() { builder.SetPromptSummary(true); },
+        R"(with --prompt-summary, reuse counts from a cache
+validated by directory mtime (implies --prompt-summary))");
 
     auto debug = program.add_option_group("Debug options");
     debug->add_flag_callback("--perf-debug", [&]() { builder.SetPerfLogging(true); },
@@ -1023,6 +1357,11 @@ show information for the file the link references)");
         throw CLI::ValidationError("db", "one of --show-* or --set-* flags must be provided");
     }
 
+    if (search_option != nullptr && search_option->count() > 0 &&
+        db_action != Config::DbAction::ShowFiles && db_action != Config::DbAction::ShowFolders) {
+        throw CLI::ValidationError("db", "--search is only valid with --show-files/--show-folders");
+    }
+
     if (db_mode && (db_action == Config::DbAction::SetFile || db_action == Config::DbAction::SetFolder)) {
         std::vector<std::string> missing;
         ensure_missing(missing, name_option, "--name");
@@ -1075,7 +1414,7 @@ show information for the file the link references)");
             throw CLI::ValidationError(
                 "db",
                 allow_name_filter
-                    ? "only --name may accompany --show-* commands"
+                    ? "only --name and --search may accompany --show-* commands"
                     : "metadata options require a --set-* command");
         }
     }
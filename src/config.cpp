@@ -26,12 +26,20 @@ void Config::Reset() {
     color_mode_ = ColorMode::Auto;
     color_theme_ = ColorTheme::Default;
     sort_ = Sort::Name;
+    collate_ = Collate::Ascii;
     report_ = Report::None;
     quoting_style_ = QuotingStyle::Literal;
 
     all_ = false;
     almost_all_ = false;
     git_status_ = false;
+    git_diffstat_ = false;
+    git_jobs_ = 0;
+    prompt_summary_ = false;
+    prompt_cache_ = false;
+    progress_ = false;
+    background_ = false;
+    max_ops_per_sec_ = 0;
     group_dirs_first_ = false;
     sort_files_first_ = false;
     dots_first_ = false;
@@ -54,15 +62,27 @@ void Config::Reset() {
     hide_control_chars_ = false;
     zero_terminate_ = false;
     show_block_size_ = false;
+    sniff_ = false;
+    hash_algorithm_ = HashAlgorithm::None;
+    dupes_ = false;
     perf_logging_ = false;
     db_action_ = DbAction::None;
     db_icon_entry_ = {};
     db_alias_entry_ = {};
+    db_search_.clear();
 
     theme_name_.reset();
 
     tree_depth_.reset();
     output_width_.reset();
+    memory_limit_.reset();
+    stat_timeout_.reset();
+    shard_.reset();
+    shard_depth_ = 1;
+    checkpoint_file_.clear();
+    resume_ = false;
+    one_file_system_ = false;
+    skip_fs_.clear();
 
     time_style_ = "local";
     hide_patterns_.clear();
@@ -91,6 +111,9 @@ void Config::set_color_theme(ColorTheme value) { color_theme_ = value; }
 Config::Sort Config::sort() const { return sort_; }
 void Config::set_sort(Sort value) { sort_ = value; }
 
+Config::Collate Config::collate() const { return collate_; }
+void Config::set_collate(Collate value) { collate_ = value; }
+
 Config::Report Config::report() const { return report_; }
 void Config::set_report(Report value) { report_ = value; }
 
@@ -106,6 +129,27 @@ void Config::set_almost_all(bool value) { almost_all_ = value; }
 bool Config::git_status() const { return git_status_; }
 void Config::set_git_status(bool value) { git_status_ = value; }
 
+bool Config::git_diffstat() const { return git_diffstat_; }
+void Config::set_git_diffstat(bool value) { git_diffstat_ = value; }
+
+std::size_t Config::git_jobs() const { return git_jobs_; }
+void Config::set_git_jobs(std::size_t value) { git_jobs_ = value; }
+
+bool Config::prompt_summary() const { return prompt_summary_; }
+void Config::set_prompt_summary(bool value) { prompt_summary_ = value; }
+
+bool Config::prompt_cache() const { return prompt_cache_; }
+void Config::set_prompt_cache(bool value) { prompt_cache_ = value; }
+
+bool Config::progress() const { return progress_; }
+void Config::set_progress(bool value) { progress_ = value; }
+
+bool Config::background() const { return background_; }
+void Config::set_background(bool value) { background_ = value; }
+
+std::uint64_t Config::max_ops_per_sec() const { return max_ops_per_sec_; }
+void Config::set_max_ops_per_sec(std::uint64_t value) { max_ops_per_sec_ = value; }
+
 bool Config::group_dirs_first() const { return group_dirs_first_; }
 void Config::set_group_dirs_first(bool value) { group_dirs_first_ = value; }
 
@@ -172,6 +216,15 @@ void Config::set_zero_terminate(bool value) { zero_terminate_ = value; }
 bool Config::show_block_size() const { return show_block_size_; }
 void Config::set_show_block_size(bool value) { show_block_size_ = value; }
 
+bool Config::sniff() const { return sniff_; }
+void Config::set_sniff(bool value) { sniff_ = value; }
+
+Config::HashAlgorithm Config::hash_algorithm() const { return hash_algorithm_; }
+void Config::set_hash_algorithm(HashAlgorithm value) { hash_algorithm_ = value; }
+
+bool Config::dupes() const { return dupes_; }
+void Config::set_dupes(bool value) { dupes_ = value; }
+
 bool Config::perf_logging() const { return perf_logging_; }
 void Config::set_perf_logging(bool value) { perf_logging_ = value; }
 
@@ -184,6 +237,9 @@ void Config::set_db_icon_entry(DbIconEntry value) { db_icon_entry_ = std::move(v
 const Config::DbAliasEntry& Config::db_alias_entry() const { return db_alias_entry_; }
 void Config::set_db_alias_entry(DbAliasEntry value) { db_alias_entry_ = std::move(value); }
 
+const std::string& Config::db_search() const { return db_search_; }
+void Config::set_db_search(std::string value) { db_search_ = std::move(value); }
+
 const std::optional<std::string>& Config::theme_name() const { return theme_name_; }
 void Config::set_theme_name(std::optional<std::string> value) { theme_name_ = std::move(value); }
 
@@ -195,6 +251,33 @@ const std::optional<int>& Config::output_width() const { return output_width_; }
 void Config::set_output_width(std::optional<int> value) { output_width_ = std::move(value); }
 void Config::clear_output_width() { output_width_.reset(); }
 
+const std::optional<uintmax_t>& Config::memory_limit() const { return memory_limit_; }
+void Config::set_memory_limit(std::optional<uintmax_t> value) { memory_limit_ = std::move(value); }
+void Config::clear_memory_limit() { memory_limit_.reset(); }
+
+const std::optional<Config::Shard>& Config::shard() const { return shard_; }
+void Config::set_shard(std::optional<Shard> value) { shard_ = std::move(value); }
+void Config::clear_shard() { shard_.reset(); }
+
+std::size_t Config::shard_depth() const { return shard_depth_; }
+void Config::set_shard_depth(std::size_t value) { shard_depth_ = value; }
+
+const std::string& Config::checkpoint_file() const { return checkpoint_file_; }
+void Config::set_checkpoint_file(std::string value) { checkpoint_file_ = std::move(value); }
+
+bool Config::resume() const { return resume_; }
+void Config::set_resume(bool value) { resume_ = value; }
+
+bool Config::one_file_system() const { return one_file_system_; }
+void Config::set_one_file_system(bool value) { one_file_system_ = value; }
+
+const std::vector<std::string>& Config::skip_fs() const { return skip_fs_; }
+void Config::set_skip_fs(std::vector<std::string> value) { skip_fs_ = std::move(value); }
+
+const std::optional<std::chrono::milliseconds>& Config::stat_timeout() const { return stat_timeout_; }
+void Config::set_stat_timeout(std::optional<std::chrono::milliseconds> value) { stat_timeout_ = std::move(value); }
+void Config::clear_stat_timeout() { stat_timeout_.reset(); }
+
 const std::string& Config::time_style() const { return time_style_; }
 void Config::set_time_style(std::string value) { time_style_ = std::move(value); }
 
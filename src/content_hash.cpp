@@ -0,0 +1,478 @@
+#include "content_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+#include "cancellation.h"
+#include "perf.h"
+#include "resources.h"
+
+namespace nls {
+
+namespace {
+
+constexpr std::size_t kReadBlock = 1u << 20;
+constexpr std::size_t kMaxThreads = 8;
+// About 100 bytes each on disk.
+constexpr std::size_t kMaxCacheRecords = 50000;
+
+// FIPS 180-4 SHA-256, processed one 64-byte block at a time.
+class Sha256 {
+public:
+    void Update(const unsigned char* data, std::size_t length) {
+        total_ += length;
+        if (buffered_ > 0) {
+            const std::size_t take = std::min(length, block_.size() - buffered_);
+            std::memcpy(block_.data() + buffered_, data, take);
+            buffered_ += take;
+            data += take;
+            length -= take;
+            if (buffered_ < block_.size()) {
+                return;
+            }
+            Compress(block_.data());
+            buffered_ = 0;
+        }
+        while (length >= block_.size()) {
+            Compress(data);
+            data += block_.size();
+            length -= block_.size();
+        }
+        std::memcpy(block_.data(), data, length);
+        buffered_ = length;
+    }
+
+    std::array<unsigned char, 32> Finish() {
+        const std::uint64_t bit_length = total_ * 8;
+        const unsigned char pad = 0x80;
+        Update(&pad, 1);
+        const unsigned char zero = 0;
+        while (buffered_ != 56) {
+            Update(&zero, 1);
+        }
+        std::array<unsigned char, 8> length_bytes{};
+        for (int i = 0; i < 8; ++i) {
+            length_bytes[i] = static_cast<unsigned char>(bit_length >> (56 - 8 * i));
+        }
+        Update(length_bytes.data(), length_bytes.size());
+
+        std::array<unsigned char, 32> digest{};
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                digest[i * 4 + j] = static_cast<unsigned char>(state_[i] >> (24 - 8 * j));
+            }
+        }
+        return digest;
+    }
+
+private:
+    static constexpr std::array<std::uint32_t, 64> kRound{
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    static constexpr std::uint32_t Rotr(std::uint32_t value, int bits) noexcept {
+        return (value >> bits) | (value << (32 - bits));
+    }
+
+    void Compress(const unsigned char* chunk) noexcept {
+        std::array<std::uint32_t, 64> w{};
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<std::uint32_t>(chunk[i * 4]) << 24) |
+                   (static_cast<std::uint32_t>(chunk[i * 4 + 1]) << 16) |
+                   (static_cast<std::uint32_t>(chunk[i * 4 + 2]) << 8) |
+                   static_cast<std::uint32_t>(chunk[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const std::uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const std::uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        std::uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; ++i) {
+            const std::uint32_t s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+            const std::uint32_t choose = (e & f) ^ (~e & g);
+            const std::uint32_t t1 = h + s1 + choose + kRound[i] + w[i];
+            const std::uint32_t s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+            const std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint32_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+        state_[4] += e;
+        state_[5] += f;
+        state_[6] += g;
+        state_[7] += h;
+    }
+
+    std::array<std::uint32_t, 8> state_{
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    std::array<unsigned char, 64> block_{};
+    std::size_t buffered_ = 0;
+    std::uint64_t total_ = 0;
+};
+
+std::string ToHex(const unsigned char* bytes, std::size_t length) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string out;
+    out.resize(length * 2);
+    for (std::size_t i = 0; i < length; ++i) {
+        out[i * 2] = kDigits[bytes[i] >> 4];
+        out[i * 2 + 1] = kDigits[bytes[i] & 0x0f];
+    }
+    return out;
+}
+
+// Calls consume(data, length) for each block of the file; returns false on
+// a read error.
+template <typename Consume>
+bool ReadBlocks(const std::filesystem::path& path, std::vector<unsigned char>& buffer, Consume&& consume) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0) {
+        return false;
+    }
+#    ifdef POSIX_FADV_SEQUENTIAL
+    (void)::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#    endif
+    bool ok = true;
+    while (true) {
+        const ssize_t count = ::read(fd, buffer.data(), buffer.size());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+        consume(buffer.data(), static_cast<std::size_t>(count));
+    }
+    ::close(fd);
+    return ok;
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        return false;
+    }
+    while (stream) {
+        stream.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        const std::streamsize count = stream.gcount();
+        if (count > 0) {
+            consume(buffer.data(), static_cast<std::size_t>(count));
+        }
+    }
+    return stream.eof();
+#endif
+}
+
+std::string HashWithBuffer(const std::filesystem::path& path,
+                           Config::HashAlgorithm algorithm,
+                           std::vector<unsigned char>& buffer) {
+    if (algorithm == Config::HashAlgorithm::Sha256) {
+        Sha256 sha;
+        if (!ReadBlocks(path, buffer, [&](const unsigned char* data, std::size_t length) { sha.Update(data, length); })) {
+            return {};
+        }
+        const auto digest = sha.Finish();
+        return ToHex(digest.data(), digest.size());
+    }
+
+    XXH3_state_t state;
+    XXH3_64bits_reset(&state);
+    if (!ReadBlocks(path, buffer, [&](const unsigned char* data, std::size_t length) {
+            XXH3_64bits_update(&state, data, length);
+        })) {
+        return {};
+    }
+    XXH64_canonical_t canonical;
+    XXH64_canonicalFromHash(&canonical, XXH3_64bits_digest(&state));
+    return ToHex(canonical.digest, sizeof(canonical.digest));
+}
+
+}  // namespace
+
+ContentHasher::ContentHasher(Config::HashAlgorithm algorithm, std::filesystem::path cache_file)
+    : algorithm_(algorithm), cache_file_(std::move(cache_file)) {}
+
+ContentHasher::~ContentHasher() {
+    SaveCache();
+}
+
+std::filesystem::path ContentHasher::DefaultCacheFile() {
+    const std::filesystem::path config_dir = ResourceManager::userConfigDir();
+    if (config_dir.empty()) {
+        return {};
+    }
+    return config_dir.parent_path() / "cache" / "content-hashes";
+}
+
+const char* ContentHasher::AlgorithmName() const noexcept {
+    return algorithm_ == Config::HashAlgorithm::Sha256 ? "sha256" : "xxh3";
+}
+
+bool ContentHasher::KeyFor(const FileInfo& info, FileKey& key) {
+#ifndef _WIN32
+    // The scan fills device and inode from lstat (stat with -L); inode 0
+    // means that failed.
+    if (info.inode == 0) {
+        return false;
+    }
+    key.device = static_cast<std::uint64_t>(info.device);
+    key.inode = static_cast<std::uint64_t>(info.inode);
+    key.size = static_cast<std::uint64_t>(info.size);
+    key.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(info.mtime.time_since_epoch()).count();
+    return true;
+#else
+    // No stable file identity without opening the file; skip the cache.
+    (void)info;
+    (void)key;
+    return false;
+#endif
+}
+
+void ContentHasher::Remember(const FileKey& key, std::string digest) {
+    // A new size or mtime for a known (device, inode) means the file changed,
+    // so the digest stored under its old key can never be used again.
+    auto [latest, inserted] = latest_.try_emplace(FileKey{key.device, key.inode, 0, 0}, key);
+    if (!inserted && latest->second != key) {
+        cache_.erase(latest->second);
+        latest->second = key;
+        cache_dirty_ = true;
+    }
+    cache_[key] = std::move(digest);
+    order_.push_back(key);
+}
+
+void ContentHasher::LoadCache() {
+    cache_loaded_ = true;
+    if (cache_file_.empty()) {
+        return;
+    }
+    std::ifstream in(cache_file_);
+    if (!in) {
+        return;
+    }
+
+    // One record per line, oldest first: algorithm device inode size
+    // mtime_ns digest.
+    const std::string_view algorithm = AlgorithmName();
+    std::size_t records = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        ++records;
+        std::array<std::string_view, 6> fields{};
+        std::string_view rest(line);
+        std::size_t count = 0;
+        while (count < fields.size() && !rest.empty()) {
+            const auto space = rest.find(' ');
+            fields[count++] = rest.substr(0, space);
+            rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+        }
+        if (count != fields.size()) {
+            cache_dirty_ = true;
+            continue;
+        }
+        if (fields[0] != algorithm) {
+            foreign_lines_.push_back(std::move(line));
+            continue;
+        }
+
+        FileKey key;
+        const auto parse = [](std::string_view text, auto& value) {
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            return result.ec == std::errc() && result.ptr == text.data() + text.size();
+        };
+        if (!parse(fields[1], key.device) || !parse(fields[2], key.inode) || !parse(fields[3], key.size) ||
+            !parse(fields[4], key.mtime_ns)) {
+            cache_dirty_ = true;
+            continue;
+        }
+        Remember(key, std::string(fields[5]));
+    }
+    if (records > kMaxCacheRecords) {
+        cache_dirty_ = true;
+    }
+}
+
+void ContentHasher::SaveCache() {
+    if (!cache_dirty_ || cache_file_.empty()) {
+        return;
+    }
+
+    // Newest first: each key once, at its latest use, up to the cap shared
+    // with the other algorithm's records.
+    std::vector<FileKey> keep;
+    std::unordered_set<FileKey, FileKeyHash> seen;
+    for (auto it = order_.rbegin(); it != order_.rend() && keep.size() < kMaxCacheRecords; ++it) {
+        if (cache_.contains(*it) && seen.insert(*it).second) {
+            keep.push_back(*it);
+        }
+    }
+    const std::size_t foreign = std::min(foreign_lines_.size(), kMaxCacheRecords - keep.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_file_.parent_path(), ec);
+    std::filesystem::path temp = cache_file_;
+    temp += "." + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        for (std::size_t i = foreign_lines_.size() - foreign; i < foreign_lines_.size(); ++i) {
+            out << foreign_lines_[i] << '\n';
+        }
+        for (auto it = keep.rbegin(); it != keep.rend(); ++it) {
+            out << AlgorithmName() << ' ' << it->device << ' ' << it->inode << ' ' << it->size << ' '
+                << it->mtime_ns << ' ' << cache_.at(*it) << '\n';
+        }
+        if (!out.flush()) {
+            out.close();
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+    // Several listings may finish at once; the rename keeps the file whole.
+    std::filesystem::rename(temp, cache_file_, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+    cache_dirty_ = false;
+}
+
+void ContentHasher::HashEntries(std::vector<Entry>& entries, bool only_size_collisions) {
+    auto& perf_manager = perf::Manager::Instance();
+    const bool perf_enabled = perf_manager.enabled();
+    std::optional<perf::Timer> timer;
+    if (perf_enabled) {
+        timer.emplace("content_hash::hash_entries");
+    }
+
+    std::vector<std::size_t> candidates;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const FileInfo& info = entries[i].info;
+        if (info.is_dir || info.is_symlink || info.is_socket || info.is_block_device || info.is_char_device ||
+            info.stat_timed_out) {
+            continue;
+        }
+        candidates.push_back(i);
+    }
+    if (only_size_collisions) {
+        std::unordered_map<std::uintmax_t, std::size_t> size_counts;
+        for (std::size_t index : candidates) {
+            ++size_counts[entries[index].info.size];
+        }
+        std::erase_if(candidates, [&](std::size_t index) { return size_counts[entries[index].info.size] < 2; });
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    if (!cache_loaded_) {
+        LoadCache();
+    }
+
+    std::vector<std::size_t> pending;
+    std::vector<FileKey> pending_keys;
+    std::vector<bool> pending_has_key;
+    for (std::size_t index : candidates) {
+        FileKey key;
+        const bool has_key = KeyFor(entries[index].info, key);
+        if (has_key) {
+            auto cached = cache_.find(key);
+            if (cached != cache_.end()) {
+                entries[index].info.content_hash = cached->second;
+                order_.push_back(key);
+                continue;
+            }
+        }
+        pending.push_back(index);
+        pending_keys.push_back(key);
+        pending_has_key.push_back(has_key);
+    }
+    if (perf_enabled) {
+        perf_manager.IncrementCounter("content_hash::cache_hits", candidates.size() - pending.size());
+        perf_manager.IncrementCounter("content_hash::files_hashed", pending.size());
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    std::vector<std::string> digests(pending.size());
+    std::atomic<std::size_t> next{0};
+    const auto worker = [&]() {
+        std::vector<unsigned char> buffer(kReadBlock);
+        for (std::size_t i = next.fetch_add(1); i < pending.size() && !Cancellation::Requested();
+             i = next.fetch_add(1)) {
+            digests[i] = HashWithBuffer(entries[pending[i]].info.path, algorithm_, buffer);
+        }
+    };
+    const std::size_t hardware = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    const std::size_t thread_count = std::min({kMaxThreads, hardware, pending.size()});
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        if (digests[i].empty()) {
+            continue;
+        }
+        if (pending_has_key[i]) {
+            Remember(pending_keys[i], digests[i]);
+            cache_dirty_ = true;
+        }
+        entries[pending[i]].info.content_hash = std::move(digests[i]);
+    }
+}
+
+}  // namespace nls
@@ -0,0 +1,165 @@
+#include "content_sniffer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+#include "cancellation.h"
+
+namespace nls {
+
+namespace {
+
+struct MagicSignature {
+    std::string_view magic;
+    SniffResult result;
+};
+
+using namespace std::string_view_literals;
+
+constexpr std::array kSignatures{
+    MagicSignature{"\x7f" "ELF"sv, {"elf", "exe"}},
+    MagicSignature{"\x89PNG\r\n\x1a\n"sv, {"png", {}}},
+    MagicSignature{"%PDF-"sv, {"pdf", {}}},
+    MagicSignature{"SQLite format 3\0"sv, {"sqlite", "db"}},
+    MagicSignature{"\x28\xb5\x2f\xfd"sv, {"zst", "gz"}},
+    MagicSignature{"\x1f\x8b"sv, {"gz", {}}},
+};
+
+struct Interpreter {
+    std::string_view prefix;
+    SniffResult result;
+};
+
+// Matched against the interpreter's basename, so "python3.12" maps to py.
+constexpr std::array kInterpreters{
+    Interpreter{"python", {"py", "sh"}},
+    Interpreter{"perl", {"pl", "sh"}},
+    Interpreter{"ruby", {"rb", "sh"}},
+    Interpreter{"node", {"js", "sh"}},
+    Interpreter{"lua", {"lua", "sh"}},
+    Interpreter{"php", {"php", "sh"}},
+};
+
+// Files per reader thread below which spawning threads costs more than the
+// reads themselves.
+constexpr std::size_t kFilesPerThread = 32;
+constexpr std::size_t kMaxThreads = 8;
+
+bool IsBlank(char ch) noexcept {
+    return ch == ' ' || ch == '\t';
+}
+
+std::string_view NextWord(std::string_view& line) noexcept {
+    while (!line.empty() && IsBlank(line.front())) {
+        line.remove_prefix(1);
+    }
+    std::size_t end = 0;
+    while (end < line.size() && !IsBlank(line[end])) {
+        ++end;
+    }
+    std::string_view word = line.substr(0, end);
+    line.remove_prefix(end);
+    return word;
+}
+
+std::string_view Basename(std::string_view path) noexcept {
+    const auto slash = path.find_last_of('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+}  // namespace
+
+SniffResult ContentSniffer::Classify(std::string_view head) noexcept {
+    for (const auto& signature : kSignatures) {
+        if (head.starts_with(signature.magic)) {
+            return signature.result;
+        }
+    }
+    if (head.starts_with("#!")) {
+        return ClassifyShebang(head.substr(2));
+    }
+    return {};
+}
+
+SniffResult ContentSniffer::ClassifyShebang(std::string_view head) noexcept {
+    std::string_view line = head.substr(0, head.find('\n'));
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    std::string_view program = Basename(NextWord(line));
+    if (program == "env") {
+        // Skip env's own options (e.g. "env -S python3 -u").
+        do {
+            program = Basename(NextWord(line));
+        } while (program.starts_with('-'));
+    }
+    if (program.empty()) {
+        return {};
+    }
+
+    for (const auto& interpreter : kInterpreters) {
+        if (program.starts_with(interpreter.prefix)) {
+            return interpreter.result;
+        }
+    }
+    return {"sh", {}};
+}
+
+std::size_t ContentSniffer::ReadHead(const std::filesystem::path& path, char* buffer) noexcept {
+#ifndef _WIN32
+    // O_NONBLOCK keeps a file replaced by a FIFO since the scan from
+    // stalling the listing.
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        return 0;
+    }
+    const ssize_t count = ::pread(fd, buffer, kHeadBytes, 0);
+    ::close(fd);
+    return count > 0 ? static_cast<std::size_t>(count) : 0;
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        return 0;
+    }
+    stream.read(buffer, static_cast<std::streamsize>(kHeadBytes));
+    return static_cast<std::size_t>(std::max<std::streamsize>(stream.gcount(), 0));
+#endif
+}
+
+std::vector<SniffResult> ContentSniffer::ClassifyFiles(const std::vector<std::filesystem::path>& paths) {
+    std::vector<SniffResult> results(paths.size());
+    std::atomic<std::size_t> next{0};
+
+    const auto worker = [&]() {
+        std::array<char, kHeadBytes> buffer{};
+        for (std::size_t index = next.fetch_add(1); index < paths.size() && !Cancellation::Requested();
+             index = next.fetch_add(1)) {
+            const std::size_t length = ReadHead(paths[index], buffer.data());
+            results[index] = Classify(std::string_view(buffer.data(), length));
+        }
+    };
+
+    const std::size_t hardware = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    const std::size_t thread_count = std::min({kMaxThreads, hardware, paths.size() / kFilesPerThread});
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+}  // namespace nls
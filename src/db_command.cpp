@@ -5,6 +5,7 @@
 #include <cctype>
 #include <charconv>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <limits>
@@ -141,55 +142,185 @@ std::vector<std::string> WrapCellText(std::string_view text, std::size_t width)
     return lines;
 }
 
-bool MatchesWildcard(std::string_view pattern, std::string_view value)
+// --name filters use shell-style '*' and '?' wildcards. They are translated
+// to GLOB patterns over lower(name) so SQLite evaluates them against the
+// lower(name) indices created by EnsureSchema; the literal prefix before the
+// first wildcard is also turned into a range so the index narrows the scan.
+struct NameFilter {
+    std::string pattern;
+    std::string lower_bound;
+    std::string upper_bound;
+    bool exact = false;
+};
+
+NameFilter TranslateNameFilter(std::string_view filter)
 {
-    if (pattern.empty()) {
-        return true;
+    NameFilter result;
+    const std::size_t wildcard = filter.find_first_of("*?");
+    if (wildcard == std::string_view::npos) {
+        result.pattern = std::string(filter);
+        result.exact = true;
+        return result;
+    }
+
+    result.pattern.reserve(filter.size() + 4);
+    for (char ch : filter) {
+        if (ch == '[') {
+            result.pattern += "[[]";
+        } else {
+            result.pattern.push_back(ch);
+        }
     }
 
-    std::size_t p = 0;
-    std::size_t v = 0;
-    std::size_t star = std::string::npos;
-    std::size_t match = 0;
+    result.lower_bound = std::string(filter.substr(0, wildcard));
+    result.upper_bound = result.lower_bound;
+    while (!result.upper_bound.empty()) {
+        auto& last = reinterpret_cast<unsigned char&>(result.upper_bound.back());
+        if (last != 0xFF) {
+            ++last;
+            break;
+        }
+        result.upper_bound.pop_back();
+    }
+    return result;
+}
 
-    while (v < value.size()) {
-        if (p < pattern.size()) {
-            char pc = pattern[p];
-            if (pc == '?') {
-                ++p;
-                ++v;
-                continue;
-            }
-            if (pc == '*') {
-                star = p++;
-                match = v;
-                continue;
-            }
-            if (pc == value[v]) {
-                ++p;
-                ++v;
-                continue;
+std::string NamePredicate(std::string_view column, const NameFilter& filter)
+{
+    const std::string expr = "lower(" + std::string(column) + ")";
+    if (filter.exact) {
+        return expr + " = :filter";
+    }
+    std::string predicate = expr + " GLOB :filter";
+    if (!filter.lower_bound.empty()) {
+        predicate += " AND " + expr + " >= :lower";
+    }
+    if (!filter.upper_bound.empty()) {
+        predicate += " AND " + expr + " < :upper";
+    }
+    return predicate;
+}
+
+// --search words are matched as prefixes against the FTS5 index when a
+// database has one, and as substrings of name/description/used_by otherwise.
+std::string BuildMatchExpression(std::string_view search)
+{
+    std::string expression;
+    std::size_t pos = 0;
+    while (pos < search.size()) {
+        while (pos < search.size() && std::isspace(static_cast<unsigned char>(search[pos]))) {
+            ++pos;
+        }
+        std::size_t end = pos;
+        while (end < search.size() && !std::isspace(static_cast<unsigned char>(search[end]))) {
+            ++end;
+        }
+        if (end == pos) {
+            break;
+        }
+        if (!expression.empty()) {
+            expression.push_back(' ');
+        }
+        expression.push_back('"');
+        for (char ch : search.substr(pos, end - pos)) {
+            if (ch == '"') {
+                expression.push_back('"');
             }
+            expression.push_back(ch);
         }
-        if (star != std::string::npos) {
-            p = star + 1;
-            ++match;
-            v = match;
-            continue;
+        expression += "\"*";
+        pos = end;
+    }
+    return expression;
+}
+
+std::string BuildLikePattern(std::string_view search)
+{
+    std::string pattern = "%";
+    for (char ch : search) {
+        if (ch == '%' || ch == '_' || ch == '\\') {
+            pattern.push_back('\\');
         }
-        return false;
+        pattern.push_back(ch);
+    }
+    pattern.push_back('%');
+    return pattern;
+}
+
+bool FtsAvailable()
+{
+    static const bool available = sqlite3_compileoption_used("ENABLE_FTS5") != 0;
+    return available;
+}
+
+std::string QuoteIdentifier(std::string_view name)
+{
+    std::string quoted = "\"";
+    for (char ch : name) {
+        if (ch == '"') {
+            quoted.push_back('"');
+        }
+        quoted.push_back(ch);
     }
+    quoted.push_back('"');
+    return quoted;
+}
 
-    while (p < pattern.size() && pattern[p] == '*') {
-        ++p;
+void BindNamed(sqlite3_stmt* stmt, const char* name, const std::string& value)
+{
+    const int index = sqlite3_bind_parameter_index(stmt, name);
+    if (index > 0) {
+        sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
     }
-    return p == pattern.size();
 }
 
+// Walks the rows of a prepared statement as formatted table cells. The
+// cursor can be rewound, so a table is measured in one pass and printed in a
+// second without ever holding more than one row.
+class RowCursor {
+public:
+    // measuring is true on the first pass, before the cursor is rewound.
+    using Formatter = std::function<void(sqlite3_stmt*, std::vector<std::string>&, bool measuring)>;
+
+    RowCursor(sqlite3_stmt* stmt, Formatter format)
+        : stmt_(stmt), format_(std::move(format))
+    {}
+
+    bool Next(std::vector<std::string>& cells)
+    {
+        status_ = sqlite3_step(stmt_);
+        if (status_ != SQLITE_ROW) {
+            return false;
+        }
+        cells.clear();
+        format_(stmt_, cells, measuring_);
+        return true;
+    }
+
+    void Rewind()
+    {
+        sqlite3_reset(stmt_);
+        status_ = SQLITE_OK;
+        measuring_ = false;
+    }
+
+    [[nodiscard]] bool failed() const noexcept
+    {
+        return status_ != SQLITE_OK && status_ != SQLITE_DONE && status_ != SQLITE_ROW;
+    }
+
+private:
+    sqlite3_stmt* stmt_;
+    Formatter format_;
+    int status_ = SQLITE_OK;
+    bool measuring_ = true;
+};
+
 std::vector<std::size_t> ComputeColumnWidths(const std::vector<std::string>& headers,
-                                             const std::vector<std::vector<std::string>>& rows,
+                                             RowCursor& rows,
                                              std::size_t gap,
-                                             std::size_t terminal_width) {
+                                             std::size_t terminal_width,
+                                             std::size_t& row_count) {
     const std::size_t column_count = headers.size();
     std::vector<std::size_t> widths(column_count, 0);
     std::vector<std::size_t> min_widths(column_count, 0);
@@ -203,7 +334,10 @@ std::vector<std::size_t> ComputeColumnWidths(const std::vector<std::string>& hea
         min_widths[col] = std::clamp<std::size_t>(header_len, kDefaultMin, kDefaultMax);
     }
 
-    for (const auto& row : rows) {
+    row_count = 0;
+    std::vector<std::string> row;
+    while (rows.Next(row)) {
+        ++row_count;
         for (std::size_t col = 0; col < column_count && col < row.size(); ++col) {
             std::size_t len = row[col].size();
             widths[col] = std::clamp<std::size_t>(std::max(widths[col], len), min_widths[col], kDefaultMax);
@@ -244,17 +378,22 @@ std::vector<std::size_t> ComputeColumnWidths(const std::vector<std::string>& hea
     return widths;
 }
 
-void RenderTable(std::ostream& os,
-                 const std::vector<std::string>& headers,
-                 const std::vector<std::vector<std::string>>& rows) {
+// Prints the rows produced by the cursor and returns how many there were.
+std::size_t RenderTable(std::ostream& os,
+                        const std::vector<std::string>& headers,
+                        RowCursor& rows) {
     if (headers.empty()) {
-        return;
+        return 0;
     }
 
     constexpr std::size_t kGap = 2;
     int term_width = Platform::isOutputTerminal() ? Platform::terminalWidth() : 0;
     std::size_t effective_width = term_width > 0 ? static_cast<std::size_t>(std::max(term_width, 40)) : 0;
-    std::vector<std::size_t> widths = ComputeColumnWidths(headers, rows, kGap, effective_width);
+    std::size_t row_count = 0;
+    std::vector<std::size_t> widths = ComputeColumnWidths(headers, rows, kGap, effective_width, row_count);
+    if (rows.failed()) {
+        return 0;
+    }
     const std::size_t column_count = headers.size();
     std::string gap(kGap, ' ');
 
@@ -296,9 +435,12 @@ void RenderTable(std::ostream& os,
     }
     os << '\n';
 
-    for (const auto& row : rows) {
+    rows.Rewind();
+    std::vector<std::string> row;
+    while (rows.Next(row)) {
         print_row(row);
     }
+    return row_count;
 }
 
 }  // namespace
@@ -314,7 +456,8 @@ DatabaseInspector::DatabaseInspector(std::vector<std::filesystem::path> candidat
 
 int DatabaseInspector::Execute(Config::DbAction action,
                                const Config::DbIconEntry& icon_entry,
-                               const Config::DbAliasEntry& alias_entry)
+                               const Config::DbAliasEntry& alias_entry,
+                               std::string_view search)
 {
     if (action == Config::DbAction::None) {
         return 0;
@@ -325,13 +468,14 @@ int DatabaseInspector::Execute(Config::DbAction action,
         raw_filter = StringUtils::Trim(alias_entry.name);
     }
     std::string filter = StringUtils::ToLower(raw_filter);
+    std::string search_text = StringUtils::Trim(search);
 
     switch (action) {
         case Config::DbAction::ShowFiles:
         case Config::DbAction::ShowFolders:
         case Config::DbAction::ShowFileAliases:
         case Config::DbAction::ShowFolderAliases: {
-            if (!EnsureLoaded()) {
+            if (!EnsureOpened()) {
                 if (!had_error_) {
                     std::cerr << "nls: error: configuration database not found\n";
                 } else if (!last_error_.empty()) {
@@ -343,17 +487,13 @@ int DatabaseInspector::Execute(Config::DbAction action,
             }
             switch (action) {
                 case Config::DbAction::ShowFiles:
-                    PrintIcons(files_, filter);
-                    break;
+                    return PrintIcons("Files", filter, search_text);
                 case Config::DbAction::ShowFolders:
-                    PrintIcons(folders_, filter);
-                    break;
+                    return PrintIcons("Folders", filter, search_text);
                 case Config::DbAction::ShowFileAliases:
-                    PrintAliases(file_aliases_, files_, filter);
-                    break;
+                    return PrintAliases("File_Aliases", "Files", filter);
                 case Config::DbAction::ShowFolderAliases:
-                    PrintAliases(folder_aliases_, folders_, filter);
-                    break;
+                    return PrintAliases("Folder_Aliases", "Folders", filter);
                 default:
                     break;
             }
@@ -373,85 +513,128 @@ int DatabaseInspector::Execute(Config::DbAction action,
     }
 }
 
-bool DatabaseInspector::EnsureLoaded()
+bool DatabaseInspector::EnsureOpened()
 {
-    if (loaded_) {
+    if (opened_) {
         return true;
     }
     if (candidates_.empty()) {
         had_error_ = false;
         return false;
     }
-    loaded_ = LoadAllSources();
-    return loaded_;
+    opened_ = OpenSources();
+    return opened_;
 }
 
-bool DatabaseInspector::LoadAllSources()
+bool DatabaseInspector::OpenSources()
 {
-    bool any_loaded = false;
-
-    for (auto it = candidates_.rbegin(); it != candidates_.rend(); ++it) {
-        any_loaded = LoadSingleSource(*it) || any_loaded;
+    // The highest-priority candidate that opens becomes the main schema and
+    // the rest are attached to it, so every show query runs as one statement
+    // over all candidates instead of copying their rows into memory.
+    for (const auto& path : candidates_) {
+        if (!view_) {
+            std::string open_error;
+            auto db = OpenDatabase(path, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, open_error);
+            if (!db) {
+                had_error_ = true;
+                last_error_ = std::move(open_error);
+                if (!last_error_.empty()) {
+                    std::cerr << last_error_ << '\n';
+                }
+                continue;
+            }
+            auto tables = ReadTableNames(db.get(), "main");
+            if (!tables) {
+                had_error_ = true;
+                std::ostringstream oss;
+                oss << "nls: warning: unable to read configuration database '" << path
+                    << "': " << sqlite3_errmsg(db.get());
+                last_error_ = oss.str();
+                std::cerr << last_error_ << '\n';
+                continue;
+            }
+            view_ = std::move(db);
+            sources_.push_back(Source{"main", path, std::move(*tables)});
+            continue;
+        }
+        (void)AttachSource(path);
     }
-
-    return any_loaded;
+    return view_ != nullptr;
 }
 
-bool DatabaseInspector::LoadSingleSource(const std::filesystem::path& path)
+bool DatabaseInspector::AttachSource(const std::filesystem::path& path)
 {
-    std::string open_error;
-    SqliteDbPtr db(OpenDatabase(path, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, open_error));
-    if (!db) {
-        had_error_ = true;
-        last_error_ = std::move(open_error);
-        if (!last_error_.empty()) {
-            std::cerr << last_error_ << '\n';
-        }
+    sqlite3* db = view_.get();
+    if (static_cast<int>(sources_.size()) > sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1)) {
+        std::cerr << "nls: warning: too many configuration databases; ignoring '" << path << "'\n";
         return false;
     }
 
-    bool loaded = false;
-    bool path_had_error = false;
-    std::string path_error_message;
-
-    auto handle_result = [&](std::optional<std::string> result, std::string_view section) {
-        if (!result) {
-            loaded = true;
-            return;
-        }
-        if (!path_had_error) {
-            std::ostringstream oss;
-            oss << section << " - " << *result;
-            path_error_message = oss.str();
-        }
-        path_had_error = true;
-    };
-
-    handle_result(LoadIconTable(db.get(),
-        "SELECT name, icon, icon_class_name, Icon_UTF_16_codes, Icon_Hex_Code, description, used_by "
-        "FROM Files;",
-        files_), "Files table");
-    handle_result(LoadIconTable(db.get(),
-        "SELECT name, icon, icon_class_name, Icon_UTF_16_codes, Icon_Hex_Code, description, used_by "
-        "FROM Folders;",
-        folders_), "Folders table");
-    handle_result(LoadAliasTable(db.get(),
-        "SELECT alias, name FROM File_Aliases;",
-        file_aliases_), "File_Aliases table");
-    handle_result(LoadAliasTable(db.get(),
-        "SELECT alias, name FROM Folder_Aliases;",
-        folder_aliases_), "Folder_Aliases table");
-
-    if (path_had_error) {
+    std::string schema = "src" + std::to_string(sources_.size());
+    std::string sql = "ATTACH DATABASE ?1 AS " + QuoteIdentifier(schema) + ";";
+    sqlite3_stmt* stmt_raw = nullptr;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt_raw, nullptr);
+    if (rc == SQLITE_OK) {
+        SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
+        const std::string uri = MakeSqliteOpenPath(path, true, true);
+        sqlite3_bind_text(stmt.get(), 1, uri.c_str(), -1, SQLITE_TRANSIENT);
+        rc = sqlite3_step(stmt.get());
+    }
+    std::optional<std::unordered_set<std::string>> tables;
+    if (rc == SQLITE_DONE) {
+        tables = ReadTableNames(db, schema);
+    }
+    if (!tables) {
         had_error_ = true;
         std::ostringstream oss;
-        oss << "nls: warning: unable to read complete configuration database '" << path
-            << "': " << path_error_message;
+        oss << "nls: warning: failed to open config database '" << path << "': " << sqlite3_errmsg(db);
         last_error_ = oss.str();
         std::cerr << last_error_ << '\n';
+        if (rc == SQLITE_DONE) {
+            (void)ExecuteSimple(db, "DETACH DATABASE " + QuoteIdentifier(schema) + ";");
+        }
+        return false;
+    }
+    sources_.push_back(Source{std::move(schema), path, std::move(*tables)});
+    return true;
+}
+
+std::optional<std::unordered_set<std::string>> DatabaseInspector::ReadTableNames(sqlite3* db, std::string_view schema)
+{
+    std::string sql = "SELECT name FROM " + QuoteIdentifier(schema) +
+                      ".sqlite_master WHERE type IN ('table', 'view');";
+    sqlite3_stmt* stmt_raw = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt_raw, nullptr) != SQLITE_OK) {
+        return std::nullopt;
+    }
+    SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
+
+    std::unordered_set<std::string> tables;
+    int rc = SQLITE_OK;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        tables.insert(ExtractText(stmt.get(), 0));
+    }
+    if (rc != SQLITE_DONE) {
+        return std::nullopt;
     }
+    return tables;
+}
+
+bool DatabaseInspector::HasSourceWith(std::string_view table) const
+{
+    const std::string name(table);
+    return std::ranges::any_of(sources_, [&](const Source& source) { return source.tables.contains(name); });
+}
 
-    return loaded;
+void DatabaseInspector::WarnMissingTable(std::string_view table) const
+{
+    const std::string name(table);
+    for (const auto& source : sources_) {
+        if (!source.tables.contains(name)) {
+            std::cerr << "nls: warning: unable to read complete configuration database '" << source.path
+                      << "': " << table << " table - no such table: " << table << '\n';
+        }
+    }
 }
 
 std::vector<std::filesystem::path> DatabaseInspector::FilterReadable(std::vector<std::filesystem::path> paths)
@@ -640,7 +823,16 @@ bool DatabaseInspector::EnsureSchema(sqlite3* db)
         "CREATE TABLE IF NOT EXISTS Folder_Aliases ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "name TEXT NOT NULL COLLATE NOCASE,"
-        "alias TEXT NOT NULL UNIQUE COLLATE NOCASE);"
+        "alias TEXT NOT NULL UNIQUE COLLATE NOCASE);",
+
+        // Lookups and --name filters compare lower(name), which the NOCASE
+        // column indices cannot serve.
+        "CREATE INDEX IF NOT EXISTS IX_Files_lower_name ON Files(lower(name));",
+        "CREATE INDEX IF NOT EXISTS IX_Folders_lower_name ON Folders(lower(name));",
+        "CREATE INDEX IF NOT EXISTS IX_File_Aliases_lower_name ON File_Aliases(lower(name));",
+        "CREATE INDEX IF NOT EXISTS IX_File_Aliases_lower_alias ON File_Aliases(lower(alias));",
+        "CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_lower_name ON Folder_Aliases(lower(name));",
+        "CREATE INDEX IF NOT EXISTS IX_Folder_Aliases_lower_alias ON Folder_Aliases(lower(alias));"
     };
 
     for (auto statement : statements) {
@@ -648,6 +840,53 @@ bool DatabaseInspector::EnsureSchema(sqlite3* db)
             return false;
         }
     }
+    return EnsureSearchIndex(db, "Files") && EnsureSearchIndex(db, "Folders");
+}
+
+bool DatabaseInspector::EnsureSearchIndex(sqlite3* db, std::string_view table)
+{
+    // Builds without FTS5 fall back to LIKE scans for --search.
+    if (!FtsAvailable()) {
+        return true;
+    }
+
+    const std::string base(table);
+    const std::string fts = base + "_fts";
+    auto tables = ReadTableNames(db, "main");
+    if (!tables) {
+        std::cerr << "nls: error: " << sqlite3_errmsg(db) << '\n';
+        return false;
+    }
+    const bool created = !tables->contains(fts);
+
+    const std::string statements[] = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS " + fts + " USING fts5("
+        "name, description, used_by, content='" + base + "', content_rowid='id');",
+
+        "CREATE TRIGGER IF NOT EXISTS " + fts + "_ai AFTER INSERT ON " + base + " BEGIN "
+        "INSERT INTO " + fts + "(rowid, name, description, used_by) "
+        "VALUES (new.id, new.name, new.description, new.used_by); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS " + fts + "_ad AFTER DELETE ON " + base + " BEGIN "
+        "INSERT INTO " + fts + "(" + fts + ", rowid, name, description, used_by) "
+        "VALUES ('delete', old.id, old.name, old.description, old.used_by); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS " + fts + "_au AFTER UPDATE ON " + base + " BEGIN "
+        "INSERT INTO " + fts + "(" + fts + ", rowid, name, description, used_by) "
+        "VALUES ('delete', old.id, old.name, old.description, old.used_by); "
+        "INSERT INTO " + fts + "(rowid, name, description, used_by) "
+        "VALUES (new.id, new.name, new.description, new.used_by); END;",
+    };
+
+    for (const auto& statement : statements) {
+        if (!ExecuteSimple(db, statement)) {
+            return false;
+        }
+    }
+    // Databases created before the index existed need their rows indexed once.
+    if (created) {
+        return ExecuteSimple(db, "INSERT INTO " + fts + "(" + fts + ") VALUES ('rebuild');");
+    }
     return true;
 }
 
@@ -676,72 +915,6 @@ std::unique_ptr<sqlite3, void(*)(sqlite3*)> DatabaseInspector::OpenDatabase(cons
     return {raw, &CloseSqlite};
 }
 
-std::optional<std::string> DatabaseInspector::LoadIconTable(sqlite3* db, std::string_view sql, IconMap& target)
-{
-    sqlite3_stmt* stmt_raw = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.data(), static_cast<int>(sql.size()), &stmt_raw, nullptr);
-    if (rc != SQLITE_OK) {
-        return sqlite3_errmsg(db);
-    }
-
-    SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
-    sqlite3_stmt* handle = stmt.get();
-
-    while ((rc = sqlite3_step(handle)) == SQLITE_ROW) {
-        IconRecord record;
-        record.name = ExtractText(handle, 0);
-        if (record.name.empty()) {
-            continue;
-        }
-        record.icon = ExtractText(handle, 1);
-        record.icon_class = ExtractText(handle, 2);
-        record.icon_utf16 = ExtractCode(handle, 3);
-        record.icon_hex = ExtractCode(handle, 4);
-        record.description = ExtractText(handle, 5);
-        record.used_by = ExtractText(handle, 6);
-
-        std::string key = StringUtils::ToLower(record.name);
-        target[std::move(key)] = std::move(record);
-    }
-
-    if (rc != SQLITE_DONE) {
-        return sqlite3_errmsg(db);
-    }
-
-    return std::nullopt;
-}
-
-std::optional<std::string> DatabaseInspector::LoadAliasTable(sqlite3* db, std::string_view sql, AliasMap& target)
-{
-    sqlite3_stmt* stmt_raw = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.data(), static_cast<int>(sql.size()), &stmt_raw, nullptr);
-    if (rc != SQLITE_OK) {
-        return sqlite3_errmsg(db);
-    }
-
-    SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
-    sqlite3_stmt* handle = stmt.get();
-
-    while ((rc = sqlite3_step(handle)) == SQLITE_ROW) {
-        AliasRecord record;
-        record.alias = ExtractText(handle, 0);
-        record.target_name = ExtractText(handle, 1);
-        if (record.alias.empty() || record.target_name.empty()) {
-            continue;
-        }
-        record.target_key = StringUtils::ToLower(record.target_name);
-
-        std::string alias_key = StringUtils::ToLower(record.alias);
-        target[std::move(alias_key)] = std::move(record);
-    }
-
-    if (rc != SQLITE_DONE) {
-        return sqlite3_errmsg(db);
-    }
-
-    return std::nullopt;
-}
-
 std::string DatabaseInspector::FormatUtf16(std::optional<std::uint32_t> code)
 {
     if (!code) {
@@ -1274,111 +1447,231 @@ int DatabaseInspector::ApplyAliasEntry(AliasTarget target, const Config::DbAlias
     return 0;
 }
 
-void DatabaseInspector::PrintIcons(const IconMap& icons, std::string_view filter) const
+std::string DatabaseInspector::ShadowFilter(std::size_t index,
+                                            std::string_view table,
+                                            std::string_view column) const
 {
-    std::vector<const IconRecord*> records;
-    records.reserve(icons.size());
-    for (const auto& [key, record] : icons) {
-        if (!MatchesWildcard(filter, key)) {
+    // A row is shadowed when a higher-priority source (lower index) has an
+    // entry with the same key; excluding it per source keeps every branch of
+    // the merged query index-ordered, so no GROUP BY has to buffer the rows.
+    const std::string table_name(table);
+    const std::string name(column);
+    std::string clause;
+    for (std::size_t higher = 0; higher < index; ++higher) {
+        const Source& source = sources_[higher];
+        if (!source.tables.contains(table_name)) {
             continue;
         }
-        records.push_back(&record);
+        clause += " AND NOT EXISTS (SELECT 1 FROM " + QuoteIdentifier(source.schema) + "." +
+                  QuoteIdentifier(table_name) + " AS o WHERE lower(o." + name + ") = lower(t." + name + "))";
     }
+    return clause;
+}
 
-    std::sort(records.begin(), records.end(), [](const IconRecord* lhs, const IconRecord* rhs) {
-        return lhs->name < rhs->name;
-    });
+std::string DatabaseInspector::BuildIconQuery(std::string_view table,
+                                              std::string_view filter,
+                                              std::string_view search) const
+{
+    static constexpr std::string_view kColumns =
+        "t.name, t.icon, t.icon_class_name, t.Icon_UTF_16_codes, t.Icon_Hex_Code, t.description, t.used_by";
 
-    std::vector<std::vector<std::string>> rows;
-    rows.reserve(records.size());
-    for (const IconRecord* record : records) {
-        rows.push_back({record->name,
-                        record->icon,
-                        record->icon_class,
-                        FormatUtf16(record->icon_utf16),
-                        FormatHex(record->icon_hex),
-                        record->description,
-                        record->used_by});
-    }
+    const NameFilter name_filter = TranslateNameFilter(filter);
+    const std::string table_name(table);
+    const std::string fts_name = table_name + "_fts";
 
-    const std::vector<std::string> headers = {
-        "Name", "Icon", "Icon Class", "UTF-16", "Hex", "Description", "Used By"};
+    std::string sql;
+    for (std::size_t index = 0; index < sources_.size(); ++index) {
+        const Source& source = sources_[index];
+        if (!source.tables.contains(table_name)) {
+            continue;
+        }
+        const std::string schema = QuoteIdentifier(source.schema);
+        if (!sql.empty()) {
+            sql += " UNION ALL ";
+        }
+        sql += "SELECT " + std::string(kColumns) + " FROM " + schema + "." + QuoteIdentifier(table_name) +
+               " AS t WHERE t.name <> ''";
+        if (!filter.empty()) {
+            sql += " AND " + NamePredicate("t.name", name_filter);
+        }
+        if (!search.empty()) {
+            if (FtsAvailable() && source.tables.contains(fts_name)) {
+                sql += " AND t.id IN (SELECT rowid FROM " + schema + "." + QuoteIdentifier(fts_name) +
+                       " WHERE " + QuoteIdentifier(fts_name) + " MATCH :match)";
+            } else {
+                sql += " AND (t.name LIKE :like ESCAPE '\\' OR t.description LIKE :like ESCAPE '\\'"
+                       " OR t.used_by LIKE :like ESCAPE '\\')";
+            }
+        }
+        sql += ShadowFilter(index, table, "name");
+    }
 
-    RenderTable(std::cout, headers, rows);
-    if (rows.empty()) {
-        std::cout << "(no entries)\n";
+    if (sql.empty()) {
+        return {};
     }
+    return sql + " ORDER BY 1 COLLATE BINARY;";
 }
 
-void DatabaseInspector::PrintAliases(const AliasMap& aliases,
-                                     const IconMap& icons,
-                                     std::string_view filter) const
+std::string DatabaseInspector::BuildAliasQuery(std::string_view table,
+                                               std::string_view icon_table,
+                                               std::string_view filter) const
 {
-    std::vector<AliasPresentation> rows;
-    rows.reserve(aliases.size());
-
-    for (const auto& [alias_key, alias] : aliases) {
-        if (!MatchesWildcard(filter, alias.target_key)) {
-            if (!MatchesWildcard(filter, alias_key)) {
-                continue;
+    const NameFilter name_filter = TranslateNameFilter(filter);
+    const std::string table_name(table);
+    const std::string icon_table_name(icon_table);
+
+    std::string aliases;
+    std::string icons;
+    for (std::size_t index = 0; index < sources_.size(); ++index) {
+        const Source& source = sources_[index];
+        const std::string schema = QuoteIdentifier(source.schema);
+        if (source.tables.contains(table_name)) {
+            if (!aliases.empty()) {
+                aliases += " UNION ALL ";
+            }
+            aliases += "SELECT t.alias, t.name FROM " + schema + "." + QuoteIdentifier(table_name) +
+                       " AS t WHERE t.alias <> '' AND t.name <> ''";
+            if (!filter.empty()) {
+                aliases += " AND ((" + NamePredicate("t.name", name_filter) + ") OR (" +
+                           NamePredicate("t.alias", name_filter) + "))";
             }
+            aliases += ShadowFilter(index, table, "alias");
         }
-        AliasPresentation row;
-        row.name = alias.target_name;
-        row.alias = alias.alias;
-
-        if (const auto icon_it = icons.find(alias.target_key); icon_it != icons.end()) {
-            row.icon = icon_it->second.icon;
-            row.icon_class = icon_it->second.icon_class;
-            row.icon_utf16 = icon_it->second.icon_utf16;
-            row.icon_hex = icon_it->second.icon_hex;
-            row.description = icon_it->second.description;
-            row.used_by = icon_it->second.used_by;
-        } else {
-            row.missing_target = true;
+        if (source.tables.contains(icon_table_name)) {
+            if (!icons.empty()) {
+                icons += " UNION ALL ";
+            }
+            icons += "SELECT t.name, t.icon, t.icon_class_name, t.Icon_UTF_16_codes, t.Icon_Hex_Code, "
+                     "t.description, t.used_by FROM " + schema + "." + QuoteIdentifier(icon_table_name) +
+                     " AS t WHERE lower(t.name) IN (SELECT lower(name) FROM aliases)" +
+                     ShadowFilter(index, icon_table, "name");
         }
+    }
 
-        rows.push_back(std::move(row));
+    if (aliases.empty()) {
+        return {};
+    }
+    if (icons.empty()) {
+        icons = "SELECT NULL AS name, NULL AS icon, NULL AS icon_class_name, NULL AS Icon_UTF_16_codes, "
+                "NULL AS Icon_Hex_Code, NULL AS description, NULL AS used_by WHERE 0";
     }
 
-    std::ranges::sort(rows, [](const AliasPresentation& lhs, const AliasPresentation& rhs) {
-        if (lhs.name == rhs.name) {
-            return lhs.alias < rhs.alias;
-        }
-        return lhs.name < rhs.name;
+    return "WITH aliases(alias, name) AS (" + aliases + "), icons AS (" + icons + ") "
+           "SELECT a.name, a.alias, i.icon, i.icon_class_name, i.Icon_UTF_16_codes, i.Icon_Hex_Code, "
+           "i.description, i.used_by, i.name IS NULL "
+           "FROM aliases AS a LEFT JOIN icons AS i ON lower(i.name) = lower(a.name) "
+           "ORDER BY a.name COLLATE BINARY, a.alias COLLATE BINARY;";
+}
+
+int DatabaseInspector::PrintIcons(std::string_view table,
+                                  std::string_view filter,
+                                  std::string_view search) const
+{
+    WarnMissingTable(table);
+    if (!HasSourceWith(table)) {
+        std::cerr << "nls: error: failed to load configuration database entries\n";
+        return 1;
+    }
+
+    sqlite3* db = view_.get();
+    const std::string sql = BuildIconQuery(table, filter, search);
+    sqlite3_stmt* stmt_raw = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt_raw, nullptr) != SQLITE_OK) {
+        std::cerr << "nls: error: " << sqlite3_errmsg(db) << '\n';
+        return 1;
+    }
+    SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
+
+    const NameFilter name_filter = TranslateNameFilter(filter);
+    BindNamed(stmt.get(), ":filter", name_filter.pattern);
+    BindNamed(stmt.get(), ":lower", name_filter.lower_bound);
+    BindNamed(stmt.get(), ":upper", name_filter.upper_bound);
+    BindNamed(stmt.get(), ":match", BuildMatchExpression(search));
+    BindNamed(stmt.get(), ":like", BuildLikePattern(search));
+
+    RowCursor rows(stmt.get(), [](sqlite3_stmt* row, std::vector<std::string>& cells, bool) {
+        cells.push_back(ExtractText(row, 0));
+        cells.push_back(ExtractText(row, 1));
+        cells.push_back(ExtractText(row, 2));
+        cells.push_back(FormatUtf16(ExtractCode(row, 3)));
+        cells.push_back(FormatHex(ExtractCode(row, 4)));
+        cells.push_back(ExtractText(row, 5));
+        cells.push_back(ExtractText(row, 6));
     });
 
-    std::vector<std::vector<std::string>> table_rows;
-    table_rows.reserve(rows.size());
-    std::vector<std::string> warnings;
+    const std::vector<std::string> headers = {
+        "Name", "Icon", "Icon Class", "UTF-16", "Hex", "Description", "Used By"};
+
+    const std::size_t count = RenderTable(std::cout, headers, rows);
+    if (rows.failed()) {
+        std::cerr << "nls: error: " << sqlite3_errmsg(db) << '\n';
+        return 1;
+    }
+    if (count == 0) {
+        std::cout << "(no entries)\n";
+    }
+    return 0;
+}
+
+int DatabaseInspector::PrintAliases(std::string_view table,
+                                    std::string_view icon_table,
+                                    std::string_view filter) const
+{
+    WarnMissingTable(table);
+    if (!HasSourceWith(table)) {
+        std::cerr << "nls: error: failed to load configuration database entries\n";
+        return 1;
+    }
+
+    sqlite3* db = view_.get();
+    const std::string sql = BuildAliasQuery(table, icon_table, filter);
+    sqlite3_stmt* stmt_raw = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt_raw, nullptr) != SQLITE_OK) {
+        std::cerr << "nls: error: " << sqlite3_errmsg(db) << '\n';
+        return 1;
+    }
+    SqliteStmtPtr stmt(stmt_raw, &FinalizeSqlite);
 
-    for (const auto& row : rows) {
-        if (row.missing_target) {
+    const NameFilter name_filter = TranslateNameFilter(filter);
+    BindNamed(stmt.get(), ":filter", name_filter.pattern);
+    BindNamed(stmt.get(), ":lower", name_filter.lower_bound);
+    BindNamed(stmt.get(), ":upper", name_filter.upper_bound);
+
+    // Warnings are gathered on the printing pass only, so each missing
+    // target is reported once.
+    std::vector<std::string> warnings;
+    RowCursor rows(stmt.get(), [&](sqlite3_stmt* row, std::vector<std::string>& cells, bool measuring) {
+        cells.push_back(ExtractText(row, 0));
+        cells.push_back(ExtractText(row, 1));
+        cells.push_back(ExtractText(row, 2));
+        cells.push_back(ExtractText(row, 3));
+        cells.push_back(FormatUtf16(ExtractCode(row, 4)));
+        cells.push_back(FormatHex(ExtractCode(row, 5)));
+        cells.push_back(ExtractText(row, 6));
+        cells.push_back(ExtractText(row, 7));
+        if (!measuring && sqlite3_column_int(row, 8) != 0) {
             std::ostringstream oss;
-            oss << "nls: warning: alias '" << row.alias << "' references missing entry '" << row.name << '\'';
+            oss << "nls: warning: alias '" << cells[1] << "' references missing entry '" << cells[0] << '\'';
             warnings.push_back(oss.str());
         }
-        table_rows.push_back({row.name,
-                              row.alias,
-                              row.icon,
-                              row.icon_class,
-                              FormatUtf16(row.icon_utf16),
-                              FormatHex(row.icon_hex),
-                              row.description,
-                              row.used_by});
-    }
+    });
 
     const std::vector<std::string> headers = {
         "Name", "Alias", "Icon", "Icon Class", "UTF-16", "Hex", "Description", "Used By"};
 
-    RenderTable(std::cout, headers, table_rows);
-    if (table_rows.empty()) {
+    const std::size_t count = RenderTable(std::cout, headers, rows);
+    if (rows.failed()) {
+        std::cerr << "nls: error: " << sqlite3_errmsg(db) << '\n';
+        return 1;
+    }
+    if (count == 0) {
         std::cout << "(no entries)\n";
     }
 
     for (const auto& warning : warnings) {
         std::cerr << warning << '\n';
     }
+    return 0;
 }
 
 }  // namespace nls
@@ -0,0 +1,281 @@
+#include "environment_cache.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace nls {
+
+namespace {
+
+constexpr const char* kMagic = "nls-environment";
+constexpr int kVersion = 1;
+constexpr long long kMaxAgeSeconds = 60 * 60;
+// Shells, editors and terminal multiplexers each get a record.
+constexpr std::size_t kMaxRecords = 16;
+// Far more search directories than initPaths registers; a larger count
+// means the file is damaged.
+constexpr std::size_t kMaxDirectories = 64;
+
+long long NowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void AppendField(std::string& key, std::string_view value) {
+    key.append(value);
+    key.push_back('\0');
+}
+
+void AppendEnv(std::string& key, const char* name) {
+    const char* value = std::getenv(name);
+    AppendField(key, value ? value : "");
+}
+
+// The controlling terminal identifies the session; redirected runs share
+// the "no terminal" key.
+std::string TerminalDevice() {
+#ifdef _WIN32
+    return "-";
+#else
+    for (const int fd : {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}) {
+        struct stat st {};
+        if (::isatty(fd) != 0 && ::fstat(fd, &st) == 0) {
+            return std::to_string(static_cast<std::uintmax_t>(st.st_rdev));
+        }
+    }
+    return "-";
+#endif
+}
+
+// Paths are stored as a byte count and the native representation, so names
+// with spaces or newlines survive the round trip.
+void WritePath(std::ostream& out, const fs::path& path) {
+    const auto& native = path.native();
+    const std::size_t bytes = native.size() * sizeof(fs::path::value_type);
+    out << bytes << ':';
+    out.write(reinterpret_cast<const char*>(native.data()), static_cast<std::streamsize>(bytes));
+    out << '\n';
+}
+
+// Cursor over the file contents. The cache is read on every start, so it is
+// parsed in place rather than through a locale-aware stream.
+class Reader {
+public:
+    explicit Reader(std::string_view text) : rest_(text) {}
+
+    [[nodiscard]] bool empty() const noexcept { return rest_.empty(); }
+
+    bool Word(std::string_view& word) {
+        const auto end = rest_.find_first_of(" \n");
+        if (end == 0 || end == std::string_view::npos) {
+            return false;
+        }
+        word = rest_.substr(0, end);
+        rest_.remove_prefix(end + 1);
+        return true;
+    }
+
+    template <typename T>
+    bool Number(T& value) {
+        std::string_view word;
+        if (!Word(word)) {
+            return false;
+        }
+        const auto result = std::from_chars(word.data(), word.data() + word.size(), value);
+        return result.ec == std::errc() && result.ptr == word.data() + word.size();
+    }
+
+    bool Path(fs::path& path) {
+        const auto colon = rest_.find(':');
+        std::size_t bytes = 0;
+        if (colon == std::string_view::npos ||
+            std::from_chars(rest_.data(), rest_.data() + colon, bytes).ptr != rest_.data() + colon ||
+            bytes % sizeof(fs::path::value_type) != 0 || rest_.size() - colon - 1 < bytes + 1 ||
+            rest_[colon + 1 + bytes] != '\n') {
+            return false;
+        }
+        fs::path::string_type native(bytes / sizeof(fs::path::value_type), fs::path::value_type{});
+        std::memcpy(native.data(), rest_.data() + colon + 1, bytes);
+        path = fs::path(std::move(native));
+        rest_.remove_prefix(colon + bytes + 2);
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+bool ReadFile(const fs::path& file, std::string& content) {
+#ifdef _WIN32
+    std::FILE* stream = ::_wfopen(file.c_str(), L"rb");
+#else
+    std::FILE* stream = std::fopen(file.c_str(), "rb");
+#endif
+    if (!stream) {
+        return false;
+    }
+    char buffer[4096];
+    std::size_t read = 0;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), stream)) > 0) {
+        content.append(buffer, read);
+    }
+    const bool ok = std::ferror(stream) == 0;
+    std::fclose(stream);
+    return ok;
+}
+
+}  // namespace
+
+EnvironmentCache::EnvironmentCache(fs::path file, std::string key) : file_(std::move(file)), key_(std::move(key)) {}
+
+std::string EnvironmentCache::SessionKey(const char* argv0, const fs::path& cwd) {
+    std::string key;
+    AppendField(key, TerminalDevice());
+    AppendEnv(key, "TERM");
+    AppendField(key, argv0 ? argv0 : "");
+    const auto& native = cwd.native();
+    AppendField(key, std::string_view(reinterpret_cast<const char*>(native.data()),
+                                      native.size() * sizeof(fs::path::value_type)));
+    for (const char* name : {"NLS_DATA_DIR", "HOME", "APPDATA", "USERPROFILE", "PROGRAMDATA"}) {
+        AppendEnv(key, name);
+    }
+
+    // FNV-1a keeps the records short; the inputs never leave this machine.
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char c : key) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+fs::path EnvironmentCache::DefaultFile() {
+    const char* setting = std::getenv("NLS_ENV_CACHE");
+    const std::string_view value(setting ? setting : "");
+    if (value != "1" && value != "on" && value != "yes" && value != "true") {
+        return {};
+    }
+#ifdef _WIN32
+    for (const char* name : {"APPDATA", "USERPROFILE"}) {
+        const char* base = std::getenv(name);
+        if (base && base[0] != '\0') {
+            return fs::path(base) / "nicels" / "cache" / "environment";
+        }
+    }
+#else
+    const char* home = std::getenv("HOME");
+    if (home && home[0] != '\0') {
+        return fs::path(home) / ".nicels" / "cache" / "environment";
+    }
+#endif
+    return {};
+}
+
+void EnvironmentCache::ReadRecords() {
+    loaded_ = true;
+    std::string content;
+    if (!ReadFile(file_, content)) {
+        return;
+    }
+    Reader in(content);
+    std::string_view magic;
+    int version = 0;
+    if (!in.Word(magic) || magic != kMagic || !in.Number(version) || version != kVersion) {
+        return;
+    }
+    // Each record: key saved-seconds directory-count, then the user and
+    // override directories and the search directories, one path per line.
+    while (!in.empty()) {
+        Record record;
+        std::string_view key;
+        std::size_t count = 0;
+        bool valid = in.Word(key) && in.Number(record.saved) && in.Number(count) && count <= kMaxDirectories &&
+                     in.Path(record.snapshot.user_config_dir) && in.Path(record.snapshot.env_override_dir);
+        record.key = key;
+        record.snapshot.directories.resize(valid ? count : 0);
+        for (auto& dir : record.snapshot.directories) {
+            valid = valid && in.Path(dir);
+        }
+        if (!valid) {
+            records_.clear();
+            return;
+        }
+        records_.push_back(std::move(record));
+    }
+}
+
+bool EnvironmentCache::Load(Snapshot& snapshot) {
+    if (!loaded_) {
+        ReadRecords();
+    }
+    const long long now = NowSeconds();
+    for (const auto& record : records_) {
+        if (record.key == key_ && now >= record.saved && now - record.saved < kMaxAgeSeconds) {
+            snapshot = record.snapshot;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EnvironmentCache::Store(const Snapshot& snapshot) {
+    if (!loaded_) {
+        ReadRecords();
+    }
+    std::error_code ec;
+    fs::create_directories(file_.parent_path(), ec);
+    fs::path temp = file_;
+    temp += "." + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out << kMagic << ' ' << kVersion << '\n';
+        const auto write_record = [&out](const std::string& key, long long saved, const Snapshot& data) {
+            out << key << ' ' << saved << ' ' << data.directories.size() << '\n';
+            WritePath(out, data.user_config_dir);
+            WritePath(out, data.env_override_dir);
+            for (const auto& dir : data.directories) {
+                WritePath(out, dir);
+            }
+        };
+        write_record(key_, NowSeconds(), snapshot);
+        std::size_t kept = 1;
+        for (const auto& record : records_) {
+            if (kept >= kMaxRecords) break;
+            if (record.key == key_) continue;
+            write_record(record.key, record.saved, record.snapshot);
+            ++kept;
+        }
+        if (!out.flush()) {
+            out.close();
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+    // Concurrent sessions may race; the rename keeps the file whole.
+    fs::rename(temp, file_, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+    }
+}
+
+}  // namespace nls
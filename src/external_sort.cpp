@@ -0,0 +1,614 @@
+#include "external_sort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "perf.h"
+
+namespace fs = std::filesystem;
+
+namespace nls {
+
+namespace {
+
+constexpr std::size_t kReadBufferSize = 64 * 1024;
+
+enum EntryFlag : std::uint32_t {
+    kIsDir = 1u << 0,
+    kIsSymlink = 1u << 1,
+    kIsExec = 1u << 2,
+    kIsHidden = 1u << 3,
+    kIsBrokenSymlink = 1u << 4,
+    kIsSocket = 1u << 5,
+    kIsBlockDevice = 1u << 6,
+    kIsCharDevice = 1u << 7,
+    kHasRecognizedIcon = 1u << 8,
+    kHasSymlinkTarget = 1u << 9,
+    kHasOwnerId = 1u << 10,
+    kHasGroupId = 1u << 11,
+    kHasOwnerNumeric = 1u << 12,
+    kHasGroupNumeric = 1u << 13,
+    kHasLinkSize = 1u << 14,
+    kHasAllocatedSize = 1u << 15,
+    kHasSymlinkStatus = 1u << 16,
+    kHasTargetStatus = 1u << 17,
+    kStatTimedOut = 1u << 18,
+    kIsAutomount = 1u << 19,
+};
+
+int CloseFile(std::FILE* file) {
+    return file ? std::fclose(file) : 0;
+}
+
+bool SeekTo(std::FILE* file, std::int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+std::int64_t TellOffset(std::FILE* file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return static_cast<std::int64_t>(ftello(file));
+#endif
+}
+
+std::string_view NativeBytes(const fs::path& path) {
+    const auto& native = path.native();
+    return {reinterpret_cast<const char*>(native.data()), native.size() * sizeof(fs::path::value_type)};
+}
+
+fs::path PathFromBytes(std::string_view bytes) {
+    fs::path::string_type native(bytes.size() / sizeof(fs::path::value_type), fs::path::value_type{});
+    std::memcpy(native.data(), bytes.data(), native.size() * sizeof(fs::path::value_type));
+    return fs::path(std::move(native));
+}
+
+// Counts, ids and sizes are mostly small, so they are written as LEB128
+// varints; a packed run holds millions of them.
+class RecordWriter {
+public:
+    void Clear() { data_.clear(); }
+    [[nodiscard]] std::string Take() { return std::exchange(data_, {}); }
+
+    void U32(std::uint32_t value) { Varint(value); }
+    void U64(std::uint64_t value) { Varint(value); }
+    void I64(std::int64_t value) { Raw(&value, sizeof(value)); }
+
+    void Str(const std::string& value) {
+        U32(static_cast<std::uint32_t>(value.size()));
+        Raw(value.data(), value.size());
+    }
+
+    void Path(const fs::path& value) {
+        const auto& native = value.native();
+        U32(static_cast<std::uint32_t>(native.size()));
+        Raw(native.data(), native.size() * sizeof(fs::path::value_type));
+    }
+
+    void Status(const fs::file_status& value) {
+        U32(static_cast<std::uint32_t>(value.type()));
+        U32(static_cast<std::uint32_t>(value.permissions()));
+    }
+
+    [[nodiscard]] const std::string& data() const noexcept { return data_; }
+
+private:
+    void Varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            data_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        data_.push_back(static_cast<char>(value));
+    }
+
+    void Raw(const void* bytes, std::size_t size) {
+        data_.append(static_cast<const char*>(bytes), size);
+    }
+
+    std::string data_;
+};
+
+class RecordParser {
+public:
+    RecordParser(const char* data, std::size_t size) : cursor_(data), end_(data + size) {}
+
+    std::uint32_t U32() { return static_cast<std::uint32_t>(Varint()); }
+    std::uint64_t U64() { return Varint(); }
+    std::int64_t I64() { std::int64_t v = 0; Raw(&v, sizeof(v)); return v; }
+
+    std::string Str() {
+        const std::uint32_t size = U32();
+        if (!Fits(size)) return {};
+        std::string value(size, '\0');
+        Raw(value.data(), size);
+        return value;
+    }
+
+    fs::path Path() {
+        const std::uint32_t size = U32();
+        if (!Fits(size * sizeof(fs::path::value_type))) return {};
+        fs::path::string_type value(size, fs::path::value_type{});
+        Raw(value.data(), size * sizeof(fs::path::value_type));
+        return fs::path(std::move(value));
+    }
+
+    fs::file_status Status() {
+        const auto type = static_cast<fs::file_type>(U32());
+        const auto perms = static_cast<fs::perms>(U32());
+        return fs::file_status(type, perms);
+    }
+
+    [[nodiscard]] bool ok() const noexcept { return ok_; }
+
+private:
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; ok_ && cursor_ != end_ && shift < 64; shift += 7) {
+            const auto byte = static_cast<unsigned char>(*cursor_++);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    // Guards allocations against a damaged length.
+    bool Fits(std::size_t size) {
+        if (static_cast<std::size_t>(end_ - cursor_) < size) ok_ = false;
+        return ok_;
+    }
+
+    void Raw(void* out, std::size_t size) {
+        if (!ok_ || static_cast<std::size_t>(end_ - cursor_) < size) {
+            ok_ = false;
+            return;
+        }
+        std::memcpy(out, cursor_, size);
+        cursor_ += size;
+    }
+
+    const char* cursor_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+// Everything but the path and name, which packed runs front-code separately.
+void EncodeMetadata(const FileInfo& info, RecordWriter& writer) {
+    std::uint32_t flags = 0;
+    auto flag = [&flags](bool value, EntryFlag bit) {
+        if (value) flags |= bit;
+    };
+    flag(info.is_dir, kIsDir);
+    flag(info.is_symlink, kIsSymlink);
+    flag(info.is_exec, kIsExec);
+    flag(info.is_hidden, kIsHidden);
+    flag(info.is_broken_symlink, kIsBrokenSymlink);
+    flag(info.is_socket, kIsSocket);
+    flag(info.is_block_device, kIsBlockDevice);
+    flag(info.is_char_device, kIsCharDevice);
+    flag(info.has_recognized_icon, kHasRecognizedIcon);
+    flag(info.has_symlink_target, kHasSymlinkTarget);
+    flag(info.has_owner_id, kHasOwnerId);
+    flag(info.has_group_id, kHasGroupId);
+    flag(info.has_owner_numeric, kHasOwnerNumeric);
+    flag(info.has_group_numeric, kHasGroupNumeric);
+    flag(info.has_link_size, kHasLinkSize);
+    flag(info.has_allocated_size, kHasAllocatedSize);
+    flag(info.has_symlink_status, kHasSymlinkStatus);
+    flag(info.has_target_status, kHasTargetStatus);
+    flag(info.stat_timed_out, kStatTimedOut);
+    flag(info.is_automount, kIsAutomount);
+
+    writer.U32(flags);
+    writer.U64(info.inode);
+    writer.U64(info.size);
+    writer.I64(static_cast<std::int64_t>(info.mtime.time_since_epoch().count()));
+    writer.Path(info.symlink_target);
+    writer.U64(info.owner_id);
+    writer.U64(info.group_id);
+    writer.Str(info.owner_numeric);
+    writer.Str(info.group_numeric);
+    writer.U64(info.link_size);
+    writer.U64(info.allocated_size);
+    writer.Status(info.symlink_status);
+    writer.Status(info.target_status);
+    writer.U64(info.nlink);
+    writer.Str(info.owner);
+    writer.Str(info.group);
+    writer.Str(info.icon);
+    writer.Str(info.color_fg);
+    writer.Str(info.color_reset);
+    writer.Str(info.git_prefix);
+    writer.Str(info.git_diffstat);
+    writer.Str(info.content_hash);
+    writer.U64(info.device);
+    writer.I64(info.ctime_ns);
+    writer.U32(static_cast<unsigned char>(info.xattr_indicator));
+}
+
+void EncodeEntry(const Entry& entry, RecordWriter& writer) {
+    writer.Path(entry.info.path);
+    writer.Str(entry.info.name);
+    EncodeMetadata(entry.info, writer);
+}
+
+bool DecodeMetadata(RecordParser& parser, FileInfo& info) {
+    const std::uint32_t flags = parser.U32();
+    auto flag = [flags](EntryFlag bit) { return (flags & bit) != 0; };
+    info.is_dir = flag(kIsDir);
+    info.is_symlink = flag(kIsSymlink);
+    info.is_exec = flag(kIsExec);
+    info.is_hidden = flag(kIsHidden);
+    info.is_broken_symlink = flag(kIsBrokenSymlink);
+    info.is_socket = flag(kIsSocket);
+    info.is_block_device = flag(kIsBlockDevice);
+    info.is_char_device = flag(kIsCharDevice);
+    info.has_recognized_icon = flag(kHasRecognizedIcon);
+    info.has_symlink_target = flag(kHasSymlinkTarget);
+    info.has_owner_id = flag(kHasOwnerId);
+    info.has_group_id = flag(kHasGroupId);
+    info.has_owner_numeric = flag(kHasOwnerNumeric);
+    info.has_group_numeric = flag(kHasGroupNumeric);
+    info.has_link_size = flag(kHasLinkSize);
+    info.has_allocated_size = flag(kHasAllocatedSize);
+    info.has_symlink_status = flag(kHasSymlinkStatus);
+    info.has_target_status = flag(kHasTargetStatus);
+    info.stat_timed_out = flag(kStatTimedOut);
+    info.is_automount = flag(kIsAutomount);
+
+    info.inode = parser.U64();
+    info.size = parser.U64();
+    info.mtime = fs::file_time_type(fs::file_time_type::duration(parser.I64()));
+    info.symlink_target = parser.Path();
+    info.owner_id = parser.U64();
+    info.group_id = parser.U64();
+    info.owner_numeric = parser.Str();
+    info.group_numeric = parser.Str();
+    info.link_size = parser.U64();
+    info.allocated_size = parser.U64();
+    info.symlink_status = parser.Status();
+    info.target_status = parser.Status();
+    info.nlink = static_cast<unsigned long>(parser.U64());
+    info.owner = parser.Str();
+    info.group = parser.Str();
+    info.icon = parser.Str();
+    info.color_fg = parser.Str();
+    info.color_reset = parser.Str();
+    info.git_prefix = parser.Str();
+    info.git_diffstat = parser.Str();
+    info.content_hash = parser.Str();
+    info.device = parser.U64();
+    info.ctime_ns = parser.I64();
+    info.xattr_indicator = static_cast<char>(parser.U32());
+    return parser.ok();
+}
+
+bool DecodeEntry(RecordParser& parser, Entry& entry) {
+    entry.info.path = parser.Path();
+    entry.info.name = parser.Str();
+    return DecodeMetadata(parser, entry.info);
+}
+
+}  // namespace
+
+// Streams one spilled run back from the shared temporary file through a
+// private read buffer, re-seeking only when the buffer runs dry.
+class ExternalEntrySorter::RunReader {
+public:
+    RunReader(std::FILE* file, const Run& run) : file_(file), offset_(run.offset), remaining_(run.count) {}
+
+    bool Next(Entry& out) {
+        if (remaining_ == 0) return false;
+        std::uint32_t size = 0;
+        if (!Fill(sizeof(size))) return Fail();
+        std::memcpy(&size, buffer_.data() + position_, sizeof(size));
+        if (!Fill(sizeof(size) + size)) return Fail();
+        RecordParser parser(buffer_.data() + position_ + sizeof(size), size);
+        out = Entry{};
+        if (!DecodeEntry(parser, out)) return Fail();
+        position_ += sizeof(size) + size;
+        --remaining_;
+        return true;
+    }
+
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+
+private:
+    bool Fail() {
+        failed_ = true;
+        remaining_ = 0;
+        return false;
+    }
+
+    bool Fill(std::size_t needed) {
+        if (buffer_.size() - position_ >= needed) return true;
+        buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(position_));
+        position_ = 0;
+        const std::size_t want = std::max(needed - buffer_.size(), kReadBufferSize);
+        const std::size_t old_size = buffer_.size();
+        buffer_.resize(old_size + want);
+        if (!SeekTo(file_, offset_)) return false;
+        const std::size_t got = std::fread(buffer_.data() + old_size, 1, want, file_);
+        buffer_.resize(old_size + got);
+        offset_ += static_cast<std::int64_t>(got);
+        return buffer_.size() >= needed;
+    }
+
+    std::FILE* file_;
+    std::int64_t offset_;
+    std::size_t remaining_;
+    std::vector<char> buffer_;
+    std::size_t position_ = 0;
+    bool failed_ = false;
+};
+
+// Decodes one packed run in order. Each name and path is rebuilt from its
+// predecessor, so reading an entry back costs little more than its suffix.
+class ExternalEntrySorter::PackedRunReader {
+public:
+    explicit PackedRunReader(const PackedRun& run)
+        : parser_(run.records.data(), run.records.size()), names_(run.names), paths_(run.paths) {}
+
+    bool Next(Entry& out) {
+        std::string_view name;
+        std::string_view path;
+        if (failed_ || !names_.Next(name) || !paths_.Next(path)) return false;
+        out = Entry{};
+        out.info.name.assign(name);
+        out.info.path = PathFromBytes(path);
+        if (!DecodeMetadata(parser_, out.info)) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+
+private:
+    RecordParser parser_;
+    NameStore::Cursor names_;
+    NameStore::Cursor paths_;
+    bool failed_ = false;
+};
+
+ExternalEntrySorter::ExternalEntrySorter(std::uintmax_t memory_limit,
+                                         Storage storage,
+                                         RunSorter sort_run,
+                                         HeadLess less,
+                                         bool reverse_ties)
+    : memory_limit_(memory_limit),
+      storage_(storage),
+      sort_run_(std::move(sort_run)),
+      less_(std::move(less)),
+      reverse_ties_(reverse_ties),
+      file_(nullptr, &CloseFile) {}
+
+ExternalEntrySorter::~ExternalEntrySorter() = default;
+
+std::size_t ExternalEntrySorter::EstimateBytes(const Entry& entry) noexcept {
+    const FileInfo& info = entry.info;
+    return sizeof(Entry)
+        + info.path.native().size() * sizeof(fs::path::value_type)
+        + info.symlink_target.native().size() * sizeof(fs::path::value_type)
+        + info.name.size() + info.owner.size() + info.group.size()
+        + info.owner_numeric.size() + info.group_numeric.size()
+        + info.icon.size() + info.color_fg.size() + info.color_reset.size()
+        + info.git_prefix.size() + info.git_diffstat.size();
+}
+
+void ExternalEntrySorter::Add(Entry entry) {
+    buffered_bytes_ += EstimateBytes(entry);
+    buffer_.push_back(std::move(entry));
+    if (buffered_bytes_ > memory_limit_) {
+        SpillBuffer();
+    }
+}
+
+std::vector<Entry> ExternalEntrySorter::TakeBuffered() {
+    buffered_bytes_ = 0;
+    return std::exchange(buffer_, {});
+}
+
+void ExternalEntrySorter::SpillBuffer() {
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled() && storage_ == Storage::TemporaryFile) {
+        timer.emplace("external_sort::spill");
+    }
+
+    sort_run_(buffer_);
+    if (observer_) {
+        observer_(buffer_);
+    }
+    if (storage_ == Storage::TemporaryFile && !WriteRun()) {
+        // Runs already on disk stay valid; this one and the rest are packed
+        // instead of piling up unsorted in the buffer.
+        failed_ = true;
+        storage_ = Storage::Packed;
+    }
+    if (storage_ == Storage::Packed) {
+        PackRun();
+    }
+
+    // The buffer keeps its capacity: the next run fills it to the same size.
+    buffer_.clear();
+    buffered_bytes_ = 0;
+}
+
+bool ExternalEntrySorter::WriteRun() {
+    if (!file_) {
+        file_.reset(std::tmpfile());
+        if (!file_) return false;
+    }
+
+    if (std::fseek(file_.get(), 0, SEEK_END) != 0) return false;
+    Run run;
+    run.offset = TellOffset(file_.get());
+    run.count = buffer_.size();
+
+    RecordWriter writer;
+    std::uint64_t bytes = 0;
+    for (const auto& entry : buffer_) {
+        writer.Clear();
+        EncodeEntry(entry, writer);
+        const auto size = static_cast<std::uint32_t>(writer.data().size());
+        if (std::fwrite(&size, sizeof(size), 1, file_.get()) != 1
+            || std::fwrite(writer.data().data(), 1, size, file_.get()) != size) {
+            return false;
+        }
+        bytes += sizeof(size) + size;
+    }
+    if (std::fflush(file_.get()) != 0) return false;
+
+    runs_.push_back(run);
+
+    auto& perf_manager = perf::Manager::Instance();
+    if (perf_manager.enabled()) {
+        perf_manager.IncrementCounter("external_sort::runs_spilled");
+        perf_manager.IncrementCounter("external_sort::entries_spilled", run.count);
+        perf_manager.IncrementCounter("external_sort::bytes_spilled", bytes);
+    }
+    return true;
+}
+
+void ExternalEntrySorter::PackRun() {
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace("external_sort::pack");
+    }
+
+    PackedRun run;
+    RecordWriter writer;
+    for (const auto& entry : buffer_) {
+        EncodeMetadata(entry.info, writer);
+        run.names.Append(entry.info.name);
+        run.paths.Append(NativeBytes(entry.info.path));
+    }
+    run.records = writer.Take();
+    run.records.shrink_to_fit();
+    run.names.ShrinkToFit();
+    run.paths.ShrinkToFit();
+
+    if (perf_manager.enabled()) {
+        perf_manager.IncrementCounter("external_sort::packed::runs");
+        perf_manager.IncrementCounter("external_sort::packed::entries", buffer_.size());
+        perf_manager.IncrementCounter("external_sort::packed::bytes",
+                                      run.records.capacity() + run.names.bytes() + run.paths.bytes());
+        perf_manager.IncrementCounter("external_sort::packed::name_bytes", run.names.bytes() + run.paths.bytes());
+        perf_manager.IncrementCounter("external_sort::packed::name_bytes_raw",
+                                      run.names.raw_bytes() + run.paths.raw_bytes());
+    }
+    packed_runs_.push_back(std::move(run));
+}
+
+bool ExternalEntrySorter::Merge(std::size_t batch_size, const BatchSink& sink) {
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace("external_sort::merge");
+    }
+
+    // The unspilled tail is the newest run; it is merged straight from memory.
+    sort_run_(buffer_);
+    if (observer_) {
+        observer_(buffer_);
+    }
+
+    // Sources in run order: spilled runs, packed runs, then the tail. Both
+    // kinds of stored run are present only after a failed spill.
+    std::vector<RunReader> readers;
+    readers.reserve(runs_.size());
+    for (const auto& run : runs_) {
+        readers.emplace_back(file_.get(), run);
+    }
+    std::vector<PackedRunReader> packed_readers;
+    packed_readers.reserve(packed_runs_.size());
+    for (const auto& run : packed_runs_) {
+        packed_readers.emplace_back(run);
+    }
+
+    const std::size_t packed_source = readers.size();
+    const std::size_t memory_source = packed_source + packed_readers.size();
+    std::size_t memory_index = 0;
+    std::vector<MergeHead> heads(memory_source + 1);
+    std::vector<std::size_t> heap;
+    heap.reserve(heads.size());
+
+    auto load = [&](std::size_t source) {
+        Entry& entry = heads[source].entry;
+        if (source == memory_source) {
+            if (memory_index >= buffer_.size()) return false;
+            entry = std::move(buffer_[memory_index++]);
+            return true;
+        }
+        if (source >= packed_source) {
+            return packed_readers[source - packed_source].Next(entry);
+        }
+        return readers[source].Next(entry);
+    };
+    auto advance = [&](std::size_t source) {
+        if (!load(source)) return false;
+        if (merge_key_) {
+            heads[source].key = merge_key_(heads[source].entry);
+        }
+        return true;
+    };
+
+    // Heap ordered on "comes later" keeps the next entry to emit at the front;
+    // equal entries leave in run order, which is arrival order.
+    auto later = [&](std::size_t a, std::size_t b) {
+        if (less_(heads[b], heads[a])) return true;
+        if (less_(heads[a], heads[b])) return false;
+        return reverse_ties_ ? a < b : a > b;
+    };
+
+    for (std::size_t source = 0; source < heads.size(); ++source) {
+        if (advance(source)) {
+            heap.push_back(source);
+        }
+    }
+    std::ranges::make_heap(heap, later);
+
+    const std::size_t limit = std::max<std::size_t>(batch_size, 1);
+    std::vector<Entry> batch;
+    batch.reserve(limit);
+    while (!heap.empty()) {
+        std::ranges::pop_heap(heap, later);
+        const std::size_t source = heap.back();
+        batch.push_back(std::move(heads[source].entry));
+        if (advance(source)) {
+            std::ranges::push_heap(heap, later);
+        } else {
+            heap.pop_back();
+        }
+        if (batch.size() >= limit) {
+            sink(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.empty()) {
+        sink(batch);
+    }
+
+    const bool ok = std::ranges::none_of(readers, [](const RunReader& reader) { return reader.failed(); }) &&
+                    std::ranges::none_of(packed_readers, [](const PackedRunReader& reader) { return reader.failed(); });
+    buffer_.clear();
+    buffered_bytes_ = 0;
+    runs_.clear();
+    packed_runs_.clear();
+    file_.reset();
+    return ok;
+}
+
+}  // namespace nls
@@ -7,10 +7,15 @@
 #include <string>
 
 #ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
 #include <grp.h>
 #include <pwd.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
 #else
 #include <Aclapi.h>
 #include <sddl.h>
@@ -21,7 +26,52 @@
 namespace nls {
 
 #ifndef _WIN32
-bool FileOwnershipResolver::MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintmax_t& result) const {
+namespace {
+
+// statx() costs the same single syscall as lstat()/stat() but also reports
+// attribute flags; the automount bit is used to keep xattr probing from
+// triggering mounts.
+int StatPath(const char* path, bool follow, struct stat& st, FileInfo& file_info) {
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    struct statx stx {};
+    const int flags = AT_NO_AUTOMOUNT | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+    if (::statx(AT_FDCWD, path, flags, STATX_BASIC_STATS, &stx) == 0) {
+        st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+        st.st_ino = static_cast<ino_t>(stx.stx_ino);
+        st.st_mode = stx.stx_mode;
+        st.st_nlink = static_cast<nlink_t>(stx.stx_nlink);
+        st.st_uid = stx.stx_uid;
+        st.st_gid = stx.stx_gid;
+        st.st_size = static_cast<off_t>(stx.stx_size);
+        st.st_blocks = static_cast<blkcnt_t>(stx.stx_blocks);
+        st.st_ctim.tv_sec = stx.stx_ctime.tv_sec;
+        st.st_ctim.tv_nsec = stx.stx_ctime.tv_nsec;
+#ifdef STATX_ATTR_AUTOMOUNT
+        file_info.is_automount = (stx.stx_attributes_mask & stx.stx_attributes & STATX_ATTR_AUTOMOUNT) != 0;
+#endif
+        return 0;
+    }
+    if (errno != ENOSYS) {
+        return -1;
+    }
+#else
+    (void)file_info;
+#endif
+    return follow ? ::stat(path, &st) : ::lstat(path, &st);
+}
+
+std::int64_t ChangeTimeNs(const struct stat& st) {
+#ifdef __APPLE__
+    const struct timespec& ts = st.st_ctimespec;
+#else
+    const struct timespec& ts = st.st_ctim;
+#endif
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+} // namespace
+
+bool FileOwnershipResolver::MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintmax_t& result) {
     if (a == 0 || b == 0) {
         result = 0;
         return true;
@@ -36,6 +86,11 @@ bool FileOwnershipResolver::MultiplyWithOverflow(uintmax_t a, uintmax_t b, uintm
 
 
 void FileOwnershipResolver::Populate(FileInfo& file_info, bool dereference) const {
+    ReadStat(file_info, dereference);
+    ResolveOwners(file_info, dereference);
+}
+
+void FileOwnershipResolver::ReadStat(FileInfo& file_info, bool dereference) {
 #ifndef _WIN32
     file_info.owner.clear();
     file_info.group.clear();
@@ -48,10 +103,13 @@ void FileOwnershipResolver::Populate(FileInfo& file_info, bool dereference) cons
     file_info.has_link_size = false;
     file_info.allocated_size = 0;
     file_info.has_allocated_size = false;
+    file_info.is_automount = false;
 
     auto assign_from_stat = [&](const struct stat& st) {
         file_info.nlink = st.st_nlink;
         file_info.inode = static_cast<uintmax_t>(st.st_ino);
+        file_info.device = static_cast<uintmax_t>(st.st_dev);
+        file_info.ctime_ns = ChangeTimeNs(st);
         file_info.owner_id = static_cast<uintmax_t>(st.st_uid);
         file_info.group_id = static_cast<uintmax_t>(st.st_gid);
         file_info.has_owner_id = true;
@@ -60,16 +118,6 @@ void FileOwnershipResolver::Populate(FileInfo& file_info, bool dereference) cons
         file_info.group_numeric = std::to_string(static_cast<uintmax_t>(st.st_gid));
         file_info.has_owner_numeric = true;
         file_info.has_group_numeric = true;
-        if (auto* pw = ::getpwuid(st.st_uid)) {
-            file_info.owner = pw->pw_name;
-        } else {
-            file_info.owner = std::to_string(static_cast<uintmax_t>(st.st_uid));
-        }
-        if (auto* gr = ::getgrgid(st.st_gid)) {
-            file_info.group = gr->gr_name;
-        } else {
-            file_info.group = std::to_string(static_cast<uintmax_t>(st.st_gid));
-        }
         if (st.st_blocks >= 0) {
             uintmax_t blocks = static_cast<uintmax_t>(st.st_blocks);
             uintmax_t allocated = 0;
@@ -82,7 +130,7 @@ void FileOwnershipResolver::Populate(FileInfo& file_info, bool dereference) cons
     };
 
     struct stat link_stat {};
-    if (::lstat(file_info.path.c_str(), &link_stat) == 0) {
+    if (StatPath(file_info.path.c_str(), false, link_stat, file_info) == 0) {
         assign_from_stat(link_stat);
         file_info.link_size = static_cast<uintmax_t>(link_stat.st_size);
         file_info.has_link_size = true;
@@ -90,10 +138,35 @@ void FileOwnershipResolver::Populate(FileInfo& file_info, bool dereference) cons
 
     if (dereference) {
         struct stat target_stat {};
-        if (::stat(file_info.path.c_str(), &target_stat) == 0) {
+        if (StatPath(file_info.path.c_str(), true, target_stat, file_info) == 0) {
             assign_from_stat(target_stat);
         }
     }
+#else
+    (void)file_info;
+    (void)dereference;
+#endif
+}
+
+void FileOwnershipResolver::ResolveOwners(FileInfo& file_info, bool dereference) const {
+#ifndef _WIN32
+    (void)dereference;
+    if (file_info.has_owner_id) {
+        const auto uid = static_cast<uid_t>(file_info.owner_id);
+        if (auto* pw = ::getpwuid(uid)) {
+            file_info.owner = pw->pw_name;
+        } else {
+            file_info.owner = file_info.owner_numeric;
+        }
+    }
+    if (file_info.has_group_id) {
+        const auto gid = static_cast<gid_t>(file_info.group_id);
+        if (auto* gr = ::getgrgid(gid)) {
+            file_info.group = gr->gr_name;
+        } else {
+            file_info.group = file_info.group_numeric;
+        }
+    }
 #else
     file_info.nlink = 1;
     file_info.owner.clear();
@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <cwchar>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <system_error>
 #include <utility>
@@ -48,9 +49,15 @@ typedef struct _REPARSE_DATA_BUFFER {
 #endif
 #endif
 
+#include "cancellation.h"
+#include "content_sniffer.h"
 #include "file_ownership_resolver.h"
 #include "perf.h"
+#include "progress.h"
+#include "rate_limiter.h"
+#include "stat_probe.h"
 #include "string_utils.h"
+#include "xattr_resolver.h"
 #include "symlink_resolver.h"
 #include "theme.h"
 
@@ -60,6 +67,19 @@ namespace fs = std::filesystem;
 
 namespace {
 
+// Pool size and batch length used with --stat-timeout. A batch is probed
+// concurrently, so one hung entry costs at most one timeout per batch.
+constexpr std::size_t kStatProbeWorkers = 8;
+constexpr std::size_t kStatProbeBatch = 64;
+
+// One entry on its way through the stat probe pool: the workers fill it and
+// the scanning thread reads it only once its probes have finished.
+struct ProbedEntry {
+    Entry entry;
+    SymlinkResolver::TargetStat target;
+    XattrResolver::Reading xattr;
+};
+
 class WildcardMatcher final {
 public:
     [[nodiscard]] static bool Matches(const std::string& pattern, const std::string& text) {
@@ -523,10 +543,21 @@ public:
 
 FileScanner::FileScanner(const Config& config,
                          FileOwnershipResolver& ownership_resolver,
-                         SymlinkResolver& symlink_resolver)
+                         SymlinkResolver& symlink_resolver,
+                         XattrResolver& xattr_resolver)
     : config_(config),
       ownership_resolver_(ownership_resolver),
-      symlink_resolver_(symlink_resolver) {}
+      symlink_resolver_(symlink_resolver),
+      xattr_resolver_(xattr_resolver) {
+    if (config_.stat_timeout()) {
+        stat_probe_ = std::make_unique<StatProbePool>(*config_.stat_timeout(), kStatProbeWorkers);
+    }
+    if (config_.max_ops_per_sec() != 0) {
+        rate_limiter_ = std::make_unique<RateLimiter>(config_.max_ops_per_sec());
+    }
+}
+
+FileScanner::~FileScanner() = default;
 
 bool FileScanner::matches_any_pattern(const std::string& name,
                                       const std::vector<std::string>& patterns) const {
@@ -564,6 +595,11 @@ bool FileScanner::should_include(const std::string& name, bool is_explicit) cons
 }
 
 void FileScanner::populate_entry(const fs::directory_entry& de, Entry& entry) const {
+    read_entry_metadata(de, config_.dereference(), entry);
+    resolve_entry_metadata(entry);
+}
+
+void FileScanner::read_entry_metadata(const fs::directory_entry& de, bool dereference, Entry& entry) {
     entry.info.path = de.path();
 
     std::error_code info_ec;
@@ -651,54 +687,29 @@ void FileScanner::populate_entry(const fs::directory_entry& de, Entry& entry) co
 #endif
     entry.info.is_exec = ExecutableClassifier::IsExecutable(de);
     entry.info.is_hidden = StringUtils::IsHidden(entry.info.name);
-    auto is_missing_error = [](const std::error_code& ec) {
-        if (!ec) {
-            return false;
-        }
-        return ec == std::errc::no_such_file_or_directory || ec == std::errc::not_a_directory;
-    };
+    FileOwnershipResolver::ReadStat(entry.info, dereference);
+}
 
+void FileScanner::resolve_entry_metadata(Entry& entry, bool read_xattr) const {
     bool is_broken_symlink = false;
     if (entry.info.is_symlink) {
-        std::error_code status_ec;
-        fs::file_status status_value = fs::status(entry.info.path, status_ec);
-        if (is_missing_error(status_ec)) {
-            is_broken_symlink = true;
-        } else if (!status_ec && status_value.type() == fs::file_type::not_found) {
-            is_broken_symlink = true;
-        } else if (status_ec) {
-            fs::path resolved_path = entry.info.path;
-            if (auto resolved = symlink_resolver_.ResolveTarget(entry.info)) {
-                resolved_path = std::move(*resolved);
-            }
-            std::error_code resolved_ec;
-            fs::file_status resolved_status = fs::status(resolved_path, resolved_ec);
-            if (is_missing_error(resolved_ec) || resolved_status.type() == fs::file_type::not_found) {
-                is_broken_symlink = true;
-            }
-        }
+        is_broken_symlink = symlink_resolver_.StatTarget(entry.info, false).broken;
     }
     entry.info.is_broken_symlink = is_broken_symlink;
 
-    ownership_resolver_.Populate(entry.info, config_.dereference());
+    ownership_resolver_.ResolveOwners(entry.info, config_.dereference());
     apply_symlink_metadata(entry);
+    if (read_xattr && config_.format() == Config::Format::Long) {
+        entry.info.xattr_indicator = xattr_resolver_.Indicator(entry.info, config_.dereference());
+    }
     apply_icon_and_color(entry);
 }
 
 void FileScanner::apply_symlink_metadata(Entry& entry) const {
     if (config_.dereference() && entry.info.is_symlink && !entry.info.is_broken_symlink) {
-        fs::path follow_path = entry.info.path;
-        if (auto resolved = symlink_resolver_.ResolveTarget(entry.info)) {
-            follow_path = std::move(*resolved);
-        }
-        std::error_code follow_ec;
-        auto follow_status = fs::status(follow_path, follow_ec);
-        if (follow_ec && follow_path != entry.info.path) {
-            follow_path = entry.info.path;
-            follow_ec.clear();
-            follow_status = fs::status(follow_path, follow_ec);
-        }
-        if (!follow_ec) {
+        const auto& target = symlink_resolver_.StatTarget(entry.info, true);
+        if (!target.status_error) {
+            const fs::file_status& follow_status = target.status;
             entry.info.is_dir = fs::is_directory(follow_status);
             entry.info.is_socket = fs::is_socket(follow_status);
             entry.info.is_block_device = fs::is_block_file(follow_status);
@@ -706,22 +717,15 @@ void FileScanner::apply_symlink_metadata(Entry& entry) const {
             entry.info.target_status = follow_status;
             entry.info.has_target_status = true;
 
-            bool follow_is_reg = fs::is_regular_file(follow_status);
-            std::error_code size_ec;
             if (entry.info.is_dir) {
                 entry.info.size = 0;
-            } else if (follow_is_reg) {
-                auto followed_size = fs::file_size(follow_path, size_ec);
-                if (!size_ec) {
-                    entry.info.size = followed_size;
-                }
+            } else if (target.has_size) {
+                entry.info.size = target.size;
             }
         }
 
-        std::error_code time_ec;
-        auto follow_time = fs::last_write_time(follow_path, time_ec);
-        if (!time_ec) {
-            entry.info.mtime = follow_time;
+        if (target.has_mtime) {
+            entry.info.mtime = target.mtime;
         }
     } else if (entry.info.is_symlink && entry.info.has_link_size) {
         entry.info.size = entry.info.link_size;
@@ -730,13 +734,16 @@ void FileScanner::apply_symlink_metadata(Entry& entry) const {
 
 void FileScanner::apply_icon_and_color(Entry& entry) const {
     Theme& theme_manager = Theme::instance();
-    const ThemeColors& theme_colors = theme_manager.colors();
     IconResult icon = theme_manager.get_icon(entry.info.name, entry.info.is_dir, entry.info.is_exec);
     if (!config_.no_icons()) {
         entry.info.icon = icon.icon;
     }
     entry.info.has_recognized_icon = icon.recognized && !entry.info.is_dir;
+    apply_color(entry);
+}
 
+void FileScanner::apply_color(Entry& entry) const {
+    const ThemeColors& theme_colors = Theme::instance().colors();
     if (config_.no_color()) {
         entry.info.color_fg.clear();
         entry.info.color_reset.clear();
@@ -765,6 +772,56 @@ void FileScanner::apply_icon_and_color(Entry& entry) const {
     entry.info.color_reset = theme_colors.reset;
 }
 
+void FileScanner::sniff_entries(std::vector<Entry>& entries, std::size_t from) const {
+    std::vector<std::size_t> candidates;
+    std::vector<fs::path> paths;
+    for (std::size_t i = from; i < entries.size(); ++i) {
+        const FileInfo& info = entries[i].info;
+        if (info.has_recognized_icon || info.is_dir || info.is_symlink || info.is_socket ||
+            info.is_block_device || info.is_char_device || info.stat_timed_out || info.size == 0) {
+            continue;
+        }
+        candidates.push_back(i);
+        paths.push_back(info.path);
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    auto& perf_manager = perf::Manager::Instance();
+    const bool perf_enabled = perf_manager.enabled();
+    std::optional<perf::Timer> timer;
+    if (perf_enabled) {
+        timer.emplace("fs::sniff");
+        perf_manager.IncrementCounter("fs::sniffed_files", candidates.size());
+    }
+
+    const std::vector<SniffResult> results = ContentSniffer::ClassifyFiles(paths);
+    Theme& theme_manager = Theme::instance();
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        const SniffResult& result = results[i];
+        if (!result.matched()) {
+            continue;
+        }
+        IconResult icon = theme_manager.get_type_icon(result.key);
+        if (!icon.recognized && !result.fallback.empty()) {
+            icon = theme_manager.get_type_icon(result.fallback);
+        }
+        if (!icon.recognized) {
+            continue;
+        }
+        Entry& entry = entries[candidates[i]];
+        if (!config_.no_icons()) {
+            entry.info.icon = std::move(icon.icon);
+        }
+        entry.info.has_recognized_icon = true;
+        apply_color(entry);
+        if (perf_enabled) {
+            perf_manager.IncrementCounter("fs::sniff_matches");
+        }
+    }
+}
+
 void FileScanner::report_path_error(const fs::path& path,
                                     const std::error_code& ec,
                                     const char* fallback) const {
@@ -791,7 +848,15 @@ bool FileScanner::add_entry(const fs::directory_entry& de,
 
     Entry entry{};
     entry.info.name = std::move(name);
-    populate_entry(de, entry);
+    throttle();
+    {
+        progress::Scope in_flight(progress::Operation::Stat);
+        populate_entry(de, entry);
+    }
+    return keep_entry(std::move(entry), out);
+}
+
+bool FileScanner::keep_entry(Entry&& entry, std::vector<Entry>& out) const {
     if (config_.dirs_only() && !entry.info.is_dir) {
         return false;
     }
@@ -801,6 +866,10 @@ bool FileScanner::add_entry(const fs::directory_entry& de,
 
     out.push_back(std::move(entry));
 
+    auto& progress_tracker = progress::Tracker::Instance();
+    if (progress_tracker.enabled()) {
+        progress_tracker.AddEntry(out.back().info.size);
+    }
     auto& perf_manager = perf::Manager::Instance();
     if (perf_manager.enabled()) {
         perf_manager.IncrementCounter("entries_included");
@@ -814,9 +883,204 @@ bool FileScanner::add_entry(const fs::directory_entry& de,
     return true;
 }
 
+void FileScanner::throttle(std::uint64_t count) const {
+    if (rate_limiter_) {
+        rate_limiter_->Acquire(count);
+    }
+}
+
+void FileScanner::add_timed_out_entry(const fs::directory_entry& de,
+                                      std::vector<Entry>& out) const {
+    Entry entry{};
+    entry.info.name = de.path().filename().string();
+    entry.info.path = de.path();
+    entry.info.is_hidden = StringUtils::IsHidden(entry.info.name);
+    entry.info.stat_timed_out = true;
+    entry.info.owner = "?";
+    entry.info.group = "?";
+    apply_icon_and_color(entry);
+    keep_entry(std::move(entry), out);
+}
+
+VisitResult FileScanner::flush_probed_entries(std::vector<fs::directory_entry>& pending,
+                                              std::vector<Entry>& out) const {
+    VisitResult status = VisitResult::Ok;
+    if (pending.empty()) {
+        return status;
+    }
+
+    // Each worker fills its own entry; the shared_ptr keeps it alive for a
+    // worker that is still stuck after we have moved on.
+    std::vector<std::shared_ptr<ProbedEntry>> entries;
+    std::vector<StatProbePool::Probe> probes;
+    entries.reserve(pending.size());
+    probes.reserve(pending.size());
+    const bool dereference = config_.dereference();
+    for (const auto& de : pending) {
+        auto probed = std::make_shared<ProbedEntry>();
+        probed->entry.info.name = de.path().filename().string();
+        probes.push_back({de.path(), [probed, de, dereference] { read_entry_metadata(de, dereference, probed->entry); }});
+        entries.push_back(std::move(probed));
+    }
+    std::vector<bool> responsive;
+    throttle(probes.size());
+    {
+        progress::Scope in_flight(progress::Operation::Stat);
+        responsive = stat_probe_->ProbeAll(std::move(probes));
+    }
+
+    // Following a symlink and listing attributes go back to the filesystem,
+    // through a link possibly onto another mount, so they get a second
+    // round. A link is probed under its target's path.
+    const bool with_xattr = config_.format() == Config::Format::Long;
+    std::vector<std::size_t> followed;
+    probes.clear();
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        const FileInfo& info = entries[i]->entry.info;
+        if (!responsive[i] || (!with_xattr && !info.is_symlink)) {
+            continue;
+        }
+        fs::path probe_path = info.path;
+        if (auto resolved = SymlinkResolver::ResolveTarget(info)) {
+            probe_path = std::move(*resolved);
+        }
+        probes.push_back({std::move(probe_path), [probed = entries[i], dereference, with_xattr] {
+            FileInfo& probed_info = probed->entry.info;
+            if (probed_info.is_symlink) {
+                probed->target = SymlinkResolver::ReadTarget(probed_info, dereference);
+                probed_info.is_broken_symlink = probed->target.broken;
+            }
+            if (with_xattr) {
+                probed->xattr = XattrResolver::Read(probed_info, dereference);
+            }
+        }});
+        followed.push_back(i);
+    }
+    if (!followed.empty()) {
+        std::vector<bool> answered;
+        {
+            progress::Scope in_flight(progress::Operation::Stat);
+            answered = stat_probe_->ProbeAll(std::move(probes));
+        }
+        for (std::size_t k = 0; k < followed.size(); ++k) {
+            if (!answered[k]) {
+                responsive[followed[k]] = false;
+            }
+        }
+    }
+
+    auto& perf_manager = perf::Manager::Instance();
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        if (responsive[i]) {
+            ProbedEntry& probed = *entries[i];
+            Entry& entry = probed.entry;
+            if (entry.info.is_symlink) {
+                symlink_resolver_.Remember(entry.info, probed.target);
+            }
+            resolve_entry_metadata(entry, false);
+            if (with_xattr) {
+                entry.info.xattr_indicator = xattr_resolver_.Indicator(entry.info, dereference, &probed.xattr);
+            }
+            keep_entry(std::move(entry), out);
+            continue;
+        }
+        report_path_error(pending[i].path(), {}, "metadata timed out");
+        add_timed_out_entry(pending[i], out);
+        if (perf_manager.enabled()) {
+            perf_manager.IncrementCounter("fs::stat_timeouts");
+        }
+        status = VisitResult::Minor;
+    }
+    pending.clear();
+    return status;
+}
+
+void FileScanner::flush_probed_directories(std::vector<fs::directory_entry>& pending,
+                                           std::vector<fs::path>& out) const {
+    if (pending.empty()) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Entry>> entries;
+    std::vector<StatProbePool::Probe> probes;
+    entries.reserve(pending.size());
+    probes.reserve(pending.size());
+    for (const auto& de : pending) {
+        auto entry = std::make_shared<Entry>();
+        probes.push_back({de.path(), [entry, de] {
+            std::error_code info_ec;
+            entry->info.is_symlink = de.is_symlink(info_ec);
+            info_ec.clear();
+            entry->info.is_dir = de.is_directory(info_ec) && !info_ec;
+        }});
+        entries.push_back(std::move(entry));
+    }
+    std::vector<bool> responsive;
+    {
+        progress::Scope in_flight(progress::Operation::Stat);
+        responsive = stat_probe_->ProbeAll(std::move(probes));
+    }
+
+    // A child that did not answer was reported when its parent was listed.
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        const FileInfo& info = entries[i]->info;
+        if (responsive[i] && info.is_dir && (config_.dereference() || !info.is_symlink)) {
+            out.push_back(pending[i].path());
+        }
+    }
+    pending.clear();
+}
+
+fs::directory_iterator FileScanner::open_directory(const fs::path& dir, std::error_code& ec) const {
+    if (!stat_probe_) {
+        return fs::directory_iterator(dir, ec);
+    }
+
+    struct Opened {
+        fs::directory_iterator it;
+        std::error_code ec;
+    };
+    auto opened = std::make_shared<Opened>();
+    std::vector<StatProbePool::Probe> probes;
+    probes.push_back({dir, [opened, dir] { opened->it = fs::directory_iterator(dir, opened->ec); }});
+    if (!stat_probe_->ProbeAll(std::move(probes)).front()) {
+        report_path_error(dir, {}, "directory open timed out");
+        auto& perf_manager = perf::Manager::Instance();
+        if (perf_manager.enabled()) {
+            perf_manager.IncrementCounter("fs::stat_timeouts");
+        }
+        ec = std::make_error_code(std::errc::timed_out);
+        return {};
+    }
+    ec = opened->ec;
+    return std::move(opened->it);
+}
+
 VisitResult FileScanner::collect_entries(const fs::path& dir,
                                          std::vector<Entry>& out,
                                          bool is_top_level) const {
+    return collect_entries_impl(dir, out, is_top_level, nullptr, 0);
+}
+
+VisitResult FileScanner::stream_entries(const fs::path& dir,
+                                        std::size_t batch_size,
+                                        const EntryBatchSink& sink,
+                                        bool is_top_level) const {
+    std::vector<Entry> batch;
+    batch.reserve(batch_size);
+    VisitResult status = collect_entries_impl(dir, batch, is_top_level, &sink, batch_size);
+    if (!batch.empty()) {
+        sink(batch);
+        batch.clear();
+    }
+    return status;
+}
+
+VisitResult FileScanner::collect_entries_impl(const fs::path& dir,
+                                              std::vector<Entry>& out,
+                                              bool is_top_level,
+                                              const EntryBatchSink* sink,
+                                              std::size_t batch_size) const {
     VisitResult status = VisitResult::Ok;
 
     auto& perf_manager = perf::Manager::Instance();
@@ -860,6 +1124,10 @@ VisitResult FileScanner::collect_entries(const fs::path& dir,
         if (perf_enabled) {
             perf_manager.IncrementCounter("directories_scanned");
         }
+        auto& progress_tracker = progress::Tracker::Instance();
+        if (progress_tracker.enabled()) {
+            progress_tracker.EnterDirectory(dir);
+        }
         if (config_.all()) {
             std::error_code self_ec;
             fs::directory_entry self(dir, self_ec);
@@ -871,18 +1139,49 @@ VisitResult FileScanner::collect_entries(const fs::path& dir,
         }
 
         std::error_code iter_ec;
-        fs::directory_iterator it(dir, iter_ec);
+        throttle();
+        std::optional<progress::Scope> reading(std::in_place, progress::Operation::ReadDirectory);
+        fs::directory_iterator it = open_directory(dir, iter_ec);
+        reading.reset();
         if (iter_ec) {
-            report_path_error(dir, iter_ec, "Unable to open directory");
+            if (iter_ec != std::errc::timed_out) {
+                report_path_error(dir, iter_ec, "Unable to open directory");
+            }
             return is_top_level ? VisitResult::Serious : VisitResult::Minor;
         }
 
         fs::directory_iterator end;
-        while (it != end) {
-            add_entry(*it, out, {}, false);
-            it.increment(iter_ec);
+        std::vector<fs::directory_entry> pending;
+        std::size_t sniff_from = out.size();
+        while (it != end && !Cancellation::Requested()) {
+            if (!stat_probe_) {
+                add_entry(*it, out, {}, false);
+            } else if (should_include(it->path().filename().string(), false)) {
+                pending.push_back(*it);
+                if (pending.size() >= kStatProbeBatch) {
+                    status = VisitResultAggregator::Combine(status, flush_probed_entries(pending, out));
+                }
+            }
+            if (sink && out.size() >= batch_size) {
+                if (config_.sniff()) {
+                    sniff_entries(out, sniff_from);
+                    sniff_from = 0;
+                }
+                (*sink)(out);
+                out.clear();
+            }
+            {
+                progress::Scope in_flight(progress::Operation::ReadDirectory);
+                it.increment(iter_ec);
+            }
             if (iter_ec) break;
         }
+        if (stat_probe_) {
+            status = VisitResultAggregator::Combine(status, flush_probed_entries(pending, out));
+        }
+        if (config_.sniff()) {
+            sniff_entries(out, sniff_from);
+        }
         if (iter_ec) {
             report_path_error(dir, iter_ec, "Unable to read directory");
             status = VisitResultAggregator::Combine(status, is_top_level ? VisitResult::Serious : VisitResult::Minor);
@@ -938,7 +1237,11 @@ VisitResult FileScanner::collect_entries(const fs::path& dir,
             report_path_error(dir, entry_ec, "Unable to access");
             return is_top_level ? VisitResult::Serious : VisitResult::Minor;
         }
+        const std::size_t sniff_from = out.size();
         add_entry(de, out, {}, true);
+        if (config_.sniff()) {
+            sniff_entries(out, sniff_from);
+        }
     }
     return status;
 }
@@ -947,14 +1250,18 @@ VisitResult FileScanner::collect_child_directories(const fs::path& dir,
                                                    std::vector<fs::path>& out,
                                                    bool is_top_level) const {
     std::error_code iter_ec;
-    fs::directory_iterator it(dir, iter_ec);
+    throttle();
+    fs::directory_iterator it = open_directory(dir, iter_ec);
     if (iter_ec) {
-        report_path_error(dir, iter_ec, "Unable to open directory");
+        if (iter_ec != std::errc::timed_out) {
+            report_path_error(dir, iter_ec, "Unable to open directory");
+        }
         return is_top_level ? VisitResult::Serious : VisitResult::Minor;
     }
 
     fs::directory_iterator end;
-    while (it != end) {
+    std::vector<fs::directory_entry> pending;
+    while (it != end && !Cancellation::Requested()) {
         const fs::directory_entry& de = *it;
         const std::string name = de.path().filename().string();
         if (name == "." || name == "..") {
@@ -975,15 +1282,25 @@ VisitResult FileScanner::collect_child_directories(const fs::path& dir,
         }
 #endif
 
-        std::error_code info_ec;
-        const bool is_dir = de.is_directory(info_ec);
-        if (!info_ec && is_dir && !de.is_symlink(info_ec)) {
-            out.push_back(de.path());
+        if (stat_probe_) {
+            pending.push_back(de);
+            if (pending.size() >= kStatProbeBatch) {
+                flush_probed_directories(pending, out);
+            }
+        } else {
+            std::error_code info_ec;
+            const bool is_dir = de.is_directory(info_ec);
+            if (!info_ec && is_dir && (config_.dereference() || !de.is_symlink(info_ec))) {
+                out.push_back(de.path());
+            }
         }
 
         it.increment(iter_ec);
         if (iter_ec) break;
     }
+    if (stat_probe_) {
+        flush_probed_directories(pending, out);
+    }
 
     if (iter_ec) {
         report_path_error(dir, iter_ec, "Unable to read directory");
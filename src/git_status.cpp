@@ -1,14 +1,26 @@
 #include "git_status.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <thread>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
+#include "cancellation.h"
 #include "perf.h"
+#include "resources.h"
 #include "theme.h"
 
 namespace fs = std::filesystem;
@@ -52,6 +64,24 @@ std::string GitStatusResult::FormatPrefixFor(const std::string& rel_path,
     return FormatPrefix(modes, is_dir, is_empty_dir, no_color);
 }
 
+std::string GitStatusResult::FormatDiffStatFor(const std::string& rel_path, bool no_color) const {
+    auto it = diffstats.find(rel_path);
+    if (it == diffstats.end()) return {};
+    const GitDiffStat& stat = it->second;
+    if (stat.binary) return "bin";
+
+    const std::string added = "+" + std::to_string(stat.added);
+    const std::string removed = "-" + std::to_string(stat.removed);
+    if (no_color) return added + ' ' + removed;
+
+    const ThemeColors& theme = Theme::instance().colors();
+    auto paint = [&](const std::string& color, const std::string& text) {
+        return color.empty() ? text : color + text + theme.reset;
+    };
+    return paint(theme.color_or("addition", "\x1b[32m"), added) + ' ' +
+           paint(theme.color_or("deletion", "\x1b[31m"), removed);
+}
+
 std::string GitStatusResult::FormatPrefix(const std::set<std::string>* modes,
                                           bool is_dir,
                                           bool is_empty_dir,
@@ -148,7 +178,20 @@ std::string GitStatusResult::FormatPrefix(const std::set<std::string>* modes,
 class GitStatusImpl {
 public:
     virtual ~GitStatusImpl() = default;
-    virtual GitStatusResult GetStatus(const fs::path& dir, bool recursive) = 0;
+    virtual GitStatusResult GetStatus(const fs::path& dir, bool recursive, bool diffstat) = 0;
+
+    void SetMaxJobs(std::size_t jobs) { max_jobs_ = jobs; }
+
+protected:
+    static constexpr std::size_t kMaxWorkers = 8;
+
+    [[nodiscard]] std::size_t WorkerCount(std::size_t tasks) const {
+        const std::size_t hardware = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        const std::size_t limit = max_jobs_ != 0 ? max_jobs_ : std::min(hardware, kMaxWorkers);
+        return std::min(limit, tasks);
+    }
+
+    std::size_t max_jobs_ = 0;
 };
 
 #if NLS_USE_LIBGIT2
@@ -162,22 +205,57 @@ struct StatusListDeleter {
     void operator()(git_status_list* list) const noexcept { git_status_list_free(list); }
 };
 
+struct ReferenceDeleter {
+    void operator()(git_reference* ref) const noexcept { git_reference_free(ref); }
+};
+
+struct ObjectDeleter {
+    void operator()(git_object* object) const noexcept { git_object_free(object); }
+};
+
+struct TreeEntryDeleter {
+    void operator()(git_tree_entry* entry) const noexcept { git_tree_entry_free(entry); }
+};
+
+struct BlobDeleter {
+    void operator()(git_blob* blob) const noexcept { git_blob_free(blob); }
+};
+
+struct PatchDeleter {
+    void operator()(git_patch* patch) const noexcept { git_patch_free(patch); }
+};
+
+struct FilterListDeleter {
+    void operator()(git_filter_list* filters) const noexcept { git_filter_list_free(filters); }
+};
+
+std::string OidHex(const git_oid& oid) {
+    char buffer[65] = {};  // Room for SHA-256 object ids as well.
+    git_oid_tostr(buffer, sizeof(buffer), &oid);
+    return buffer;
+}
+
 class LibGit2StatusImpl : public GitStatusImpl {
 public:
     LibGit2StatusImpl() { git_libgit2_init(); }
 
     ~LibGit2StatusImpl() override {
-        cached_repo_.reset();
+        SaveDiffStatCache();
+        repositories_.clear();
         git_libgit2_shutdown();
     }
 
-    GitStatusResult GetStatus(const fs::path& dir, bool recursive) override {
+    GitStatusResult GetStatus(const fs::path& dir, bool recursive, bool diffstat) override {
         GitStatusResult result;
         Repository* repository = EnsureRepository(dir);
         if (!repository) {
             return result;
         }
 
+        diff_requests_.clear();
+        collect_diffstats_ = diffstat;
+        diffstat_nested_ = recursive;
+
         result.repository_found = true;
 
         fs::path base_dir = DetermineBaseDir(dir);
@@ -193,6 +271,13 @@ public:
         std::string dir_string = dir_abs.generic_string();
         const bool dir_is_repo_root = dir_string == repository->root_generic;
 
+        // Submodules below the listed directory are opened and scanned on
+        // worker threads instead of serially inside the superproject status.
+        std::vector<const Submodule*> submodules = SubmodulesWithin(*repository, dir_string);
+        if (!submodules.empty()) {
+            options.flags |= GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+        }
+
         std::string rel_dir_str;
         char* pathspec_storage[1] = {nullptr};
         if (IsWithin(repository->root_generic, dir_string)) {
@@ -244,8 +329,12 @@ public:
                                                     result,
                                                     options.flags,
                                                     options.show)) {
+                        FoldSubmoduleStatuses(*repository, submodules, dir_string, dir_is_repo_root, result);
+                        FillDiffStats(*repository, result);
                         return result;
                     }
+                    // The full status list below reports every path again.
+                    diff_requests_.clear();
                 }
             }
         }
@@ -273,19 +362,36 @@ public:
                           dir_is_repo_root);
         }
 
+        FoldSubmoduleStatuses(*repository, submodules, dir_string, dir_is_repo_root, result);
+        FillDiffStats(*repository, result);
         return result;
     }
 
 private:
+    struct Submodule {
+        std::string path;  // relative to the superproject root
+        git_oid recorded_id{};
+        bool has_recorded_id = false;
+        bool staged = false;  // index gitlink differs from HEAD's
+    };
+
     struct Repository {
         using RepositoryHandle = std::unique_ptr<git_repository, RepositoryDeleter>;
         RepositoryHandle handle;
         fs::path root;
         std::string root_generic;
+        std::optional<std::vector<Submodule>> submodules;
+    };
+
+    struct SubmoduleJob {
+        const Submodule* submodule = nullptr;
+        // Status bits with paths relative to the superproject root.
+        std::vector<std::pair<unsigned, std::string>> statuses;
+        std::chrono::steady_clock::duration elapsed{};
     };
 
     struct StatusForeachPayload {
-        const LibGit2StatusImpl* self;
+        LibGit2StatusImpl* self;
         GitStatusResult* result;
         const std::string* repo_root_generic;
         const std::string* dir_string;
@@ -335,7 +441,7 @@ private:
                        const std::string& relative_from_repo,
                        const std::string& repo_root_generic,
                        const std::string& dir_string,
-                       bool dir_is_repo_root) const {
+                       bool dir_is_repo_root) {
         const std::string code = ToPorcelainCode(status);
         if (code.empty()) return;
 
@@ -377,6 +483,10 @@ private:
         }
 
         auto slash = relative.find('/');
+        if (collect_diffstats_ && (status & (GIT_STATUS_INDEX_MODIFIED | GIT_STATUS_WT_MODIFIED)) &&
+            (diffstat_nested_ || slash == std::string::npos)) {
+            diff_requests_.push_back({relative_from_repo, relative});
+        }
         std::string key = (slash == std::string::npos) ? relative : relative.substr(0, slash);
         if (!key.empty()) {
             result.entries[key].insert(code);
@@ -389,7 +499,7 @@ private:
                                      bool dir_is_repo_root,
                                      GitStatusResult& result,
                                      unsigned int flags,
-                                     git_status_show_t show) const {
+                                     git_status_show_t show) {
         std::error_code iter_ec;
         fs::directory_iterator it(dir_abs, iter_ec);
         if (iter_ec) {
@@ -471,7 +581,7 @@ private:
                                     bool dir_is_repo_root,
                                     unsigned int flags,
                                     git_status_show_t show,
-                                    GitStatusResult& result) const {
+                                    GitStatusResult& result) {
         if (relative_path.empty()) return true;
 
         git_status_options options = GIT_STATUS_OPTIONS_INIT;
@@ -560,19 +670,488 @@ private:
         return candidate[root.size()] == '/';
     }
 
+    static int CollectSubmodule(git_submodule* submodule, const char* /*name*/, void* payload) {
+        auto* submodules = static_cast<std::vector<Submodule>*>(payload);
+        const char* path = git_submodule_path(submodule);
+        if (!path || !path[0]) return 0;
+        Submodule entry;
+        entry.path = path;
+        if (const git_oid* recorded = git_submodule_index_id(submodule)) {
+            git_oid_cpy(&entry.recorded_id, recorded);
+            entry.has_recorded_id = true;
+            const git_oid* head = git_submodule_head_id(submodule);
+            entry.staged = head && !git_oid_equal(head, recorded);
+        }
+        submodules->push_back(std::move(entry));
+        return 0;
+    }
+
+    std::vector<const Submodule*> SubmodulesWithin(Repository& repository, const std::string& dir_string) {
+        if (!repository.submodules) {
+            repository.submodules.emplace();
+            if (git_submodule_foreach(repository.handle.get(),
+                                      &LibGit2StatusImpl::CollectSubmodule,
+                                      &*repository.submodules) != 0) {
+                repository.submodules->clear();
+            }
+        }
+
+        std::vector<const Submodule*> within;
+        for (const auto& submodule : *repository.submodules) {
+            const std::string absolute = repository.root_generic + '/' + submodule.path;
+            if (absolute != dir_string && IsWithin(dir_string, absolute)) {
+                within.push_back(&submodule);
+            }
+        }
+        return within;
+    }
+
+    // Nested submodules deeper than this are not inspected; it also stops a
+    // submodule that (through a misconfigured URL) contains itself.
+    static constexpr int kMaxSubmoduleDepth = 8;
+
+    // Runs on a worker thread with its own handle for the submodule. A
+    // checked-out commit that differs from the superproject's gitlink marks
+    // the submodule itself as modified, like git status does.
+    static void ScanSubmodule(const fs::path& super_root, unsigned flags, SubmoduleJob& job) {
+        const auto start = std::chrono::steady_clock::now();
+        ScanSubmoduleTree(super_root, *job.submodule, std::string(), flags, 0, job.statuses);
+        job.elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+    // Reports submodule's gitlink and working tree under prefix, the path of
+    // its superproject relative to the outermost one, then does the same for
+    // the submodules nested inside it. Status lists exclude submodules, so
+    // without this a change two levels down would leave every enclosing
+    // gitlink looking clean.
+    static void ScanSubmoduleTree(const fs::path& super_root,
+                                  const Submodule& submodule,
+                                  const std::string& prefix,
+                                  unsigned flags,
+                                  int depth,
+                                  std::vector<std::pair<unsigned, std::string>>& statuses) {
+        const std::string display_path = prefix + submodule.path;
+        const fs::path root = super_root / fs::path(submodule.path);
+        git_repository* raw_repo = nullptr;
+        if (git_repository_open(&raw_repo, root.string().c_str()) != 0) {
+            // Not initialised: only a staged gitlink change can be reported.
+            if (submodule.staged) {
+                statuses.emplace_back(static_cast<unsigned>(GIT_STATUS_INDEX_MODIFIED), display_path);
+            }
+            return;
+        }
+        RepositoryHandle repo(raw_repo);
+
+        unsigned gitlink_status = submodule.staged ? static_cast<unsigned>(GIT_STATUS_INDEX_MODIFIED) : 0u;
+        git_oid head_id{};
+        if (submodule.has_recorded_id &&
+            git_reference_name_to_id(&head_id, repo.get(), "HEAD") == 0 &&
+            !git_oid_equal(&head_id, &submodule.recorded_id)) {
+            gitlink_status |= GIT_STATUS_WT_MODIFIED;
+        }
+        if (gitlink_status != 0) {
+            statuses.emplace_back(gitlink_status, display_path);
+        }
+
+        git_status_options options = GIT_STATUS_OPTIONS_INIT;
+        options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+        options.flags = flags;
+        git_status_list* raw_list = nullptr;
+        if (git_status_list_new(&raw_list, repo.get(), &options) == 0) {
+            StatusListHandle list(raw_list);
+            const size_t count = git_status_list_entrycount(list.get());
+            for (size_t i = 0; i < count; ++i) {
+                const git_status_entry* entry = git_status_byindex(list.get(), i);
+                if (!entry) continue;
+                std::string relative = ExtractPathFromEntry(*entry);
+                if (relative.empty()) continue;
+                statuses.emplace_back(entry->status, display_path + '/' + relative);
+            }
+        }
+
+        if (depth + 1 >= kMaxSubmoduleDepth || Cancellation::Requested()) {
+            return;
+        }
+        std::vector<Submodule> nested;
+        if (git_submodule_foreach(repo.get(), &LibGit2StatusImpl::CollectSubmodule, &nested) != 0) {
+            return;
+        }
+        for (const auto& child : nested) {
+            ScanSubmoduleTree(root, child, display_path + '/', flags, depth + 1, statuses);
+        }
+    }
+
+    void FoldSubmoduleStatuses(Repository& repository,
+                               const std::vector<const Submodule*>& submodules,
+                               const std::string& dir_string,
+                               bool dir_is_repo_root,
+                               GitStatusResult& result) {
+        if (submodules.empty()) return;
+
+        // Ignored files inside a submodule never change how its directory
+        // is shown in the superproject listing.
+        const unsigned flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED |
+                               GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS |
+                               GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+        std::vector<SubmoduleJob> jobs(submodules.size());
+        for (std::size_t i = 0; i < submodules.size(); ++i) {
+            jobs[i].submodule = submodules[i];
+        }
+
+        std::atomic<std::size_t> next{0};
+        const auto worker = [&]() {
+            for (std::size_t i = next.fetch_add(1); i < jobs.size() && !Cancellation::Requested();
+                 i = next.fetch_add(1)) {
+                ScanSubmodule(repository.root, flags, jobs[i]);
+            }
+        };
+        const std::size_t thread_count = WorkerCount(jobs.size());
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for (std::size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        auto& perf_manager = perf::Manager::Instance();
+        for (const auto& job : jobs) {
+            if (perf_manager.enabled()) {
+                perf_manager.AddDuration("git_status::submodule " + job.submodule->path, job.elapsed);
+            }
+            for (const auto& [status, path] : job.statuses) {
+                ProcessStatus(result, status, path, repository.root_generic, dir_string, dir_is_repo_root);
+            }
+        }
+        if (perf_manager.enabled()) {
+            perf_manager.IncrementCounter("git_status::submodules", jobs.size());
+            perf_manager.IncrementCounter("git_status::submodule_threads", thread_count);
+        }
+    }
+
+    struct DiffStatRequest {
+        std::string repo_path;
+        std::string key;
+    };
+
+    struct DiffStatJob {
+        const DiffStatRequest* request = nullptr;
+        git_oid head_id{};
+        std::string head_hex;
+        std::optional<GitDiffStat> stat;
+        std::string cache_key;
+        bool fresh = false;
+    };
+
+    static fs::path DiffStatCacheFile() {
+        const fs::path config_dir = ResourceManager::userConfigDir();
+        if (config_dir.empty()) {
+            return {};
+        }
+        return config_dir.parent_path() / "cache" / "git-diffstats";
+    }
+
+    // Reads the working tree file as it would be stored in the object
+    // database (clean filters such as CRLF conversion applied) so its blob
+    // id matches what git would record.
+    static bool ReadWorkdirBlob(git_repository* repo,
+                                const fs::path& root,
+                                const std::string& repo_path,
+                                std::string& content) {
+        git_filter_list* raw_filters = nullptr;
+        if (git_filter_list_load(&raw_filters, repo, nullptr, repo_path.c_str(),
+                                 GIT_FILTER_TO_ODB, GIT_FILTER_DEFAULT) != 0) {
+            return false;
+        }
+        if (raw_filters) {
+            std::unique_ptr<git_filter_list, FilterListDeleter> filters(raw_filters);
+            git_buf filtered{};
+            if (git_filter_list_apply_to_file(&filtered, filters.get(), repo, repo_path.c_str()) != 0) {
+                git_buf_dispose(&filtered);
+                return false;
+            }
+            content.assign(filtered.ptr ? filtered.ptr : "", filtered.size);
+            git_buf_dispose(&filtered);
+            return true;
+        }
+
+        std::ifstream in(root / fs::path(repo_path), std::ios::binary);
+        if (!in) return false;
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !in.bad();
+    }
+
+    static std::optional<GitDiffStat> DiffAgainstHead(git_repository* repo,
+                                                      const DiffStatJob& job,
+                                                      const std::string& content) {
+        git_blob* raw_blob = nullptr;
+        if (git_blob_lookup(&raw_blob, repo, &job.head_id) != 0) {
+            return std::nullopt;
+        }
+        std::unique_ptr<git_blob, BlobDeleter> blob(raw_blob);
+
+        const char* path = job.request->repo_path.c_str();
+        git_patch* raw_patch = nullptr;
+        if (git_patch_from_blob_and_buffer(&raw_patch, blob.get(), path,
+                                           content.data(), content.size(), path, nullptr) != 0) {
+            return std::nullopt;
+        }
+        std::unique_ptr<git_patch, PatchDeleter> patch(raw_patch);
+
+        GitDiffStat stat;
+        const git_diff_delta* delta = git_patch_get_delta(patch.get());
+        stat.binary = delta && (delta->flags & GIT_DIFF_FLAG_BINARY) != 0;
+        std::size_t context = 0;
+        if (git_patch_line_stats(&context, &stat.added, &stat.removed, patch.get()) != 0) {
+            return std::nullopt;
+        }
+        return stat;
+    }
+
+    // Diffs the requested modified files against their HEAD blobs on a small
+    // pool. Every worker opens its own repository handle since libgit2
+    // objects are not shared across threads; results are cached by the
+    // (HEAD blob, working tree blob) pair, in memory and on disk.
+    void FillDiffStats(Repository& repository, GitStatusResult& result) {
+        if (!collect_diffstats_ || diff_requests_.empty()) return;
+
+        auto& perf_manager = perf::Manager::Instance();
+        const bool perf_enabled = perf_manager.enabled();
+        std::optional<perf::Timer> timer;
+        if (perf_enabled) {
+            timer.emplace("git_status::diffstat");
+        }
+        if (!diffstat_cache_loaded_) {
+            LoadDiffStatCache();
+        }
+
+        git_reference* raw_head = nullptr;
+        if (git_repository_head(&raw_head, repository.handle.get()) != 0) {
+            return;
+        }
+        std::unique_ptr<git_reference, ReferenceDeleter> head(raw_head);
+        git_object* raw_tree = nullptr;
+        if (git_reference_peel(&raw_tree, head.get(), GIT_OBJECT_TREE) != 0) {
+            return;
+        }
+        std::unique_ptr<git_object, ObjectDeleter> tree(raw_tree);
+
+        std::vector<DiffStatJob> jobs;
+        jobs.reserve(diff_requests_.size());
+        for (const auto& request : diff_requests_) {
+            if (result.diffstats.contains(request.key)) continue;
+            git_tree_entry* raw_entry = nullptr;
+            if (git_tree_entry_bypath(&raw_entry,
+                                      reinterpret_cast<const git_tree*>(tree.get()),
+                                      request.repo_path.c_str()) != 0) {
+                continue;
+            }
+            std::unique_ptr<git_tree_entry, TreeEntryDeleter> entry(raw_entry);
+            // Symlinks and submodules have no line-based content to count.
+            if (git_tree_entry_type(entry.get()) != GIT_OBJECT_BLOB ||
+                git_tree_entry_filemode(entry.get()) == GIT_FILEMODE_LINK) {
+                continue;
+            }
+            DiffStatJob job;
+            job.request = &request;
+            git_oid_cpy(&job.head_id, git_tree_entry_id(entry.get()));
+            job.head_hex = OidHex(job.head_id);
+            jobs.push_back(std::move(job));
+            result.diffstats.emplace(request.key, GitDiffStat{});
+        }
+        if (jobs.empty()) return;
+
+        const std::string root = repository.root.string();
+        std::atomic<std::size_t> next{0};
+        const auto worker = [&]() {
+            git_repository* raw_repo = nullptr;
+            if (git_repository_open(&raw_repo, root.c_str()) != 0) {
+                return;
+            }
+            RepositoryHandle repo(raw_repo);
+            std::string content;
+            for (std::size_t i = next.fetch_add(1); i < jobs.size() && !Cancellation::Requested();
+                 i = next.fetch_add(1)) {
+                DiffStatJob& job = jobs[i];
+                if (!ReadWorkdirBlob(repo.get(), repository.root, job.request->repo_path, content)) {
+                    continue;
+                }
+                git_oid workdir_id{};
+                if (git_odb_hash(&workdir_id, content.data(), content.size(), GIT_OBJECT_BLOB) != 0) {
+                    continue;
+                }
+                job.cache_key = job.head_hex + ' ' + OidHex(workdir_id);
+                // The cache is only read while the workers run.
+                auto cached = diffstat_cache_.find(job.cache_key);
+                if (cached != diffstat_cache_.end()) {
+                    job.stat = cached->second;
+                    continue;
+                }
+                job.stat = DiffAgainstHead(repo.get(), job, content);
+                job.fresh = job.stat.has_value();
+            }
+        };
+        const std::size_t thread_count = WorkerCount(jobs.size());
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for (std::size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::size_t diffed = 0;
+        for (auto& job : jobs) {
+            if (!job.stat) {
+                result.diffstats.erase(job.request->key);
+                continue;
+            }
+            result.diffstats[job.request->key] = *job.stat;
+            diffstat_order_.push_back(job.cache_key);
+            if (job.fresh) {
+                ++diffed;
+                diffstat_cache_.emplace(job.cache_key, *job.stat);
+                diffstat_cache_dirty_ = true;
+            }
+        }
+        if (perf_enabled) {
+            perf_manager.IncrementCounter("git_status::diffstat_files", jobs.size());
+            perf_manager.IncrementCounter("git_status::diffstat_diffed", diffed);
+        }
+    }
+
+    void LoadDiffStatCache() {
+        diffstat_cache_loaded_ = true;
+        const fs::path cache_file = DiffStatCacheFile();
+        if (cache_file.empty()) return;
+        std::ifstream in(cache_file);
+        if (!in) return;
+
+        // One record per line, oldest first: head_blob workdir_blob added
+        // removed binary.
+        std::size_t records = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            ++records;
+            std::string_view fields[5];
+            std::string_view rest(line);
+            std::size_t count = 0;
+            while (count < std::size(fields) && !rest.empty()) {
+                const auto space = rest.find(' ');
+                fields[count++] = rest.substr(0, space);
+                rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+            }
+            if (count != std::size(fields)) {
+                diffstat_cache_dirty_ = true;
+                continue;
+            }
+
+            GitDiffStat stat;
+            int binary = 0;
+            const auto parse = [](std::string_view text, auto& value) {
+                const auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+                return parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+            };
+            if (!parse(fields[2], stat.added) || !parse(fields[3], stat.removed) || !parse(fields[4], binary)) {
+                diffstat_cache_dirty_ = true;
+                continue;
+            }
+            stat.binary = binary != 0;
+            std::string key(fields[0]);
+            key.push_back(' ');
+            key.append(fields[1]);
+            diffstat_order_.push_back(key);
+            diffstat_cache_[std::move(key)] = stat;
+        }
+        if (records > kMaxCachedDiffStats) {
+            diffstat_cache_dirty_ = true;
+        }
+    }
+
+    // Rewrites the whole cache rather than appending, so it keeps only the
+    // kMaxCachedDiffStats pairs used most recently. A pair of blob ids never
+    // goes stale, but once either side is edited it is not looked up again.
+    void SaveDiffStatCache() {
+        if (!diffstat_cache_dirty_) return;
+        const fs::path cache_file = DiffStatCacheFile();
+        if (cache_file.empty()) return;
+
+        std::vector<const std::string*> keep;
+        std::unordered_set<std::string_view> seen;
+        for (auto it = diffstat_order_.rbegin();
+             it != diffstat_order_.rend() && keep.size() < kMaxCachedDiffStats; ++it) {
+            if (diffstat_cache_.contains(*it) && seen.insert(*it).second) {
+                keep.push_back(&*it);
+            }
+        }
+
+        std::error_code ec;
+        fs::create_directories(cache_file.parent_path(), ec);
+        fs::path temp = cache_file;
+        temp += "." + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            if (!out) return;
+            for (auto it = keep.rbegin(); it != keep.rend(); ++it) {
+                const GitDiffStat& stat = diffstat_cache_.at(**it);
+                out << **it << ' ' << stat.added << ' ' << stat.removed << ' ' << (stat.binary ? 1 : 0) << '\n';
+            }
+            if (!out.flush()) {
+                out.close();
+                fs::remove(temp, ec);
+                return;
+            }
+        }
+        // Several listings may finish at once; the rename keeps the file whole.
+        fs::rename(temp, cache_file, ec);
+        if (ec) {
+            fs::remove(temp, ec);
+            return;
+        }
+        diffstat_cache_dirty_ = false;
+    }
+
     Repository* EnsureRepository(const fs::path& dir) {
         fs::path base_dir = DetermineBaseDir(dir);
         fs::path dir_abs = Canonicalize(base_dir);
         const std::string dir_string = dir_abs.generic_string();
+        auto& perf_manager = perf::Manager::Instance();
 
-        if (cached_repo_ && IsWithin(cached_repo_->root_generic, dir_string)) {
-            return cached_repo_.get();
+        for (auto it = repositories_.begin(); it != repositories_.end(); ++it) {
+            if (IsWithin((*it)->root_generic, dir_string)) {
+                std::rotate(repositories_.begin(), it, std::next(it));
+                return repositories_.front().get();
+            }
+        }
+        if (!dir_string.empty() && repo_less_dirs_.contains(dir_string)) {
+            if (perf_manager.enabled()) {
+                perf_manager.IncrementCounter("git_status::discovery_cached");
+            }
+            return nullptr;
+        }
+
+        // A directory whose parent already failed discovery can only be a
+        // repository itself: everything above it was searched before.
+        const auto slash = dir_string.find_last_of('/');
+        const std::string parent = slash == std::string::npos ? std::string()
+                                   : slash == 0                ? std::string("/")
+                                                               : dir_string.substr(0, slash);
+        const bool parent_repo_less = !parent.empty() && parent != dir_string && repo_less_dirs_.contains(parent);
+        if (perf_manager.enabled()) {
+            perf_manager.IncrementCounter(parent_repo_less ? "git_status::discovery_local"
+                                                           : "git_status::discovery_walks");
         }
 
         fs::path repo_root;
-        RepositoryHandle handle = OpenRepository(base_dir, repo_root);
+        RepositoryHandle handle = OpenRepository(base_dir, repo_root, !parent_repo_less);
         if (!handle) {
-            cached_repo_.reset();
+            if (!dir_string.empty()) {
+                repo_less_dirs_.insert(dir_string);
+            }
             return nullptr;
         }
 
@@ -580,17 +1159,27 @@ private:
         repo->root = repo_root;
         repo->root_generic = repo_root.generic_string();
         repo->handle = std::move(handle);
-        cached_repo_ = std::move(repo);
-        return cached_repo_.get();
+        if (repositories_.size() >= kMaxOpenRepositories) {
+            repositories_.pop_back();
+        }
+        repositories_.insert(repositories_.begin(), std::move(repo));
+        return repositories_.front().get();
     }
 
-    RepositoryHandle OpenRepository(const fs::path& dir, fs::path& repo_root) {
+    RepositoryHandle OpenRepository(const fs::path& dir, fs::path& repo_root, bool search_parents) {
         git_repository* raw_repo = nullptr;
         fs::path search = DetermineBaseDir(dir);
-        int rc = git_repository_open_ext(&raw_repo,
-                                         search.string().c_str(),
-                                         GIT_REPOSITORY_OPEN_CROSS_FS | GIT_REPOSITORY_OPEN_FROM_ENV,
-                                         nullptr);
+        // libgit2 ignores every other flag alongside FROM_ENV. A local lookup
+        // only follows a parent whose discovery already failed with the
+        // environment applied, so GIT_DIR cannot be in play and checking the
+        // directory on its own is enough.
+        unsigned flags = GIT_REPOSITORY_OPEN_CROSS_FS;
+        if (search_parents) {
+            flags |= GIT_REPOSITORY_OPEN_FROM_ENV;
+        } else {
+            flags |= GIT_REPOSITORY_OPEN_NO_SEARCH;
+        }
+        int rc = git_repository_open_ext(&raw_repo, search.string().c_str(), flags, nullptr);
         if (rc != 0) {
             return {};
         }
@@ -611,7 +1200,23 @@ private:
         return handle;
     }
 
-    std::unique_ptr<Repository> cached_repo_;
+    // Repositories stay open while -R or several operands move between
+    // them, most recently used first.
+    static constexpr std::size_t kMaxOpenRepositories = 8;
+    std::vector<std::unique_ptr<Repository>> repositories_;
+    // Canonical directories for which discovery found no repository in the
+    // directory or any of its parents.
+    std::unordered_set<std::string> repo_less_dirs_;
+    std::vector<DiffStatRequest> diff_requests_;
+    bool collect_diffstats_ = false;
+    bool diffstat_nested_ = false;
+    // About 100 bytes each on disk.
+    static constexpr std::size_t kMaxCachedDiffStats = 20000;
+    bool diffstat_cache_loaded_ = false;
+    bool diffstat_cache_dirty_ = false;
+    std::unordered_map<std::string, GitDiffStat> diffstat_cache_;
+    // Cache keys oldest first; a key is appended again each time it is used.
+    std::vector<std::string> diffstat_order_;
 };
 
 } // namespace
@@ -622,31 +1227,58 @@ namespace {
 
 class NoopStatusImpl : public GitStatusImpl {
 public:
-    GitStatusResult GetStatus(const fs::path& /*dir*/, bool /*recursive*/) override { return {}; }
+    GitStatusResult GetStatus(const fs::path& /*dir*/, bool /*recursive*/, bool /*diffstat*/) override {
+        return {};
+    }
 };
 
 } // namespace
 
 #endif
 
-GitStatus::GitStatus()
+// libgit2 sets up its allocators, thread-local state and (depending on the
+// build) TLS libraries in git_libgit2_init(), so the implementation is only
+// created once a listing actually asks for a status.
+GitStatus::GitStatus() = default;
+
+GitStatus::~GitStatus() = default;
+
+void GitStatus::SetMaxJobs(std::size_t jobs) {
+    max_jobs_ = jobs;
+    if (impl_) {
+        impl_->SetMaxJobs(jobs);
+    }
+}
+
+GitStatusImpl& GitStatus::impl() {
+    if (!impl_) {
+        auto& perf_manager = perf::Manager::Instance();
+        std::optional<perf::Timer> timer;
+        if (perf_manager.enabled()) {
+            timer.emplace("git_status::init");
+        }
 #if NLS_USE_LIBGIT2
-    : impl_(std::make_unique<LibGit2StatusImpl>())
+        impl_ = std::make_unique<LibGit2StatusImpl>();
 #else
-    : impl_(std::make_unique<NoopStatusImpl>())
+        impl_ = std::make_unique<NoopStatusImpl>();
 #endif
-{}
-
-GitStatus::~GitStatus() = default;
+        impl_->SetMaxJobs(max_jobs_);
+    }
+    return *impl_;
+}
 
-GitStatusResult GitStatus::GetStatus(const fs::path& dir, bool recursive) {
+GitStatusResult GitStatus::GetStatus(const fs::path& dir, bool recursive, bool diffstat) {
+    if (Cancellation::Requested()) {
+        return {};
+    }
     auto& perf_manager = perf::Manager::Instance();
     if (!perf_manager.enabled()) {
-        return impl_->GetStatus(dir, recursive);
+        return impl().GetStatus(dir, recursive, diffstat);
     }
 
+    GitStatusImpl& status = impl();
     perf::Timer timer("git_status_impl");
-    return impl_->GetStatus(dir, recursive);
+    return status.GetStatus(dir, recursive, diffstat);
 }
 
 } // namespace nls
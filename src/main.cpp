@@ -1,5 +1,9 @@
 #include "app.h"
+#include "cancellation.h"
 
 int main(int argc, char** argv) {
-    return nls::App{}.run(argc, argv);
+    const int rc = nls::App{}.run(argc, argv);
+    // After App is gone, so caches are saved before a broken pipe ends the
+    // process.
+    return nls::Cancellation::Finish(rc);
 }
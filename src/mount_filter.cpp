@@ -0,0 +1,171 @@
+#include "mount_filter.h"
+
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX 1
+#    endif
+#    include <windows.h>
+#else
+#    include <sys/stat.h>
+#    ifdef __APPLE__
+#        include <sys/mount.h>
+#        include <sys/param.h>
+#    endif
+#endif
+
+#include "perf.h"
+
+namespace fs = std::filesystem;
+
+namespace nls {
+
+namespace {
+
+#ifdef __linux__
+// Mount points in mountinfo escape space, tab, newline and backslash as
+// three-digit octal sequences.
+std::string UnescapeMountField(std::string_view field) {
+    std::string out;
+    out.reserve(field.size());
+    for (std::size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            const char a = field[i + 1];
+            const char b = field[i + 2];
+            const char c = field[i + 3];
+            if (a >= '0' && a <= '3' && b >= '0' && b <= '7' && c >= '0' && c <= '7') {
+                out.push_back(static_cast<char>(((a - '0') << 6) | ((b - '0') << 3) | (c - '0')));
+                i += 3;
+                continue;
+            }
+        }
+        out.push_back(field[i]);
+    }
+    return out;
+}
+#endif
+
+}  // namespace
+
+MountFilter::MountFilter(bool one_file_system, std::vector<std::string> skip_types)
+    : one_file_system_(one_file_system), skip_types_(std::move(skip_types)) {}
+
+bool MountFilter::TypeMatches(const std::string& type, const std::vector<std::string>& skip_types) {
+    for (const auto& skip : skip_types) {
+        if (type == skip || (type.size() > skip.size() && type.compare(0, skip.size(), skip) == 0 &&
+                             type[skip.size()] == '.')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MountFilter::SetRoot(const fs::path& root) {
+    root_ = root;
+    std::error_code ec;
+    absolute_root_ = fs::weakly_canonical(fs::absolute(root, ec), ec);
+    if (ec) {
+        absolute_root_ = fs::absolute(root, ec).lexically_normal();
+    }
+    root_device_ = one_file_system_ ? DeviceOf(root) : std::nullopt;
+}
+
+bool MountFilter::Allows(const fs::path& dir, std::optional<std::uintmax_t> device) {
+    if (!active()) {
+        return true;
+    }
+    auto& perf_manager = perf::Manager::Instance();
+
+    if (one_file_system_ && root_device_) {
+        if (!device) {
+            device = DeviceOf(dir);
+        }
+        if (device && *device != *root_device_) {
+            if (perf_manager.enabled()) {
+                perf_manager.IncrementCounter("mount_filter::other_device");
+            }
+            return false;
+        }
+    }
+
+    if (!skip_types_.empty()) {
+        if (!mounts_loaded_) {
+            LoadMountTable();
+        }
+        if (!skipped_mounts_.empty()) {
+            // Walked paths extend the root without following symlinks, so
+            // rebasing on the canonical root matches the kernel's spelling.
+            const fs::path relative = dir.lexically_relative(root_);
+            const fs::path absolute = (relative.empty() ? dir : absolute_root_ / relative).lexically_normal();
+            if (skipped_mounts_.contains(absolute.string())) {
+                if (perf_manager.enabled()) {
+                    perf_manager.IncrementCounter("mount_filter::skipped_fs");
+                }
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void MountFilter::LoadMountTable() {
+    mounts_loaded_ = true;
+#if defined(__linux__)
+    // Fields: id parent major:minor root mount-point options [optional...] -
+    // fstype source super-options.
+    std::ifstream in("/proc/self/mountinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string id, parent, device, root, mount_point, field;
+        if (!(fields >> id >> parent >> device >> root >> mount_point)) {
+            continue;
+        }
+        while (fields >> field && field != "-") {
+        }
+        std::string type;
+        if (field != "-" || !(fields >> type)) {
+            continue;
+        }
+        if (TypeMatches(type, skip_types_)) {
+            skipped_mounts_.insert(UnescapeMountField(mount_point));
+        }
+    }
+#elif defined(__APPLE__)
+    struct statfs* mounts = nullptr;
+    const int count = ::getmntinfo(&mounts, MNT_NOWAIT);
+    for (int i = 0; i < count; ++i) {
+        if (TypeMatches(mounts[i].f_fstypename, skip_types_)) {
+            skipped_mounts_.insert(mounts[i].f_mntonname);
+        }
+    }
+#endif
+}
+
+std::optional<std::uintmax_t> MountFilter::DeviceOf(const fs::path& dir) {
+#ifdef _WIN32
+    // The volume serial stands in for st_dev.
+    wchar_t volume[MAX_PATH + 1] = {};
+    if (!GetVolumePathNameW(dir.c_str(), volume, MAX_PATH + 1)) {
+        return std::nullopt;
+    }
+    DWORD serial = 0;
+    if (!GetVolumeInformationW(volume, nullptr, 0, &serial, nullptr, nullptr, nullptr, 0)) {
+        return std::nullopt;
+    }
+    return static_cast<std::uintmax_t>(serial);
+#else
+    struct stat st {};
+    if (::stat(dir.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::uintmax_t>(st.st_dev);
+#endif
+}
+
+}  // namespace nls
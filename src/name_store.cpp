@@ -0,0 +1,88 @@
+#include "name_store.h"
+
+#include <algorithm>
+
+namespace nls {
+
+namespace {
+
+void PutVarint(std::string& out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+std::size_t GetVarint(const std::string& in, std::size_t& offset) {
+    std::size_t value = 0;
+    for (unsigned shift = 0; offset < in.size() && shift < 64; shift += 7) {
+        const auto byte = static_cast<unsigned char>(in[offset++]);
+        value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) break;
+    }
+    return value;
+}
+
+}  // namespace
+
+void NameStore::Append(std::string_view value) {
+    std::size_t shared = 0;
+    if (count_ % kRestartInterval == 0) {
+        restarts_.push_back(data_.size());
+    } else {
+        const std::size_t limit = std::min(last_.size(), value.size());
+        const auto mismatch = std::mismatch(value.begin(), value.begin() + static_cast<std::ptrdiff_t>(limit),
+                                            last_.begin());
+        shared = static_cast<std::size_t>(mismatch.first - value.begin());
+    }
+    PutVarint(data_, shared);
+    PutVarint(data_, value.size() - shared);
+    data_.append(value.substr(shared));
+
+    last_.assign(value);
+    ++count_;
+    raw_bytes_ += value.size();
+}
+
+void NameStore::ShrinkToFit() {
+    data_.shrink_to_fit();
+    restarts_.shrink_to_fit();
+    std::string().swap(last_);
+}
+
+std::size_t NameStore::bytes() const noexcept {
+    return data_.capacity() + restarts_.capacity() * sizeof(std::size_t);
+}
+
+std::size_t NameStore::DecodeAt(std::size_t offset, std::string& current) const {
+    const std::size_t shared = GetVarint(data_, offset);
+    const std::size_t suffix = std::min(GetVarint(data_, offset), data_.size() - offset);
+    current.resize(std::min(shared, current.size()));
+    current.append(data_, offset, suffix);
+    return offset + suffix;
+}
+
+bool NameStore::Get(std::size_t index, std::string& out) const {
+    if (index >= count_) {
+        return false;
+    }
+    std::size_t offset = restarts_[index / kRestartInterval];
+    out.clear();
+    for (std::size_t i = 0; i <= index % kRestartInterval; ++i) {
+        offset = DecodeAt(offset, out);
+    }
+    return true;
+}
+
+bool NameStore::Cursor::Next(std::string_view& value) {
+    if (index_ >= store_->count_) {
+        return false;
+    }
+    offset_ = store_->DecodeAt(offset_, current_);
+    ++index_;
+    value = current_;
+    return true;
+}
+
+}  // namespace nls
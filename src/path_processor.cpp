@@ -1,29 +1,413 @@
 #include "path_processor.h"
 
 #include <algorithm>
+#include <charconv>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <iostream>
+#include <numeric>
 #include <optional>
 #include <ranges>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+// newlocale()/strxfrm_l() and their _create_locale()/_strxfrm_l() forms.
+#include <locale.h>
+#include <string.h>
+#ifdef __APPLE__
+#    include <xlocale.h>
+#endif
+#ifndef _WIN32
+#    include <sys/stat.h>
+#endif
+
+#include "cancellation.h"
+#include "content_hash.h"
+#include "external_sort.h"
 #include "perf.h"
+#include "progress.h"
 #include "string_utils.h"
 
 namespace fs = std::filesystem;
 
 namespace nls {
 
+namespace {
+
+constexpr std::size_t kStreamBatchSize = 4096;
+
+// Once the entries of one -1 or -l listing outgrow this, each further
+// sorted run is packed with front-coded names (about 90k entries of a
+// typical directory per run).
+constexpr std::uintmax_t kPackedRunBytes = 64ull * 1024 * 1024;
+
+// NLS_DEBUG_PACK_BYTES=<bytes> lowers the threshold so tests reach packed
+// runs with a small fixture.
+std::uintmax_t PackedRunBytes() {
+    static const std::uintmax_t bytes = [] {
+        const char* env = std::getenv("NLS_DEBUG_PACK_BYTES");
+        std::uintmax_t value = 0;
+        if (env && std::from_chars(env, env + std::strlen(env), value).ec == std::errc() && value > 0) {
+            return value;
+        }
+        return kPackedRunBytes;
+    }();
+    return bytes;
+}
+
+// FNV-1a over the path relative to the listed root, so every host running
+// the same command agrees on the partition regardless of where the tree is
+// mounted or how the binary was built.
+std::size_t ShardOf(std::string_view relative_path, std::size_t shard_count) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char ch : relative_path) {
+        hash ^= ch;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(hash % shard_count);
+}
+
+#ifdef _WIN32
+using CollationLocale = _locale_t;
+#else
+using CollationLocale = locale_t;
+#endif
+
+// The user's LC_COLLATE as a locale object of its own. --collate=locale
+// passes it to each transformation instead of calling setlocale(), so the
+// rest of the process keeps the "C" locale it started with.
+CollationLocale UserCollation() {
+    static const CollationLocale locale = [] {
+#ifdef _WIN32
+        CollationLocale user = _create_locale(LC_COLLATE, "");
+        return user ? user : _create_locale(LC_COLLATE, "C");
+#else
+        CollationLocale user = newlocale(LC_COLLATE_MASK, "", static_cast<locale_t>(0));
+        return user ? user : newlocale(LC_COLLATE_MASK, "C", static_cast<locale_t>(0));
+#endif
+    }();
+    return locale;
+}
+
+std::size_t TransformName(char* dest, const char* source, std::size_t capacity) {
+#ifdef _WIN32
+    return _strxfrm_l(dest, source, capacity, UserCollation());
+#else
+    return strxfrm_l(dest, source, capacity, UserCollation());
+#endif
+}
+
+// strxfrm() key of one name, for callers that see names one at a time.
+std::string CollationKey(const std::string& name) {
+    std::string key(name.size() * 2 + 1, '\0');
+    std::size_t length = TransformName(key.data(), name.c_str(), key.size());
+    if (length >= key.size()) {
+        key.resize(length + 1);
+        length = TransformName(key.data(), name.c_str(), key.size());
+    }
+    key.resize(length);
+    return key;
+}
+
+// Sort keys produced by strxfrm() for every entry name, packed into one
+// contiguous buffer so that ordering under LC_COLLATE costs one memcmp per
+// comparison instead of a full strcoll() transformation each time.
+class CollationKeys {
+public:
+    explicit CollationKeys(const std::vector<Entry>& entries) {
+        spans_.reserve(entries.size());
+        std::size_t estimate = 0;
+        for (const auto& entry : entries) {
+            estimate += entry.info.name.size() * 2 + 1;
+        }
+        arena_.reserve(estimate);
+
+        for (const auto& entry : entries) {
+            const char* source = entry.info.name.c_str();
+            const std::size_t offset = arena_.size();
+            std::size_t capacity = entry.info.name.size() * 2 + 1;
+            arena_.resize(offset + capacity);
+            std::size_t length = TransformName(arena_.data() + offset, source, capacity);
+            if (length >= capacity) {
+                arena_.resize(offset + length + 1);
+                length = TransformName(arena_.data() + offset, source, length + 1);
+            }
+            arena_.resize(offset + length);
+            spans_.push_back({offset, length});
+        }
+    }
+
+    [[nodiscard]] bool Less(std::size_t lhs, std::size_t rhs) const noexcept {
+        const Span& a = spans_[lhs];
+        const Span& b = spans_[rhs];
+        const std::size_t common = std::min(a.length, b.length);
+        const int result = common == 0 ? 0 : std::memcmp(arena_.data() + a.offset, arena_.data() + b.offset, common);
+        if (result != 0) return result < 0;
+        return a.length < b.length;
+    }
+
+    [[nodiscard]] std::size_t bytes() const noexcept { return arena_.size(); }
+
+private:
+    struct Span {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    std::vector<char> arena_;
+    std::vector<Span> spans_;
+};
+
+// Names split once into alternating (text, digit run) segments. Digit runs
+// keep their leading zeros stripped so numbers of any length compare by
+// width first and bytes second, without re-parsing on every comparison.
+class VersionKeys {
+public:
+    explicit VersionKeys(const std::vector<Entry>& entries) {
+        ranges_.reserve(entries.size());
+        for (const auto& entry : entries) {
+            const std::size_t first = segments_.size();
+            Tokenise(entry.info.name, segments_);
+            ranges_.push_back({first, segments_.size() - first});
+        }
+    }
+
+    [[nodiscard]] bool Less(std::size_t lhs, std::size_t rhs) const noexcept {
+        const Range& a = ranges_[lhs];
+        const Range& b = ranges_[rhs];
+        return CompareSegments(segments_.data() + a.first, a.count, segments_.data() + b.first, b.count) < 0;
+    }
+
+    // Flattens the segments of name into bytes that compare, as plain
+    // strings, in the order Less() gives; the merge of a large listing
+    // derives this once per entry instead of tokenising on every comparison.
+    // Text ends with a NUL (which no file name contains), so a shorter text
+    // sorts first; numbers follow as length, digits and inverted zero count.
+    [[nodiscard]] static std::string EncodeName(std::string_view name) {
+        std::vector<Segment> segments;
+        Tokenise(name, segments);
+        std::string key;
+        key.reserve(name.size() + segments.size() * 10);
+        for (const auto& segment : segments) {
+            key.append(segment.text);
+            key.push_back('\0');
+            key.push_back(segment.has_number ? '\1' : '\0');
+            if (!segment.has_number) continue;
+            AppendBigEndian(key, static_cast<std::uint32_t>(segment.digits.size()));
+            key.append(segment.digits);
+            AppendBigEndian(key, ~segment.leading_zeros);
+        }
+        return key;
+    }
+
+    [[nodiscard]] std::size_t bytes() const noexcept { return segments_.size() * sizeof(Segment); }
+
+private:
+    struct Segment {
+        std::string_view text;
+        std::string_view digits;
+        std::uint32_t leading_zeros = 0;
+        bool has_number = false;
+    };
+
+    struct Range {
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    static constexpr bool IsDigit(char ch) noexcept { return ch >= '0' && ch <= '9'; }
+
+    static void AppendBigEndian(std::string& out, std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<char>((value >> shift) & 0xff));
+        }
+    }
+
+    static void Tokenise(std::string_view name, std::vector<Segment>& out) {
+        std::size_t pos = 0;
+        while (pos < name.size()) {
+            Segment segment;
+            const std::size_t text_begin = pos;
+            while (pos < name.size() && !IsDigit(name[pos])) ++pos;
+            segment.text = name.substr(text_begin, pos - text_begin);
+            const std::size_t digits_begin = pos;
+            while (pos < name.size() && name[pos] == '0') ++pos;
+            segment.leading_zeros = static_cast<std::uint32_t>(pos - digits_begin);
+            const std::size_t value_begin = pos;
+            while (pos < name.size() && IsDigit(name[pos])) ++pos;
+            segment.digits = name.substr(value_begin, pos - value_begin);
+            segment.has_number = pos > digits_begin;
+            out.push_back(segment);
+        }
+    }
+
+    static int CompareSegments(const Segment* a, std::size_t a_count,
+                               const Segment* b, std::size_t b_count) noexcept {
+        const std::size_t common = std::min(a_count, b_count);
+        for (std::size_t i = 0; i < common; ++i) {
+            const int result = Compare(a[i], b[i]);
+            if (result != 0) return result;
+        }
+        if (a_count == b_count) return 0;
+        return a_count < b_count ? -1 : 1;
+    }
+
+    static int Compare(const Segment& a, const Segment& b) noexcept {
+        if (const int text = a.text.compare(b.text); text != 0) return text;
+        if (a.has_number != b.has_number) return a.has_number ? 1 : -1;
+        if (a.digits.size() != b.digits.size()) return a.digits.size() < b.digits.size() ? -1 : 1;
+        if (const int digits = a.digits.compare(b.digits); digits != 0) return digits;
+        if (a.leading_zeros != b.leading_zeros) return a.leading_zeros > b.leading_zeros ? -1 : 1;
+        return 0;
+    }
+
+    std::vector<Segment> segments_;
+    std::vector<Range> ranges_;
+};
+
+// Orders entries through an index permutation so the key tables above stay
+// valid for the whole sort and each Entry is moved exactly once.
+template <typename Keys>
+void SortByKeys(std::vector<Entry>& entries, std::string_view label) {
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace(std::string("path_processor::") + std::string(label) + "_sort");
+    }
+
+    const Keys keys(entries);
+    std::vector<std::size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::ranges::stable_sort(order, [&keys](std::size_t a, std::size_t b) { return keys.Less(a, b); });
+
+    std::vector<Entry> sorted;
+    sorted.reserve(entries.size());
+    for (std::size_t index : order) {
+        sorted.push_back(std::move(entries[index]));
+    }
+    entries = std::move(sorted);
+
+    if (perf_manager.enabled()) {
+        const std::string prefix = std::string("path_processor::") + std::string(label);
+        perf_manager.IncrementCounter(prefix + "_keys", order.size());
+        perf_manager.IncrementCounter(prefix + "_key_bytes", keys.bytes());
+    }
+}
+
+}  // namespace
+
 PathProcessor::PathProcessor(const Config& config,
                              FileScanner& scanner,
                              Renderer& renderer,
                              GitStatus& git_status) noexcept
-    : config_(config), scanner_(scanner), renderer_(renderer), git_status_(git_status) {}
+    : config_(config),
+      scanner_(scanner),
+      renderer_(renderer),
+      git_status_(git_status),
+      mount_filter_(config.one_file_system(), config.skip_fs()) {}
+
+PathProcessor::~PathProcessor() = default;
 
 VisitResult PathProcessor::process(const fs::path& path) {
-    return listPath(path);
+    const std::size_t index = path_index_++;
+    if (options().checkpoint_file().empty()) {
+        return listPath(path);
+    }
+
+    if (!checkpoint_ && !openCheckpoint()) {
+        checkpoint_failed_ = true;
+    }
+    if (checkpoint_failed_) {
+        return VisitResult::Serious;
+    }
+    if (resume_) {
+        if (index < resume_->path_index) {
+            // Listed in full before the interruption.
+            return VisitResult::Ok;
+        }
+        recursive_block_printed_ = resume_->block_printed;
+        if (resume_->fresh) {
+            resume_.reset();
+        }
+    }
+
+    VisitResult status = listPath(path);
+    resume_.reset();
+    if (Cancellation::Requested()) {
+        // Output written since the last checkpoint may be lost, so that
+        // checkpoint stays the one to resume from.
+        return status;
+    }
+    if (path_index_ == options().paths().size()) {
+        checkpoint_->Remove();
+    } else {
+        saveCheckpoint(path_index_, true, {});
+    }
+    return status;
+}
+
+bool PathProcessor::openCheckpoint() {
+    checkpoint_ = std::make_unique<ScanCheckpoint>(fs::path(options().checkpoint_file()));
+    if (!options().resume()) {
+        // Saved right away so --resume after an early crash knows where the
+        // output started.
+        saveCheckpoint(0, true, {});
+        return true;
+    }
+
+    std::error_code exists_ec;
+    if (!fs::exists(checkpoint_->file(), exists_ec)) {
+        std::cerr << "nls: " << checkpoint_->file().string() << ": no checkpoint, listing from the start\n";
+        saveCheckpoint(0, true, {});
+        return true;
+    }
+    ScanCheckpoint::State state;
+    if (!checkpoint_->Load(state)) {
+        std::cerr << "nls: " << checkpoint_->file().string() << ": not a valid checkpoint\n";
+        return false;
+    }
+    if (state.output_offset) {
+        std::string message;
+        if (!ScanCheckpoint::RewindOutput(*state.output_offset, message)) {
+            std::cerr << "nls: cannot resume: " << message << "\n";
+            return false;
+        }
+        if (!message.empty()) {
+            std::cerr << "nls: warning: " << message << "\n";
+        }
+    }
+    directories_listed_ = state.directories_listed;
+    resume_ = std::move(state);
+    return true;
+}
+
+void PathProcessor::saveCheckpoint(std::size_t path_index,
+                                   bool fresh,
+                                   const std::vector<RecursiveFrame>& pending) {
+    ScanCheckpoint::State state;
+    state.path_index = path_index;
+    state.fresh = fresh;
+    state.root = fresh ? fs::path() : recursive_root_;
+    state.block_printed = recursive_block_printed_;
+    state.directories_listed = directories_listed_;
+    state.pending.reserve(pending.size());
+    for (const auto& frame : pending) {
+        state.pending.push_back({frame.dir, frame.depth, static_cast<std::uint8_t>(frame.inherited),
+                                 frame.is_top_level});
+    }
+    state.visited.reserve(visited_directories_.size());
+    for (const auto& id : visited_directories_) {
+        state.visited.push_back({id.device, id.inode});
+    }
+    checkpoint_->Save(state);
 }
 
 VisitResult PathProcessor::listPath(const fs::path& path) {
@@ -40,9 +424,10 @@ VisitResult PathProcessor::listPath(const fs::path& path) {
                 renderer().PrintPathHeader(path);
             }
             VisitResult tree_status = VisitResult::Ok;
+            mount_filter_.SetRoot(path);
             auto nodes = buildTreeItems(path, 0, flat, tree_status);
             status = VisitResultAggregator::Combine(status, tree_status);
-            if (tree_status == VisitResult::Serious) {
+            if (tree_status == VisitResult::Serious || Cancellation::Requested()) {
                 return status;
             }
             renderer().RenderTree(nodes, flat);
@@ -54,6 +439,7 @@ VisitResult PathProcessor::listPath(const fs::path& path) {
                 return status;
             }
             applyGitStatus(single, is_directory ? path : path.parent_path());
+            applyContentHashes(single);
             sortEntries(single);
             flat = single;
             renderer().RenderEntries(single);
@@ -68,6 +454,24 @@ VisitResult PathProcessor::listPath(const fs::path& path) {
         return listRecursiveFlat(path);
     }
 
+    const auto print_header = [&]() {
+        if (options().header() && options().format() == Config::Format::Long) {
+            renderer().PrintDirectoryHeader(path, is_directory);
+        } else if (options().paths().size() > 1 && is_directory) {
+            renderer().PrintPathHeader(path);
+        }
+    };
+
+    if (is_directory && useExternalSort()) {
+        VisitResult list_status = listExternallySorted(path, true, print_header);
+        status = VisitResultAggregator::Combine(status, list_status);
+        if (list_status == VisitResult::Serious) {
+            return status;
+        }
+        if (options().paths().size() > 1) renderer().TerminateLine();
+        return status;
+    }
+
     std::vector<Entry> items;
     VisitResult collect_status = scanner().collect_entries(path, items, true);
     status = VisitResultAggregator::Combine(status, collect_status);
@@ -75,13 +479,10 @@ VisitResult PathProcessor::listPath(const fs::path& path) {
         return status;
     }
     applyGitStatus(items, is_directory ? path : path.parent_path());
+    applyContentHashes(items);
     sortEntries(items);
 
-    if (options().header() && options().format() == Config::Format::Long) {
-        renderer().PrintDirectoryHeader(path, is_directory);
-    } else if (options().paths().size() > 1 && is_directory) {
-        renderer().PrintPathHeader(path);
-    }
+    print_header();
 
     renderer().RenderEntries(items);
     renderer().RenderReport(items);
@@ -105,6 +506,7 @@ VisitResult PathProcessor::listRecursiveFlat(const fs::path& path) {
             return status;
         }
         applyGitStatus(items, path.parent_path());
+        applyContentHashes(items);
         sortEntries(items);
         renderer().RenderEntries(items);
         renderer().RenderReport(items);
@@ -112,25 +514,125 @@ VisitResult PathProcessor::listRecursiveFlat(const fs::path& path) {
         return status;
     }
 
-    return listRecursiveDirectory(path, true);
+    recursive_root_ = path;
+    mount_filter_.SetRoot(path);
+    std::vector<RecursiveFrame> pending;
+    if (resume_) {
+        // Continue the interrupted walk of this path from its saved frontier.
+        if (resume_->root != path) {
+            std::cerr << "nls: cannot resume: checkpoint was taken while listing '" << resume_->root.string()
+                      << "'\n";
+            resume_.reset();
+            return VisitResult::Serious;
+        }
+        for (const auto& frame : resume_->pending) {
+            pending.push_back({frame.dir, frame.depth, static_cast<ShardOwnership>(frame.ownership),
+                               frame.is_top_level});
+        }
+        for (const auto& id : resume_->visited) {
+            visited_directories_.insert({id.device, id.inode});
+        }
+        resume_.reset();
+    } else {
+        pending.push_back({path, 0, ShardOwnership::Pending, true});
+    }
+
+    VisitResult status = VisitResult::Ok;
+    // Checked once per directory: once the output is gone the rest of the
+    // walk would only be written into a closed pipe.
+    while (!pending.empty() && Cancellation::CheckOutput()) {
+        RecursiveFrame frame = std::move(pending.back());
+        pending.pop_back();
+        status = VisitResultAggregator::Combine(status, listRecursiveDirectory(frame, pending));
+        ++directories_listed_;
+        if (checkpoint_ && checkpoint_->Due()) {
+            saveCheckpoint(path_index_ - 1, false, pending);
+        }
+    }
+    return status;
+}
+
+PathProcessor::ShardOwnership PathProcessor::shardOwnership(const fs::path& dir,
+                                                           std::size_t depth,
+                                                           ShardOwnership inherited) const {
+    const auto& shard = options().shard();
+    if (!shard) {
+        return ShardOwnership::Owned;
+    }
+    if (inherited != ShardOwnership::Pending || depth < options().shard_depth()) {
+        return inherited;
+    }
+    const std::string relative = dir.lexically_relative(recursive_root_).generic_string();
+    return ShardOf(relative, shard->count) == shard->index ? ShardOwnership::Owned : ShardOwnership::Foreign;
 }
 
-VisitResult PathProcessor::listRecursiveDirectory(const fs::path& dir, bool is_top_level) {
-    std::vector<Entry> items;
-    VisitResult status = scanner().collect_entries(dir, items, is_top_level);
-    if (status == VisitResult::Serious) {
-        return status;
+bool PathProcessor::markDirectoryVisited(const fs::path& dir) {
+#ifndef _WIN32
+    struct stat st {};
+    if (::stat(dir.c_str(), &st) != 0) {
+        return true;
     }
-    applyGitStatus(items, dir);
-    sortEntries(items);
+    const DirectoryId id{static_cast<std::uintmax_t>(st.st_dev), static_cast<std::uintmax_t>(st.st_ino)};
+    return visited_directories_.insert(id).second;
+#else
+    (void)dir;
+    return true;
+#endif
+}
 
-    if (recursive_block_printed_) {
-        renderer().TerminateLine();
+VisitResult PathProcessor::listRecursiveDirectory(const RecursiveFrame& frame,
+                                                  std::vector<RecursiveFrame>& pending) {
+    const fs::path& dir = frame.dir;
+    const bool is_top_level = frame.is_top_level;
+    const std::size_t depth = frame.depth;
+    // With --shard, directories at the shard depth are hashed to one slice
+    // and their whole subtree follows; directories above that depth are
+    // walked by every slice but listed only by the first.
+    const ShardOwnership ownership = shardOwnership(dir, depth, frame.inherited);
+    if (ownership == ShardOwnership::Foreign) {
+        return VisitResult::Ok;
+    }
+    const bool list_here = ownership == ShardOwnership::Owned || options().shard()->index == 0;
+
+    // With -L, symlinked directories are followed; remember each (device,
+    // inode) so that link cycles are reported once instead of recursing forever.
+    if (options().dereference() && !markDirectoryVisited(dir)) {
+        std::cerr << "nls: " << dir.string() << ": not listing already-listed directory\n";
+        return VisitResult::Minor;
+    }
+
+    const auto print_header = [&]() {
+        if (recursive_block_printed_) {
+            renderer().TerminateLine();
+        }
+        renderer().PrintPathHeader(dir);
+    };
+
+    VisitResult status = VisitResult::Ok;
+    if (!list_here) {
+        // Another slice prints this directory; only walk through it.
+    } else if (useExternalSort()) {
+        status = listExternallySorted(dir, is_top_level, print_header);
+        if (status == VisitResult::Serious) {
+            return status;
+        }
+    } else {
+        std::vector<Entry> items;
+        status = scanner().collect_entries(dir, items, is_top_level);
+        if (status == VisitResult::Serious || Cancellation::Requested()) {
+            return status;
+        }
+        applyGitStatus(items, dir);
+        applyContentHashes(items);
+        sortEntries(items);
+
+        print_header();
+        renderer().RenderEntries(items);
+        renderer().RenderReport(items);
+    }
+    if (list_here) {
+        recursive_block_printed_ = true;
     }
-    renderer().PrintPathHeader(dir);
-    renderer().RenderEntries(items);
-    renderer().RenderReport(items);
-    recursive_block_printed_ = true;
 
     std::vector<fs::path> subdirs;
     VisitResult subdir_status = scanner().collect_child_directories(dir, subdirs, is_top_level);
@@ -139,9 +641,13 @@ VisitResult PathProcessor::listRecursiveDirectory(const fs::path& dir, bool is_t
         return status;
     }
 
-    for (const auto& subdir : subdirs) {
-        VisitResult child_status = listRecursiveDirectory(subdir, false);
-        status = VisitResultAggregator::Combine(status, child_status);
+    for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) {
+        // Mount points excluded by --one-file-system or --skip-fs are
+        // listed as entries of their parent but never opened.
+        if (mount_filter_.active() && !mount_filter_.Allows(*it)) {
+            continue;
+        }
+        pending.push_back({std::move(*it), depth + 1, ownership, false});
     }
 
     return status;
@@ -152,6 +658,11 @@ std::vector<TreeItem> PathProcessor::buildTreeItems(const fs::path& dir,
                                                     std::vector<Entry>& flat,
                                                     VisitResult& status) {
     std::vector<TreeItem> nodes;
+    // The tree is printed only once it is complete, so a closed pipe has to
+    // be noticed while it is still being built.
+    if (!Cancellation::CheckOutput()) {
+        return nodes;
+    }
     std::vector<Entry> items;
     VisitResult local = scanner().collect_entries(dir, items, depth == 0);
     status = VisitResultAggregator::Combine(status, local);
@@ -159,6 +670,7 @@ std::vector<TreeItem> PathProcessor::buildTreeItems(const fs::path& dir,
         return nodes;
     }
     applyGitStatus(items, dir);
+    applyContentHashes(items);
     sortEntries(items);
 
     nodes.reserve(items.size());
@@ -173,6 +685,13 @@ std::vector<TreeItem> PathProcessor::buildTreeItems(const fs::path& dir,
         if (options().tree_depth().has_value()) {
             within_limit = depth + 1 < *options().tree_depth();
         }
+        if (is_dir && within_limit && !is_self && mount_filter_.active()) {
+#ifndef _WIN32
+            within_limit = mount_filter_.Allows(node.entry.info.path, node.entry.info.device);
+#else
+            within_limit = mount_filter_.Allows(node.entry.info.path);
+#endif
+        }
         if (is_dir && within_limit && !is_self) {
             node.children = buildTreeItems(node.entry.info.path, depth + 1, flat, status);
         }
@@ -183,9 +702,111 @@ std::vector<TreeItem> PathProcessor::buildTreeItems(const fs::path& dir,
     return nodes;
 }
 
-void PathProcessor::applyGitStatus(std::vector<Entry>& items, const fs::path& dir) {
-    if (!options().git_status()) return;
+VisitResult PathProcessor::listExternallySorted(const fs::path& dir,
+                                                bool is_top_level,
+                                                const std::function<void()>& print_header) {
+    // Entries are gathered as for any listing; the sorter only takes over
+    // under --memory-limit, which spills to disk, or once they outgrow the
+    // packing threshold, past which runs stay in memory in packed form.
+    const auto& memory_limit = options().memory_limit();
+    std::optional<GitStatusResult> git_result;
+    std::optional<ExternalEntrySorter> sorter;
+    Renderer::StreamLayout layout;
+    std::vector<Entry> items;
+    std::uintmax_t item_bytes = 0;
+
+    const auto start_sorter = [&]() {
+        if (options().git_status()) {
+            git_result = fetchGitStatus(dir);
+            applyGitStatus(items, dir, *git_result);
+        }
+        sorter.emplace(
+            memory_limit ? *memory_limit : PackedRunBytes(),
+            memory_limit ? ExternalEntrySorter::Storage::TemporaryFile : ExternalEntrySorter::Storage::Packed,
+            [this](std::vector<Entry>& run) { sortEntries(run); },
+            [this](const ExternalEntrySorter::MergeHead& a, const ExternalEntrySorter::MergeHead& b) {
+                return entryPrecedes(a, b);
+            },
+            options().reverse());
+        sorter->SetRunObserver([&](const std::vector<Entry>& run) { renderer().AccumulateStream(layout, run); });
+        if (options().sort() == Config::Sort::Version) {
+            sorter->SetMergeKey([](const Entry& entry) { return VersionKeys::EncodeName(entry.info.name); });
+        } else if (options().sort() == Config::Sort::Name && options().collate() == Config::Collate::Locale) {
+            sorter->SetMergeKey([](const Entry& entry) { return CollationKey(entry.info.name); });
+        }
+        for (auto& entry : items) {
+            sorter->Add(std::move(entry));
+        }
+        items = {};
+    };
+    if (memory_limit) {
+        start_sorter();
+    }
+
+    VisitResult status = scanner().stream_entries(dir, kStreamBatchSize,
+        [&](std::vector<Entry>& batch) {
+            if (!sorter) {
+                for (auto& entry : batch) {
+                    item_bytes += ExternalEntrySorter::EstimateBytes(entry);
+                    items.push_back(std::move(entry));
+                }
+                if (item_bytes > PackedRunBytes()) {
+                    start_sorter();
+                }
+                return;
+            }
+            if (git_result) {
+                applyGitStatus(batch, dir, *git_result);
+            }
+            for (auto& entry : batch) {
+                sorter->Add(std::move(entry));
+            }
+        },
+        is_top_level);
+    if (status == VisitResult::Serious || Cancellation::Requested()) {
+        return status;
+    }
+    if (sorter && sorter->failed()) {
+        std::cerr << "nls: cannot spill to a temporary file; --memory-limit not honoured\n";
+        status = VisitResultAggregator::Combine(status, VisitResult::Minor);
+    }
 
+    if (!sorter || !sorter->spilled()) {
+        if (sorter) {
+            items = sorter->TakeBuffered();
+        } else {
+            applyGitStatus(items, dir);
+        }
+        sortEntries(items);
+        print_header();
+        renderer().RenderEntries(items);
+        renderer().RenderReport(items);
+        return status;
+    }
+
+    print_header();
+    renderer().BeginStream(layout);
+    const bool merged = sorter->Merge(kStreamBatchSize, [&](std::vector<Entry>& batch) {
+        renderer().RenderStreamBatch(layout, batch);
+    });
+    if (!merged) {
+        std::cerr << "nls: " << dir.string() << ": unable to read back temporary sort file\n";
+        status = VisitResultAggregator::Combine(status, VisitResult::Minor);
+    }
+    renderer().RenderStreamReport(layout);
+    return status;
+}
+
+bool PathProcessor::useExternalSort() const {
+    // Whether a listing may hand over to the external sorter; most never
+    // grow enough to and are sorted in memory by listExternallySorted too.
+    // Content hashes are computed per listing (--dupes needs all of it to
+    // find matches), so those listings sort in memory.
+    return !options().tree() && options().hash_algorithm() == Config::HashAlgorithm::None &&
+           renderer_.SupportsStreaming();
+}
+
+GitStatusResult PathProcessor::fetchGitStatus(const fs::path& dir) {
     GitStatusResult status;
     auto& perf_manager = perf::Manager::Instance();
     {
@@ -193,7 +814,9 @@ void PathProcessor::applyGitStatus(std::vector<Entry>& items, const fs::path& di
         if (perf_manager.enabled()) {
             timer.emplace("git_status::GetStatus");
         }
-        status = gitStatus().GetStatus(dir, options().tree());
+        progress::Scope in_flight(progress::Operation::GitStatus);
+        const bool diffstat = options().git_diffstat() && options().format() == Config::Format::Long;
+        status = gitStatus().GetStatus(dir, options().tree(), diffstat);
     }
     if (perf_manager.enabled()) {
         perf_manager.IncrementCounter("git_status_requests");
@@ -201,6 +824,47 @@ void PathProcessor::applyGitStatus(std::vector<Entry>& items, const fs::path& di
             perf_manager.IncrementCounter("git_repositories_found");
         }
     }
+    return status;
+}
+
+void PathProcessor::applyContentHashes(std::vector<Entry>& items) {
+    const auto algorithm = options().hash_algorithm();
+    if (algorithm == Config::HashAlgorithm::None) return;
+    if (!options().dupes() && options().format() != Config::Format::Long) return;
+
+    if (!content_hasher_) {
+        content_hasher_ = std::make_unique<ContentHasher>(algorithm, ContentHasher::DefaultCacheFile());
+    }
+    {
+        progress::Scope in_flight(progress::Operation::Hash);
+        content_hasher_->HashEntries(items, options().dupes());
+    }
+    if (!options().dupes()) return;
+
+    // Keep only files that share their digest with another file; the tree
+    // view keeps directories so the structure stays navigable.
+    std::unordered_map<std::string, std::size_t> digest_counts;
+    for (const auto& entry : items) {
+        if (!entry.info.content_hash.empty()) {
+            ++digest_counts[entry.info.content_hash];
+        }
+    }
+    std::erase_if(items, [&](const Entry& entry) {
+        if (entry.info.is_dir && options().tree()) {
+            return false;
+        }
+        return entry.info.content_hash.empty() || digest_counts[entry.info.content_hash] < 2;
+    });
+}
+
+void PathProcessor::applyGitStatus(std::vector<Entry>& items, const fs::path& dir) {
+    if (!options().git_status()) return;
+    applyGitStatus(items, dir, fetchGitStatus(dir));
+}
+
+void PathProcessor::applyGitStatus(std::vector<Entry>& items,
+                                   const fs::path& dir,
+                                   const GitStatusResult& status) const {
     for (auto& entry : items) {
         std::error_code ec;
         const fs::path base = fs::is_directory(dir) ? dir : dir.parent_path();
@@ -216,6 +880,52 @@ void PathProcessor::applyGitStatus(std::vector<Entry>& items, const fs::path& di
 
         entry.info.git_prefix = status.FormatPrefixFor(
             rel, entry.info.is_dir, is_empty_dir, options().no_color());
+        if (!status.diffstats.empty()) {
+            entry.info.git_diffstat = status.FormatDiffStatFor(rel, options().no_color());
+        }
+    }
+}
+
+bool PathProcessor::entryPrecedes(const ExternalEntrySorter::MergeHead& a_head,
+                                  const ExternalEntrySorter::MergeHead& b_head) const {
+    const Entry& a = a_head.entry;
+    const Entry& b = b_head.entry;
+    if (options().dots_first()) {
+        const bool da = StringUtils::IsHidden(a.info.name);
+        const bool db = StringUtils::IsHidden(b.info.name);
+        if (da != db) return da;
+    }
+    if (options().sort_files_first() && a.info.is_dir != b.info.is_dir) {
+        return !a.info.is_dir;
+    }
+    if (options().group_dirs_first() && a.info.is_dir != b.info.is_dir) {
+        return a.info.is_dir;
+    }
+
+    const auto& lhs_head = options().reverse() ? b_head : a_head;
+    const auto& rhs_head = options().reverse() ? a_head : b_head;
+    const Entry& lhs = lhs_head.entry;
+    const Entry& rhs = rhs_head.entry;
+    switch (options().sort()) {
+        case Config::Sort::Time:
+            return lhs.info.mtime > rhs.info.mtime;
+        case Config::Sort::Size:
+            return lhs.info.size > rhs.info.size;
+        case Config::Sort::Extension:
+            return StringUtils::ToLower(lhs.info.path.extension().string())
+                 < StringUtils::ToLower(rhs.info.path.extension().string());
+        case Config::Sort::Version:
+            // The merge key is VersionKeys::EncodeName of the name.
+            return lhs_head.key < rhs_head.key;
+        case Config::Sort::None:
+            return false;
+        case Config::Sort::Name:
+        default:
+            if (options().collate() == Config::Collate::Locale) {
+                // The merge key is the name's CollationKey.
+                return lhs_head.key < rhs_head.key;
+            }
+            return StringUtils::LessIgnoreCase(lhs.info.name, rhs.info.name);
     }
 }
 
@@ -223,8 +933,14 @@ void PathProcessor::sortEntries(std::vector<Entry>& entries) const {
     using std::ranges::reverse;
     using std::ranges::stable_sort;
 
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace("path_processor::sort_entries");
+    }
+
     const auto cmp_name = [](const Entry& a, const Entry& b) {
-        return StringUtils::ToLower(a.info.name) < StringUtils::ToLower(b.info.name);
+        return StringUtils::LessIgnoreCase(a.info.name, b.info.name);
     };
     const auto cmp_time = [](const Entry& a, const Entry& b) {
         return a.info.mtime > b.info.mtime;
@@ -248,11 +964,18 @@ void PathProcessor::sortEntries(std::vector<Entry>& entries) const {
         case Config::Sort::Extension:
             stable_sort(entries, cmp_ext);
             break;
+        case Config::Sort::Version:
+            SortByKeys<VersionKeys>(entries, "version");
+            break;
         case Config::Sort::None:
             break;
         case Config::Sort::Name:
         default:
-            stable_sort(entries, cmp_name);
+            if (options().collate() == Config::Collate::Locale) {
+                SortByKeys<CollationKeys>(entries, "collate");
+            } else {
+                stable_sort(entries, cmp_name);
+            }
             break;
     }
 
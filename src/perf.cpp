@@ -90,6 +90,26 @@ void Manager::Report(std::ostream& os) const
         for (const auto& [name, value] : counters) {
             os << "  " << name << ": " << value << '\n';
         }
+
+        // A "<scope>::syscalls" or "<scope>::bytes" counter next to
+        // "<scope>::entries" is also reported as a per-entry cost.
+        const auto previous_flags = os.flags();
+        const auto previous_precision = os.precision();
+        for (const auto& [name, value] : counters) {
+            std::string_view suffix;
+            for (const std::string_view candidate : {"::syscalls", "::bytes"}) {
+                if (name.ends_with(candidate)) suffix = candidate;
+            }
+            if (suffix.empty()) continue;
+            const std::string scope = name.substr(0, name.size() - suffix.size());
+            const auto entries = counters_.find(scope + "::entries");
+            if (entries == counters_.end() || entries->second == 0) continue;
+            os.setf(std::ios::fixed, std::ios::floatfield);
+            os << "  " << name << "_per_entry: " << std::setprecision(3)
+               << static_cast<double>(value) / static_cast<double>(entries->second) << '\n';
+        }
+        os.flags(previous_flags);
+        os.precision(previous_precision);
     }
 }
 
@@ -9,11 +9,15 @@
 #else
 #    include <fcntl.h>
 #    include <sys/ioctl.h>
+#    include <sys/resource.h>
 #    include <sys/select.h>
 #    include <sys/stat.h>
 #    include <sys/types.h>
 #    include <termios.h>
 #    include <unistd.h>
+#    ifdef __linux__
+#        include <sys/syscall.h>
+#    endif
 #endif
 
 #include <algorithm>
@@ -380,10 +384,12 @@ bool Platform::enableVirtualTerminal()
 #endif
 }
 
-bool Platform::isOutputTerminal()
-{
+namespace {
+
 #ifdef _WIN32
-    HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+bool IsTerminalHandle(DWORD which)
+{
+    HANDLE handle = GetStdHandle(which);
     if (handle == INVALID_HANDLE_VALUE) {
         return false;
     }
@@ -399,11 +405,52 @@ bool Platform::isOutputTerminal()
     }
 
     return file_type == FILE_TYPE_CHAR;
+}
+#endif
+
+}  // namespace
+
+bool Platform::enterBackgroundMode()
+{
+#ifdef _WIN32
+    // Lowers CPU, I/O and memory priority for the whole process.
+    return SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN) != 0;
+#else
+    bool ok = true;
+#    if defined(__linux__) && defined(SYS_ioprio_set)
+    // Values from linux/ioprio.h, which not every libc ships.
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    ok = ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift) == 0;
+#    elif defined(__APPLE__)
+    ok = ::setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE) == 0;
+#    endif
+    // Linux applies both settings to the calling thread only; threads
+    // started afterwards inherit them, so this must run before any.
+    ok = ::setpriority(PRIO_PROCESS, 0, 19) == 0 && ok;
+    return ok;
+#endif
+}
+
+bool Platform::isOutputTerminal()
+{
+#ifdef _WIN32
+    return IsTerminalHandle(STD_OUTPUT_HANDLE);
 #else
     return ::isatty(STDOUT_FILENO) != 0;
 #endif
 }
 
+bool Platform::isErrorTerminal()
+{
+#ifdef _WIN32
+    return IsTerminalHandle(STD_ERROR_HANDLE);
+#else
+    return ::isatty(STDERR_FILENO) != 0;
+#endif
+}
+
 int Platform::terminalWidth()
 {
 #ifdef _WIN32
@@ -0,0 +1,129 @@
+#include "progress.h"
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+
+#include "size_formatter.h"
+
+namespace nls::progress {
+
+namespace {
+
+// Operations younger than this are normal progress, not worth naming.
+constexpr std::chrono::milliseconds kSlowOperation{100};
+
+constexpr std::array<std::string_view, 4> kOperationNames{"readdir", "stat", "git status", "hash"};
+
+std::int64_t NowTicks() noexcept
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+}  // namespace
+
+Tracker& Tracker::Instance()
+{
+    static Tracker instance;
+    return instance;
+}
+
+void Tracker::Start(std::ostream& os, bool terminal, std::chrono::milliseconds interval)
+{
+    if (reporter_.joinable()) return;
+    enabled_ = true;
+    stop_requested_ = false;
+    reporter_ = std::thread([this, &os, terminal, interval]() { ReportLoop(os, terminal, interval); });
+}
+
+void Tracker::Stop()
+{
+    if (!reporter_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop_requested_ = true;
+    }
+    stop_cv_.notify_all();
+    reporter_.join();
+    enabled_ = false;
+}
+
+void Tracker::EnterDirectory(const std::filesystem::path& dir)
+{
+    directories_.fetch_add(1, std::memory_order_relaxed);
+    std::string text = dir.string();
+    std::lock_guard<std::mutex> lock(directory_mutex_);
+    current_directory_.swap(text);
+}
+
+void Tracker::BeginOperation(Operation op) noexcept
+{
+    started_[static_cast<std::size_t>(op)].store(NowTicks(), std::memory_order_relaxed);
+}
+
+void Tracker::EndOperation(Operation op) noexcept
+{
+    started_[static_cast<std::size_t>(op)].store(0, std::memory_order_relaxed);
+}
+
+std::string Tracker::FormatLine(std::uint64_t rate) const
+{
+    std::ostringstream line;
+    line << "nls: " << directories_.load(std::memory_order_relaxed) << " dirs, "
+         << entries_.load(std::memory_order_relaxed) << " entries (" << rate << "/s), "
+         << SizeFormatter::FormatHumanReadable(bytes_.load(std::memory_order_relaxed));
+
+    const std::int64_t now = NowTicks();
+    std::int64_t oldest = 0;
+    std::size_t oldest_op = 0;
+    for (std::size_t op = 0; op < kOperationCount; ++op) {
+        const std::int64_t started = started_[op].load(std::memory_order_relaxed);
+        if (started != 0 && (oldest == 0 || started < oldest)) {
+            oldest = started;
+            oldest_op = op;
+        }
+    }
+    if (oldest != 0) {
+        const std::chrono::steady_clock::duration age{now - oldest};
+        if (age >= kSlowOperation) {
+            line << ", slowest: " << kOperationNames[oldest_op] << ' ' << std::fixed << std::setprecision(1)
+                 << std::chrono::duration<double>(age).count() << 's';
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(directory_mutex_);
+    if (!current_directory_.empty()) {
+        line << ", in " << current_directory_;
+    }
+    return line.str();
+}
+
+void Tracker::ReportLoop(std::ostream& os, bool terminal, std::chrono::milliseconds interval)
+{
+    auto last_time = std::chrono::steady_clock::now();
+    std::uint64_t last_entries = 0;
+    bool printed = false;
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_cv_.wait_for(lock, interval, [this]() { return stop_requested_; })) {
+        const auto now = std::chrono::steady_clock::now();
+        const std::uint64_t entries = entries_.load(std::memory_order_relaxed);
+        const double seconds = std::chrono::duration<double>(now - last_time).count();
+        const auto rate = seconds > 0.0 ? static_cast<std::uint64_t>((entries - last_entries) / seconds) : 0;
+        last_time = now;
+        last_entries = entries;
+
+        const std::string line = FormatLine(rate);
+        if (terminal) {
+            os << '\r' << line << "\x1b[K" << std::flush;
+        } else {
+            os << line << '\n' << std::flush;
+        }
+        printed = true;
+    }
+    if (terminal && printed) {
+        os << "\r\x1b[K" << std::flush;
+    }
+}
+
+}  // namespace nls::progress
@@ -0,0 +1,611 @@
+#include "prompt_summary.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "perf.h"
+#include "resources.h"
+
+namespace fs = std::filesystem;
+
+namespace nls {
+
+namespace {
+
+// Most recently summarised directories kept in the cache file.
+constexpr std::size_t kMaxCachedDirectories = 256;
+
+// Directories with more regular files than this are not cached; listing
+// their names would cost more than reading the directory again.
+constexpr std::size_t kMaxCachedFiles = 1024;
+
+// First line of the cache file. Files written in another format are ignored.
+constexpr std::string_view kCacheHeader = "nls-prompt-summary 2";
+
+// A directory modified this recently may change again within the same
+// timestamp tick, so its counts are not cached yet.
+constexpr std::int64_t kRacyWindowNs = 2'000'000'000;
+
+const char* GitStateName(PromptSummary::GitState state) {
+    switch (state) {
+        case PromptSummary::GitState::Clean:
+            return "clean";
+        case PromptSummary::GitState::Dirty:
+            return "dirty";
+        case PromptSummary::GitState::Unknown:
+            return "unknown";
+        case PromptSummary::GitState::None:
+            break;
+    }
+    return "none";
+}
+
+// Current time on the same clock DirectoryMtime reports.
+std::int64_t NowNs() {
+#ifndef _WIN32
+    const auto now = std::chrono::system_clock::now();
+#else
+    const auto now = fs::file_time_type::clock::now();
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+bool ReadFile(const fs::path& path, std::string& content) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+#ifndef _WIN32
+
+// Locates the work tree root and git directory that own dir, following
+// ".git" files written for worktrees and submodules.
+bool FindRepository(const fs::path& dir, fs::path& work_tree, fs::path& git_dir) {
+    std::error_code ec;
+    fs::path current = fs::absolute(dir, ec).lexically_normal();
+    if (ec) {
+        return false;
+    }
+    while (true) {
+        const fs::path dot_git = current / ".git";
+        struct stat st {};
+        if (::stat(dot_git.c_str(), &st) == 0) {
+            work_tree = current;
+            if (S_ISDIR(st.st_mode)) {
+                git_dir = dot_git;
+                return true;
+            }
+            std::string content;
+            if (!ReadFile(dot_git, content) || content.rfind("gitdir:", 0) != 0) {
+                return false;
+            }
+            std::string_view target(content);
+            target.remove_prefix(7);
+            while (!target.empty() && (target.front() == ' ' || target.front() == '\t')) target.remove_prefix(1);
+            while (!target.empty() && (target.back() == '\n' || target.back() == '\r')) target.remove_suffix(1);
+            git_dir = fs::path(target);
+            if (git_dir.is_relative()) {
+                git_dir = current / git_dir;
+            }
+            return true;
+        }
+        if (!current.has_relative_path()) {
+            return false;
+        }
+        current = current.parent_path();
+    }
+}
+
+// SHA-256 repositories declare extensions.objectFormat in their config; a
+// linked worktree keeps that config in the common directory.
+std::size_t ObjectIdSize(const fs::path& git_dir) {
+    std::string config;
+    if (!ReadFile(git_dir / "config", config)) {
+        std::string common;
+        if (ReadFile(git_dir / "commondir", common)) {
+            while (!common.empty() && (common.back() == '\n' || common.back() == '\r')) common.pop_back();
+            fs::path common_dir(common);
+            if (common_dir.is_relative()) common_dir = git_dir / common_dir;
+            ReadFile(common_dir / "config", config);
+        }
+    }
+    std::transform(config.begin(), config.end(), config.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    const auto format = config.find("objectformat");
+    if (format != std::string::npos && config.find("sha256", format) != std::string::npos) {
+        return 32;
+    }
+    return 20;
+}
+
+std::uint32_t ReadBe32(const unsigned char* data) {
+    return (static_cast<std::uint32_t>(data[0]) << 24) | (static_cast<std::uint32_t>(data[1]) << 16) |
+           (static_cast<std::uint32_t>(data[2]) << 8) | static_cast<std::uint32_t>(data[3]);
+}
+
+std::uint16_t ReadBe16(const unsigned char* data) {
+    return static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+}
+
+// Offset varint used by index v4 path compression.
+bool ReadVarint(const unsigned char*& cursor, const unsigned char* end, std::size_t& value) {
+    if (cursor >= end) return false;
+    unsigned char ch = *cursor++;
+    value = ch & 0x7f;
+    while (ch & 0x80) {
+        if (cursor >= end) return false;
+        ch = *cursor++;
+        value = ((value + 1) << 7) | (ch & 0x7f);
+    }
+    return true;
+}
+
+// Compares one index entry's cached stat data with the working tree file,
+// the way git does before deciding whether content needs rehashing.
+bool EntryChanged(int root_fd, const char* path, std::uint32_t mode, const unsigned char* stat_data) {
+    struct stat st {};
+    if (::fstatat(root_fd, path, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return true;
+    }
+    if ((st.st_mode & S_IFMT) != (mode & S_IFMT)) {
+        return true;
+    }
+    if (S_ISREG(st.st_mode) && ((st.st_mode & S_IXUSR) != 0) != ((mode & 0100) != 0)) {
+        return true;
+    }
+    const std::uint32_t mtime_sec = ReadBe32(stat_data + 8);
+    const std::uint32_t mtime_nsec = ReadBe32(stat_data + 12);
+    const std::uint32_t size = ReadBe32(stat_data + 36);
+#    ifdef __APPLE__
+    const auto& mtime = st.st_mtimespec;
+#    else
+    const auto& mtime = st.st_mtim;
+#    endif
+    if (static_cast<std::uint32_t>(mtime.tv_sec) != mtime_sec ||
+        static_cast<std::uint32_t>(st.st_size) != size) {
+        return true;
+    }
+    // Builds of git without nanosecond support record zero.
+    return mtime_nsec != 0 && static_cast<std::uint32_t>(mtime.tv_nsec) != mtime_nsec;
+}
+
+#endif
+
+}  // namespace
+
+PromptSummary::PromptSummary(fs::path cache_file) : cache_file_(std::move(cache_file)) {}
+
+fs::path PromptSummary::DefaultCacheFile() {
+    const fs::path config_dir = ResourceManager::userConfigDir();
+    if (config_dir.empty()) {
+        return {};
+    }
+    return config_dir.parent_path() / "cache" / "prompt-summary";
+}
+
+bool PromptSummary::Print(const fs::path& dir, bool with_path, std::ostream& out) {
+    auto& perf_manager = perf::Manager::Instance();
+    Counts counts;
+    bool counted = false;
+    std::optional<std::int64_t> mtime_ns;
+    std::string key;
+    std::vector<std::string> files;
+    if (!cache_file_.empty()) {
+        std::error_code ec;
+        key = fs::absolute(dir, ec).lexically_normal().string();
+        mtime_ns = DirectoryMtime(dir);
+        if (!ec && mtime_ns && key.find('\n') == std::string::npos) {
+            // The directory's mtime covers the names and kinds of its entries
+            // but not writes to a file, so sizes are always read again.
+            counted = LoadCached(key, *mtime_ns, counts, files) && SumFileSizes(dir, files, counts.size);
+        } else {
+            key.clear();
+        }
+    }
+    if (perf_manager.enabled()) {
+        perf_manager.IncrementCounter(counted ? "prompt_summary::cache_hits" : "prompt_summary::cache_misses");
+    }
+    if (!counted) {
+        std::optional<perf::Timer> timer;
+        if (perf_manager.enabled()) {
+            timer.emplace("prompt_summary::count");
+        }
+        counts = {};
+        files.clear();
+        if (!CountEntries(dir, counts, key.empty() ? nullptr : &files)) {
+            std::cerr << "nls: cannot open directory '" << dir.string() << "': "
+                      << std::error_code(errno, std::generic_category()).message() << "\n";
+            return false;
+        }
+        if (!key.empty() && files.size() <= kMaxCachedFiles && NowNs() - *mtime_ns > kRacyWindowNs) {
+            StoreCached(key, *mtime_ns, counts, files);
+        }
+    }
+
+    GitState git = GitState::None;
+    {
+        std::optional<perf::Timer> timer;
+        if (perf_manager.enabled()) {
+            timer.emplace("prompt_summary::git");
+        }
+        git = CheckGit(dir);
+    }
+
+    out << "entries=" << counts.entries << " dirs=" << counts.dirs << " files=" << counts.files
+        << " links=" << counts.links << " other=" << counts.other << " hidden=" << counts.hidden
+        << " size=" << counts.size << " git=" << GitStateName(git);
+    if (with_path) {
+        out << " path=" << dir.string();
+    }
+    out << '\n';
+    return true;
+}
+
+bool PromptSummary::CountEntries(const fs::path& dir, Counts& counts, std::vector<std::string>* files) {
+#ifndef _WIN32
+    DIR* stream = ::opendir(dir.c_str());
+    if (!stream) {
+        return false;
+    }
+    const int fd = ::dirfd(stream);
+    while (const dirent* entry = ::readdir(stream)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        ++counts.entries;
+        if (name[0] == '.') {
+            ++counts.hidden;
+        }
+
+        unsigned char type = entry->d_type;
+        struct stat st {};
+        bool have_stat = false;
+        if (type == DT_UNKNOWN || type == DT_REG) {
+            // Sizes need a stat; so do file systems that leave d_type unset.
+            have_stat = ::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+            if (type == DT_UNKNOWN && have_stat) {
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK
+                     : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+        }
+        switch (type) {
+            case DT_DIR:
+                ++counts.dirs;
+                break;
+            case DT_LNK:
+                ++counts.links;
+                break;
+            case DT_REG:
+                ++counts.files;
+                if (have_stat) counts.size += static_cast<std::uint64_t>(st.st_size);
+                if (files && files->size() <= kMaxCachedFiles) files->emplace_back(name);
+                break;
+            default:
+                ++counts.other;
+                break;
+        }
+    }
+    ::closedir(stream);
+    return true;
+#else
+    // directory_entry carries the attributes and size FindNextFileW already
+    // returned, so none of these queries touch the file system again.
+    std::error_code ec;
+    fs::directory_iterator it(dir, ec);
+    if (ec) {
+        errno = ec.value();
+        return false;
+    }
+    for (const fs::directory_iterator end; it != end; it.increment(ec)) {
+        if (ec) break;
+        const fs::directory_entry& entry = *it;
+        ++counts.entries;
+        const std::wstring name = entry.path().filename().native();
+        if (!name.empty() && name.front() == L'.') {
+            ++counts.hidden;
+        }
+        std::error_code type_ec;
+        if (entry.is_symlink(type_ec)) {
+            ++counts.links;
+        } else if (entry.is_directory(type_ec)) {
+            ++counts.dirs;
+        } else if (entry.is_regular_file(type_ec)) {
+            ++counts.files;
+            const auto size = entry.file_size(type_ec);
+            if (!type_ec) counts.size += static_cast<std::uint64_t>(size);
+            if (files && files->size() <= kMaxCachedFiles) {
+                const std::u8string utf8 = entry.path().filename().u8string();
+                files->emplace_back(reinterpret_cast<const char*>(utf8.data()), utf8.size());
+            }
+        } else {
+            ++counts.other;
+        }
+    }
+    return true;
+#endif
+}
+
+bool PromptSummary::SumFileSizes(const fs::path& dir, const std::vector<std::string>& files, std::uint64_t& size) {
+    size = 0;
+#ifndef _WIN32
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (const auto& name : files) {
+        struct stat st {};
+        // Anything but a regular file means the directory changed within
+        // one tick of its mtime; count it again.
+        if (::fstatat(dir_fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) {
+            ok = false;
+            break;
+        }
+        size += static_cast<std::uint64_t>(st.st_size);
+    }
+    ::close(dir_fd);
+    return ok;
+#else
+    for (const auto& name : files) {
+        std::error_code ec;
+        const std::u8string utf8(reinterpret_cast<const char8_t*>(name.data()), name.size());
+        const auto file_size = fs::file_size(dir / fs::path(utf8), ec);
+        if (ec) {
+            return false;
+        }
+        size += static_cast<std::uint64_t>(file_size);
+    }
+    return true;
+#endif
+}
+
+std::optional<std::int64_t> PromptSummary::DirectoryMtime(const fs::path& dir) {
+#ifndef _WIN32
+    struct stat st {};
+    if (::stat(dir.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+#    ifdef __APPLE__
+    return static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#    else
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#    endif
+#else
+    std::error_code ec;
+    const auto written = fs::last_write_time(dir, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(written.time_since_epoch()).count();
+#endif
+}
+
+bool PromptSummary::LoadCached(const std::string& key, std::int64_t mtime_ns, Counts& counts,
+                               std::vector<std::string>& files) {
+    if (!cache_loaded_) {
+        cache_loaded_ = true;
+        std::ifstream in(cache_file_);
+        std::string line;
+        if (in && std::getline(in, line) && line == kCacheHeader) {
+            while (std::getline(in, line)) {
+                cache_lines_.push_back(std::move(line));
+            }
+        }
+    }
+
+    // Each record is a line "mtime_ns entries dirs files links other hidden
+    // path" (the path runs to the end of the line) followed by the names of
+    // its regular files, one per line.
+    for (std::size_t index = 0; index < cache_lines_.size();) {
+        CacheRecord record;
+        if (!ParseRecord(cache_lines_, index, record)) {
+            break;
+        }
+        if (record.mtime_ns == mtime_ns && record.key == key) {
+            counts = record.counts;
+            files.assign(cache_lines_.begin() + static_cast<std::ptrdiff_t>(record.first_file),
+                         cache_lines_.begin() + static_cast<std::ptrdiff_t>(record.end));
+            return true;
+        }
+        index = record.end;
+    }
+    counts = {};
+    return false;
+}
+
+bool PromptSummary::ParseRecord(const std::vector<std::string>& lines, std::size_t index, CacheRecord& record) {
+    if (index >= lines.size()) {
+        return false;
+    }
+    std::string_view rest(lines[index]);
+    auto next_field = [&rest]() {
+        const auto space = rest.find(' ');
+        std::string_view field = rest.substr(0, space);
+        rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+        return field;
+    };
+    const auto parse = [](std::string_view text, auto& value) {
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    };
+    std::uint64_t* const fields[] = {&record.counts.entries, &record.counts.dirs, &record.counts.files,
+                                     &record.counts.links, &record.counts.other, &record.counts.hidden};
+    bool valid = parse(next_field(), record.mtime_ns);
+    for (std::uint64_t* field : fields) {
+        valid = valid && parse(next_field(), *field);
+    }
+    if (!valid || record.counts.files > lines.size() - index - 1) {
+        return false;
+    }
+    record.key = rest;
+    record.first_file = index + 1;
+    record.end = record.first_file + static_cast<std::size_t>(record.counts.files);
+    return true;
+}
+
+void PromptSummary::StoreCached(const std::string& key, std::int64_t mtime_ns, const Counts& counts,
+                                const std::vector<std::string>& files) {
+    for (const auto& name : files) {
+        if (name.find('\n') != std::string::npos) {
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::create_directories(cache_file_.parent_path(), ec);
+    fs::path temp = cache_file_;
+    temp += "." + std::to_string(NowNs());
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out << kCacheHeader << '\n';
+        out << mtime_ns << ' ' << counts.entries << ' ' << counts.dirs << ' ' << counts.files << ' '
+            << counts.links << ' ' << counts.other << ' ' << counts.hidden << ' ' << key << '\n';
+        for (const auto& name : files) {
+            out << name << '\n';
+        }
+        std::size_t kept = 1;
+        CacheRecord record;
+        for (std::size_t index = 0; kept < kMaxCachedDirectories && ParseRecord(cache_lines_, index, record);
+             index = record.end) {
+            if (record.key == key) continue;
+            for (std::size_t line = index; line < record.end; ++line) {
+                out << cache_lines_[line] << '\n';
+            }
+            ++kept;
+        }
+        if (!out) {
+            out.close();
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+    // Prompts in several shells may race; the rename keeps the file whole.
+    fs::rename(temp, cache_file_, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+    }
+}
+
+PromptSummary::GitState PromptSummary::CheckGit(const fs::path& dir) {
+#ifndef _WIN32
+    fs::path work_tree;
+    fs::path git_dir;
+    if (!FindRepository(dir, work_tree, git_dir)) {
+        return GitState::None;
+    }
+
+    std::string index;
+    if (!ReadFile(git_dir / "index", index)) {
+        // A fresh repository has no index until something is staged.
+        return GitState::Clean;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(index.data());
+    const unsigned char* const end = data + index.size();
+    if (index.size() < 12 || std::memcmp(data, "DIRC", 4) != 0) {
+        return GitState::Unknown;
+    }
+    const std::uint32_t version = ReadBe32(data + 4);
+    const std::uint32_t count = ReadBe32(data + 8);
+    if (version < 2 || version > 4) {
+        return GitState::Unknown;
+    }
+
+    const int root_fd = ::open(work_tree.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        return GitState::Unknown;
+    }
+    const std::size_t id_size = ObjectIdSize(git_dir);
+    const std::size_t fixed = 40 + id_size + 2;  // stat data, object id, flags
+    GitState state = GitState::Clean;
+    std::string path;
+    const unsigned char* cursor = data + 12;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const unsigned char* const entry = cursor;
+        if (static_cast<std::size_t>(end - cursor) < fixed) {
+            state = GitState::Unknown;
+            break;
+        }
+        const std::uint32_t mode = ReadBe32(entry + 24);
+        const std::uint16_t flags = ReadBe16(entry + 40 + id_size);
+        cursor += fixed;
+        std::uint16_t extended = 0;
+        if (version >= 3 && (flags & 0x4000) != 0) {
+            if (end - cursor < 2) {
+                state = GitState::Unknown;
+                break;
+            }
+            extended = ReadBe16(cursor);
+            cursor += 2;
+        }
+
+        if (version == 4) {
+            std::size_t strip = 0;
+            if (!ReadVarint(cursor, end, strip) || strip > path.size()) {
+                state = GitState::Unknown;
+                break;
+            }
+            path.resize(path.size() - strip);
+        } else {
+            path.clear();
+        }
+        const auto* nul = static_cast<const unsigned char*>(std::memchr(cursor, '\0', end - cursor));
+        if (!nul) {
+            state = GitState::Unknown;
+            break;
+        }
+        path.append(reinterpret_cast<const char*>(cursor), nul - cursor);
+        cursor = nul + 1;
+        if (version < 4) {
+            // Entries are NUL-padded to a multiple of eight bytes.
+            const std::size_t length = static_cast<std::size_t>(nul - entry);
+            cursor = entry + ((length + 8) & ~static_cast<std::size_t>(7));
+        }
+
+        // Unmerged stages and intent-to-add entries always differ.
+        if ((flags & 0x3000) != 0 || (extended & 0x2000) != 0) {
+            state = GitState::Dirty;
+            break;
+        }
+        // Gitlinks, sparse directory entries, assume-unchanged and
+        // skip-worktree entries are not compared by stat.
+        const std::uint32_t type = mode & S_IFMT;
+        if (type == 0160000 || type == S_IFDIR || (flags & 0x8000) != 0 || (extended & 0x4000) != 0) {
+            continue;
+        }
+        if (EntryChanged(root_fd, path.c_str(), mode, entry)) {
+            state = GitState::Dirty;
+            break;
+        }
+    }
+    ::close(root_fd);
+    return state;
+#else
+    (void)dir;
+    return GitState::Unknown;
+#endif
+}
+
+}  // namespace nls
@@ -0,0 +1,37 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+#include "perf.h"
+
+namespace nls {
+
+RateLimiter::RateLimiter(std::uint64_t ops_per_second)
+    : rate_(static_cast<double>(std::max<std::uint64_t>(ops_per_second, 1))),
+      capacity_(std::max(1.0, rate_ / 10.0)),
+      tokens_(capacity_),
+      last_refill_(Clock::now()) {}
+
+void RateLimiter::Acquire(std::uint64_t count) {
+    const auto now = Clock::now();
+    tokens_ = std::min(capacity_, tokens_ + std::chrono::duration<double>(now - last_refill_).count() * rate_);
+    last_refill_ = now;
+    tokens_ -= static_cast<double>(count);
+    if (tokens_ >= 0.0) {
+        return;
+    }
+
+    // Sleep off the debt; the next refill measures the time actually slept,
+    // so oversleeping is credited back rather than compounding.
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace("rate_limiter::wait");
+        perf_manager.IncrementCounter("rate_limiter::waits");
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+}  // namespace nls
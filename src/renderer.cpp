@@ -1,6 +1,7 @@
 #include "renderer.h"
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cctype>
 #include <cstdint>
@@ -130,22 +131,54 @@ std::string ShellEscape(std::string_view text, bool always) {
     return out;
 }
 
-std::string PercentEncode(std::string_view input) {
+// RFC 3986 unreserved characters plus '/', which never need escaping in a
+// file:// URI path.
+constexpr std::array<bool, 256> kUriSafe = [] {
+    std::array<bool, 256> table{};
+    for (int ch = '0'; ch <= '9'; ++ch) table[ch] = true;
+    for (int ch = 'A'; ch <= 'Z'; ++ch) table[ch] = true;
+    for (int ch = 'a'; ch <= 'z'; ++ch) table[ch] = true;
+    for (unsigned char ch : std::string_view{"-_.~/"}) table[ch] = true;
+    return table;
+}();
+
+void AppendPercentEncoded(std::string& out, std::string_view input) {
     constexpr char kHex[] = "0123456789ABCDEF";
-    std::string out;
-    out.reserve(input.size());
     for (unsigned char ch : input) {
-        if (std::isalnum(ch) || ch == '-' || ch == '_' || ch == '.' || ch == '~' || ch == '/') {
+        if (kUriSafe[ch]) {
             out.push_back(static_cast<char>(ch));
         } else {
-            out.push_back('%');
-            out.push_back(kHex[(ch >> 4) & 0x0F]);
-            out.push_back(kHex[ch & 0x0F]);
+            const char escaped[3] = {'%', kHex[ch >> 4], kHex[ch & 0x0F]};
+            out.append(escaped, 3);
         }
     }
+}
+
+std::string PercentEncode(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() + input.size() / 4);
+    AppendPercentEncoded(out, input);
     return out;
 }
 
+std::string UriPath(const fs::path& path) {
+    std::error_code ec;
+    fs::path abs = fs::absolute(path, ec);
+    if (ec) abs = path;
+    std::string generic = abs.lexically_normal().generic_string();
+#ifdef _WIN32
+    if (generic.size() >= 2 && generic[1] == ':') {
+        generic.insert(generic.begin(), '/');
+    }
+#endif
+    return generic;
+}
+
+bool IsDotComponent(std::basic_string_view<fs::path::value_type> name) {
+    return (name.size() == 1 && name[0] == '.') ||
+           (name.size() == 2 && name[0] == '.' && name[1] == '.');
+}
+
 std::chrono::system_clock::time_point ToSystemClock(const fs::file_time_type& tp) {
     using namespace std::chrono;
     return time_point_cast<system_clock::duration>(tp - fs::file_time_type::clock::now() + system_clock::now());
@@ -176,6 +209,87 @@ std::string SizeColor(uintmax_t size, const ThemeColors& theme) {
     return theme.get("file_small");
 }
 
+// Both fitters below pick the widest grid whose variable-width columns stay
+// strictly narrower than line_width, the way GNU ls does (a line that fills
+// the last column wraps twice on some consoles), and return the width of
+// each column.
+// Candidate column counts start at line_width / (narrowest cell + gutter),
+// and a single column always fits even when a name is wider than the line.
+size_t MaxCandidateColumns(const std::vector<size_t>& widths, size_t line_width, size_t gutter) {
+    size_t narrowest = std::max<size_t>(1, *std::min_element(widths.begin(), widths.end()));
+    return std::min(widths.size(), std::max<size_t>(1, (line_width + gutter) / (narrowest + gutter)));
+}
+
+// -C: every column is a contiguous run of cells, so its width is a range
+// maximum. Maxima of fixed blocks are computed once; each candidate then
+// costs about cells / kBlock and stops at the first column that overflows.
+std::vector<size_t> FitColumnMajor(const std::vector<size_t>& widths, size_t line_width, size_t gutter) {
+    constexpr size_t kBlock = 64;
+    const size_t count = widths.size();
+    std::vector<size_t> block_max((count + kBlock - 1) / kBlock, 0);
+    for (size_t i = 0; i < count; ++i) {
+        block_max[i / kBlock] = std::max(block_max[i / kBlock], widths[i]);
+    }
+    auto range_max = [&](size_t first, size_t last) {
+        size_t result = 0;
+        while (first < last && first % kBlock != 0) result = std::max(result, widths[first++]);
+        while (last - first >= kBlock) {
+            result = std::max(result, block_max[first / kBlock]);
+            first += kBlock;
+        }
+        while (first < last) result = std::max(result, widths[first++]);
+        return result;
+    };
+
+    std::vector<size_t> column_widths;
+    for (size_t cols = MaxCandidateColumns(widths, line_width, gutter); cols > 1; --cols) {
+        const size_t rows = (count + cols - 1) / cols;
+        const size_t used = (count + rows - 1) / rows;
+        if (used < cols) continue;  // same grid as the smaller count that fills it
+        column_widths.clear();
+        size_t line = gutter * (used - 1);
+        for (size_t first = 0; first < count && line < line_width; first += rows) {
+            column_widths.push_back(range_max(first, std::min(count, first + rows)));
+            line += column_widths.back();
+        }
+        if (line < line_width) return column_widths;
+    }
+    return {range_max(0, count)};
+}
+
+// -x: column c holds every cell i with i % cols == c, which no range query
+// covers, so each candidate keeps running per-column maxima instead. Too
+// wide candidates overflow within the first few rows, leaving roughly one
+// full pass for the count that fits.
+std::vector<size_t> FitRowMajor(const std::vector<size_t>& widths, size_t line_width, size_t gutter) {
+    const size_t count = widths.size();
+    std::vector<size_t> column_widths;
+    for (size_t cols = MaxCandidateColumns(widths, line_width, gutter); cols > 1; --cols) {
+        column_widths.assign(cols, 0);
+        size_t line = gutter * (cols - 1);
+        for (size_t i = 0, column = 0; i < count && line < line_width; ++i) {
+            size_t& column_width = column_widths[column];
+            if (widths[i] > column_width) {
+                line += widths[i] - column_width;
+                column_width = widths[i];
+            }
+            if (++column == cols) column = 0;
+        }
+        if (line < line_width) return column_widths;
+    }
+    return {*std::max_element(widths.begin(), widths.end())};
+}
+
+std::vector<size_t> FitColumnWidths(const std::vector<size_t>& widths,
+                                    size_t line_width,
+                                    size_t gutter,
+                                    bool horizontal) {
+    if (widths.empty()) return {};
+    if (line_width == std::numeric_limits<size_t>::max()) return widths;
+    return horizontal ? FitRowMajor(widths, line_width, gutter)
+                      : FitColumnMajor(widths, line_width, gutter);
+}
+
 }  // namespace
 
 Renderer::Renderer(const Config& config)
@@ -294,6 +408,84 @@ void Renderer::RenderReport(const std::vector<Entry>& entries) const {
     }
 }
 
+bool Renderer::SupportsStreaming() const noexcept {
+    return opt_.format() == Config::Format::SingleColumn || opt_.format() == Config::Format::Long;
+}
+
+void Renderer::AccumulateStream(StreamLayout& layout, const std::vector<Entry>& batch) const {
+    const size_t inode_width = ComputeInodeWidth(batch);
+    const size_t block_width = ComputeBlockWidth(batch);
+    layout.inode_width = std::max(layout.inode_width, inode_width);
+    layout.block_width = std::max(layout.block_width, block_width);
+
+    if (opt_.format() == Config::Format::Long) {
+        const LongFormatColumns columns = ComputeLongColumns(batch, inode_width, block_width);
+        LongFormatColumns& merged = layout.long_columns;
+        merged.inode_width = std::max(merged.inode_width, columns.inode_width);
+        merged.block_width = std::max(merged.block_width, columns.block_width);
+        merged.perm_width = std::max(merged.perm_width, columns.perm_width);
+        merged.nlink_width = std::max(merged.nlink_width, columns.nlink_width);
+        merged.owner_width = std::max(merged.owner_width, columns.owner_width);
+        merged.group_width = std::max(merged.group_width, columns.group_width);
+        merged.size_width = std::max(merged.size_width, columns.size_width);
+        merged.time_width = std::max(merged.time_width, columns.time_width);
+        merged.git_width = std::max(merged.git_width, columns.git_width);
+        merged.diffstat_width = std::max(merged.diffstat_width, columns.diffstat_width);
+        merged.hash_width = std::max(merged.hash_width, columns.hash_width);
+    }
+
+    const ReportStats stats = ComputeReportStats(batch);
+    layout.stats.total += stats.total;
+    layout.stats.folders += stats.folders;
+    layout.stats.recognized_files += stats.recognized_files;
+    layout.stats.unrecognized_files += stats.unrecognized_files;
+    layout.stats.links += stats.links;
+    layout.stats.dead_links += stats.dead_links;
+    layout.stats.timed_out += stats.timed_out;
+    layout.stats.total_size += stats.total_size;
+}
+
+void Renderer::BeginStream(StreamLayout& layout) const {
+    if (opt_.format() != Config::Format::Long) {
+        return;
+    }
+    if (layout.stats.total == 0) {
+        AccumulateStream(layout, {});
+    }
+    PrintLongHeader(layout.long_columns);
+}
+
+void Renderer::RenderStreamBatch(const StreamLayout& layout, const std::vector<Entry>& batch) const {
+    auto& perf_manager = perf::Manager::Instance();
+    const bool perf_enabled = perf_manager.enabled();
+    std::optional<perf::Timer> timer;
+    if (perf_enabled) {
+        timer.emplace("renderer::RenderStreamBatch");
+        perf_manager.IncrementCounter("entries_rendered", static_cast<std::uint64_t>(batch.size()));
+    }
+
+    for (const auto& entry : batch) {
+        if (opt_.format() == Config::Format::Long) {
+            PrintLongEntry(entry, layout.long_columns);
+        } else {
+            std::cout << FormatEntryCell(entry, layout.inode_width, layout.block_width, true);
+        }
+        TerminateLine();
+    }
+}
+
+void Renderer::RenderStreamReport(const StreamLayout& layout) const {
+    if (opt_.report() == Config::Report::None) {
+        return;
+    }
+    std::cout << "\n";
+    if (opt_.report() == Config::Report::Long) {
+        PrintReportLong(layout.stats);
+    } else {
+        PrintReportShort(layout.stats);
+    }
+}
+
 void Renderer::TerminateLine() const {
     std::cout.put(opt_.zero_terminate() ? '\0' : '\n');
 }
@@ -341,17 +533,40 @@ std::string Renderer::BaseDisplayName(const Entry& entry) const {
 }
 
 std::string Renderer::FileUri(const fs::path& path) const {
-    std::error_code ec;
-    fs::path abs = fs::absolute(path, ec);
-    if (ec) abs = path;
-    abs = abs.lexically_normal();
-    std::string generic = abs.generic_string();
+    using NativeView = std::basic_string_view<fs::path::value_type>;
 #ifdef _WIN32
-    if (generic.size() >= 2 && generic[1] == ':') {
-        generic.insert(generic.begin(), '/');
-    }
+    constexpr fs::path::value_type kSeparators[] = {L'/', L'\\', L':', 0};
+#else
+    constexpr fs::path::value_type kSeparators[] = {'/', 0};
+#endif
+    NativeView native = path.native();
+    size_t split = native.find_last_of(kSeparators);
+    NativeView name = split == NativeView::npos ? native : native.substr(split + 1);
+    if (name.empty() || IsDotComponent(name)) {
+        return "file://" + PercentEncode(UriPath(path));
+    }
+
+    // Entries of one listing share their parent, so the absolute, normalised
+    // and encoded directory is computed once and only the name is encoded
+    // per entry.
+    NativeView directory = split == NativeView::npos ? NativeView{} : native.substr(0, split + 1);
+    if (!hyperlink_prefix_.valid || directory != hyperlink_prefix_.directory) {
+        std::string dir_path = UriPath(directory.empty() ? fs::path(".") : fs::path(directory));
+        if (dir_path.empty() || dir_path.back() != '/') dir_path.push_back('/');
+        hyperlink_prefix_.directory.assign(directory);
+        hyperlink_prefix_.encoded = "file://" + PercentEncode(dir_path);
+        hyperlink_prefix_.valid = true;
+    }
+
+    std::string uri;
+    uri.reserve(hyperlink_prefix_.encoded.size() + name.size() + name.size() / 4);
+    uri += hyperlink_prefix_.encoded;
+#ifdef _WIN32
+    AppendPercentEncoded(uri, fs::path(name).generic_string());
+#else
+    AppendPercentEncoded(uri, name);
 #endif
-    return "file://" + PercentEncode(generic);
+    return uri;
 }
 
 std::string Renderer::StyledName(const Entry& entry) const {
@@ -605,14 +820,29 @@ Renderer::LongFormatColumns Renderer::ComputeLongColumns(const std::vector<Entry
         if (opt_.show_group()) {
             columns.group_width = std::max(columns.group_width, GroupDisplay(entry).size());
         }
-        columns.nlink_width = std::max(columns.nlink_width, std::to_string(entry.info.nlink).size());
-        std::string size_str = FormatSizeValue(entry.info.size);
-        columns.size_width = std::max(columns.size_width, size_str.size());
-        std::string time_str = time_formatter_.Format(entry.info.mtime);
-        columns.time_width = std::max(columns.time_width, time_str.size());
+        if (entry.info.xattr_indicator != 0) {
+            columns.perm_width = 11;
+        }
+        if (entry.info.stat_timed_out) {
+            columns.nlink_width = std::max<size_t>(columns.nlink_width, 1);
+            columns.size_width = std::max<size_t>(columns.size_width, 1);
+            columns.time_width = std::max<size_t>(columns.time_width, 1);
+        } else {
+            columns.nlink_width = std::max(columns.nlink_width, std::to_string(entry.info.nlink).size());
+            std::string size_str = FormatSizeValue(entry.info.size);
+            columns.size_width = std::max(columns.size_width, size_str.size());
+            std::string time_str = time_formatter_.Format(entry.info.mtime);
+            columns.time_width = std::max(columns.time_width, time_str.size());
+        }
         if (opt_.git_status()) {
             columns.git_width = std::max(columns.git_width, PrintableWidth(entry.info.git_prefix));
         }
+        if (opt_.git_diffstat()) {
+            columns.diffstat_width = std::max(columns.diffstat_width, PrintableWidth(entry.info.git_diffstat));
+        }
+        if (opt_.hash_algorithm() != Config::HashAlgorithm::None) {
+            columns.hash_width = std::max<size_t>(columns.hash_width, std::max<size_t>(entry.info.content_hash.size(), 1));
+        }
         if (opt_.show_block_size()) {
             std::string block = BlockDisplay(entry);
             columns.block_width = std::max(columns.block_width, block.size());
@@ -628,6 +858,8 @@ Renderer::LongFormatColumns Renderer::ComputeLongColumns(const std::vector<Entry
         const std::string inode_header = "Inode";
         const std::string blocks_header = "Blocks";
         const std::string git_header = "Git";
+        const std::string diffstat_header = "Diff";
+        const std::string hash_header = "Hash";
 
         if (opt_.show_inode()) columns.inode_width = std::max(columns.inode_width, inode_header.size());
         columns.nlink_width = std::max(columns.nlink_width, links_header.size());
@@ -637,6 +869,12 @@ Renderer::LongFormatColumns Renderer::ComputeLongColumns(const std::vector<Entry
         columns.time_width = std::max(columns.time_width, time_header.size());
         if (opt_.show_block_size()) columns.block_width = std::max(columns.block_width, blocks_header.size());
         if (opt_.git_status()) columns.git_width = std::max(columns.git_width, git_header.size());
+        if (opt_.git_diffstat()) {
+            columns.diffstat_width = std::max(columns.diffstat_width, diffstat_header.size());
+        }
+        if (opt_.hash_algorithm() != Config::HashAlgorithm::None) {
+            columns.hash_width = std::max(columns.hash_width, hash_header.size());
+        }
     }
 
     return columns;
@@ -656,7 +894,10 @@ void Renderer::PrintLongHeader(const LongFormatColumns& columns) const {
     const std::string inode_header = "Inode";
     const std::string blocks_header = "Blocks";
     const std::string git_header = "Git";
+    const std::string diffstat_header = "Diff";
+    const std::string hash_header = "Hash";
     const std::string name_header = "Name";
+    const bool show_hash = opt_.hash_algorithm() != Config::HashAlgorithm::None;
 
     enum class HeaderAlign { Left, Right };
     const std::string& header_color = theme.get("header_names");
@@ -696,6 +937,12 @@ void Renderer::PrintLongHeader(const LongFormatColumns& columns) const {
     if (opt_.git_status()) {
         std::cout << format_header_cell(git_header, columns.git_width, HeaderAlign::Left) << ' ';
     }
+    if (opt_.git_diffstat()) {
+        std::cout << format_header_cell(diffstat_header, columns.diffstat_width, HeaderAlign::Left) << ' ';
+    }
+    if (show_hash) {
+        std::cout << format_header_cell(hash_header, columns.hash_width, HeaderAlign::Left) << ' ';
+    }
     std::cout << format_simple_header(name_header) << "\n";
 
     if (opt_.show_inode()) {
@@ -711,6 +958,8 @@ void Renderer::PrintLongHeader(const LongFormatColumns& columns) const {
     std::cout << std::string(columns.size_width, '-') << ' ';
     std::cout << std::string(columns.time_width, '-') << ' ';
     if (opt_.git_status()) std::cout << std::string(columns.git_width, '-') << ' ';
+    if (opt_.git_diffstat()) std::cout << std::string(columns.diffstat_width, '-') << ' ';
+    if (show_hash) std::cout << std::string(columns.hash_width, '-') << ' ';
     std::cout << std::string(name_header.size(), '-') << "\n";
 }
 
@@ -734,11 +983,22 @@ void Renderer::PrintLongEntry(const Entry& entry, const LongFormatColumns& colum
     }
 
     std::string perm = permission_formatter_.Format(entry.info);
-    std::cout << permission_formatter_.Colorize(perm, opt_.no_color()) << ' ';
+    if (entry.info.xattr_indicator != 0) {
+        perm.push_back(entry.info.xattr_indicator);
+    }
+    std::cout << permission_formatter_.Colorize(perm, opt_.no_color());
+    if (perm.size() < columns.perm_width) {
+        std::cout << std::string(columns.perm_width - perm.size(), ' ');
+    }
+    std::cout << ' ';
 
     std::cout << std::right;
     if (!links_color.empty()) std::cout << links_color;
-    std::cout << std::setw(static_cast<int>(columns.nlink_width)) << entry.info.nlink;
+    if (entry.info.stat_timed_out) {
+        std::cout << std::setw(static_cast<int>(columns.nlink_width)) << '?';
+    } else {
+        std::cout << std::setw(static_cast<int>(columns.nlink_width)) << entry.info.nlink;
+    }
     if (!links_color.empty()) std::cout << theme.reset;
     std::cout << ' ';
 
@@ -757,15 +1017,16 @@ void Renderer::PrintLongEntry(const Entry& entry, const LongFormatColumns& colum
         std::cout << ' ';
     }
 
-    std::string size_str = FormatSizeValue(entry.info.size);
-    std::string size_col = opt_.no_color() ? std::string() : SizeColor(entry.info.size, theme);
+    const bool timed_out = entry.info.stat_timed_out;
+    std::string size_str = timed_out ? std::string("?") : FormatSizeValue(entry.info.size);
+    std::string size_col = (opt_.no_color() || timed_out) ? std::string() : SizeColor(entry.info.size, theme);
     if (!size_col.empty()) std::cout << size_col;
     std::cout << std::right << std::setw(static_cast<int>(columns.size_width)) << size_str;
     if (!size_col.empty()) std::cout << theme.reset;
     std::cout << ' ';
 
-    std::string time_str = time_formatter_.Format(entry.info.mtime);
-    std::string time_col = opt_.no_color() ? std::string() : AgeColor(entry.info.mtime, theme);
+    std::string time_str = timed_out ? std::string("?") : time_formatter_.Format(entry.info.mtime);
+    std::string time_col = (opt_.no_color() || timed_out) ? std::string() : AgeColor(entry.info.mtime, theme);
     if (!time_col.empty()) std::cout << time_col;
     if (opt_.header()) {
         std::cout << std::left << std::setw(static_cast<int>(columns.time_width)) << time_str;
@@ -788,6 +1049,18 @@ void Renderer::PrintLongEntry(const Entry& entry, const LongFormatColumns& colum
         }
     }
 
+    if (opt_.git_diffstat() && columns.diffstat_width > 0) {
+        const size_t diffstat_width = PrintableWidth(entry.info.git_diffstat);
+        std::cout << entry.info.git_diffstat
+                  << std::string(columns.diffstat_width - diffstat_width, ' ') << ' ';
+    }
+
+    if (opt_.hash_algorithm() != Config::HashAlgorithm::None) {
+        const std::string& digest = entry.info.content_hash;
+        std::cout << std::left << std::setw(static_cast<int>(columns.hash_width))
+                  << (digest.empty() ? std::string("-") : digest) << ' ';
+    }
+
     std::cout << StyledName(entry);
 
     if (entry.info.is_symlink) {
@@ -837,52 +1110,44 @@ void Renderer::PrintLong(const std::vector<Entry>& entries,
 void Renderer::PrintColumns(const std::vector<Entry>& entries,
                             size_t inode_width,
                             size_t block_width) const {
-    struct Cell { std::string text; size_t width; };
-    std::vector<Cell> cells;
+    std::vector<std::string> cells;
+    std::vector<size_t> widths;
     cells.reserve(entries.size());
-
-    size_t maxw = 0;
+    widths.reserve(entries.size());
     for (const auto& entry : entries) {
-        std::string cell = FormatEntryCell(entry, inode_width, block_width, true);
-        size_t w = PrintableWidth(cell);
-        maxw = std::max(maxw, w);
-        cells.push_back({std::move(cell), w});
+        cells.push_back(FormatEntryCell(entry, inode_width, block_width, true));
+        widths.push_back(PrintableWidth(cells.back()));
     }
 
     if (cells.empty()) return;
 
     const size_t gutter = 2;
-    size_t per_row = 1;
-    if (maxw > 0) {
-        int cols = EffectiveTerminalWidth();
-        if (cols <= 0) cols = 1;
-        size_t denom = maxw + gutter;
-        if (denom == 0) denom = 1;
-        per_row = std::max<size_t>(1, static_cast<size_t>(cols) / denom);
+    const bool horizontal = opt_.format() == Config::Format::ColumnsHorizontal;
+    int cols = EffectiveTerminalWidth();
+    if (cols <= 0) cols = 1;
+    size_t line_width = cols == std::numeric_limits<int>::max()
+        ? std::numeric_limits<size_t>::max()
+        : static_cast<size_t>(cols);
+
+    std::vector<size_t> column_widths;
+    {
+        std::optional<perf::Timer> timer;
+        if (perf::Manager::Instance().enabled()) timer.emplace("renderer::column_layout");
+        column_widths = FitColumnWidths(widths, line_width, gutter, horizontal);
     }
-    size_t rows = (cells.size() + per_row - 1) / per_row;
 
+    const size_t per_row = column_widths.size();
+    const size_t rows = (cells.size() + per_row - 1) / per_row;
     for (size_t r = 0; r < rows; ++r) {
         for (size_t c = 0; c < per_row; ++c) {
-            size_t idx;
-            if (opt_.format() == Config::Format::ColumnsHorizontal) {
-                idx = r * per_row + c;
-            } else {
-                idx = c * rows + r;
-            }
+            size_t idx = horizontal ? r * per_row + c : c * rows + r;
             if (idx >= cells.size()) break;
-            const auto& cell = cells[idx];
-            std::cout << cell.text;
+            std::cout << cells[idx];
 
-            size_t next;
-            if (opt_.format() == Config::Format::ColumnsHorizontal) {
-                next = r * per_row + (c + 1);
-            } else {
-                next = (c + 1) * rows + r;
-            }
-            if (next < cells.size()) {
+            size_t next = horizontal ? idx + 1 : idx + rows;
+            if (c + 1 < per_row && next < cells.size()) {
                 size_t pad = gutter;
-                if (cell.width < maxw) pad += (maxw - cell.width);
+                if (widths[idx] < column_widths[c]) pad += column_widths[c] - widths[idx];
                 std::cout << std::string(pad, ' ');
             }
         }
@@ -953,6 +1218,9 @@ Renderer::ReportStats Renderer::ComputeReportStats(const std::vector<Entry>& ent
                 ++stats.dead_links;
             }
         }
+        if (entry.info.stat_timed_out) {
+            ++stats.timed_out;
+        }
     }
     return stats;
 }
@@ -975,6 +1243,9 @@ void Renderer::PrintReportLong(const ReportStats& stats) const {
     std::cout << "        Unrecognized files      : " << stats.unrecognized_files << "\n";
     std::cout << "        Links                   : " << stats.links << "\n";
     std::cout << "        Dead links              : " << stats.dead_links << "\n";
+    if (stats.timed_out > 0) {
+        std::cout << "        Timed out               : " << stats.timed_out << "\n";
+    }
     std::cout << "        Total displayed size    : "
               << (opt_.bytes() ? std::to_string(stats.total_size)
                                : SizeFormatter::FormatHumanReadable(stats.total_size))
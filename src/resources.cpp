@@ -8,6 +8,7 @@
 #include <string>
 #include <system_error>
 
+#include "environment_cache.h"
 #include "perf.h"
 
 #ifdef _WIN32
@@ -100,6 +101,25 @@ public:
         Path cwd = std::filesystem::current_path(ec);
         const bool dev_mode_requested = EnvValueIsTruthy(std::getenv("NLS_DEV_MODE"));
 
+        // Development mode picks its database by existence, so only the
+        // installed layout is cached.
+        std::optional<EnvironmentCache> cache;
+        if (!dev_mode_requested && !ec) {
+            if (Path file = EnvironmentCache::DefaultFile(); !file.empty()) {
+                cache.emplace(std::move(file), EnvironmentCache::SessionKey(argv0, cwd));
+                EnvironmentCache::Snapshot snapshot;
+                if (cache->Load(snapshot)) {
+                    directories_ = std::move(snapshot.directories);
+                    user_config_dir_ = std::move(snapshot.user_config_dir);
+                    env_override_dir_ = std::move(snapshot.env_override_dir);
+                    if (perf_enabled) {
+                        perf_manager.IncrementCounter("resources::env_cache_hits");
+                    }
+                    return;
+                }
+            }
+        }
+
         if (const char* env = std::getenv("NLS_DATA_DIR")) {
             if (env[0] != '\0') {
                 auto normalized = normalize(Path(env));
@@ -219,7 +239,13 @@ public:
             }
         }
 #endif
+        if (cache) {
+            cache->Store({directories_, user_config_dir_, env_override_dir_});
+        }
         if (perf_enabled) {
+            if (cache) {
+                perf_manager.IncrementCounter("resources::env_cache_misses");
+            }
             perf_manager.IncrementCounter("resources::directories_registered",
                                           directories_.size() - initial_directories);
             if (!user_config_dir_.empty()) {
@@ -0,0 +1,257 @@
+#include "scan_checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#    include <io.h>
+#    include <sys/stat.h>
+#else
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "perf.h"
+
+namespace fs = std::filesystem;
+
+namespace nls {
+
+namespace {
+
+constexpr const char* kMagic = "nls-checkpoint";
+constexpr int kVersion = 1;
+
+// Checkpoints are at least this far apart, and further apart than fifty
+// times the last save took, which keeps them under 2% of the scan.
+constexpr std::chrono::seconds kMinInterval{5};
+constexpr int kIntervalFactor = 50;
+
+// Paths are stored as a byte count and the native representation, so names
+// with spaces or newlines survive the round trip.
+void WritePath(std::ostream& out, const fs::path& path) {
+    const auto& native = path.native();
+    const std::size_t bytes = native.size() * sizeof(fs::path::value_type);
+    out << bytes << ':';
+    out.write(reinterpret_cast<const char*>(native.data()), static_cast<std::streamsize>(bytes));
+    out << '\n';
+}
+
+bool ReadPath(std::istream& in, fs::path& path) {
+    std::size_t bytes = 0;
+    if (!(in >> bytes) || in.get() != ':' || bytes % sizeof(fs::path::value_type) != 0) {
+        return false;
+    }
+    fs::path::string_type native(bytes / sizeof(fs::path::value_type), fs::path::value_type{});
+    in.read(reinterpret_cast<char*>(native.data()), static_cast<std::streamsize>(bytes));
+    if (!in || in.get() != '\n') {
+        return false;
+    }
+    path = fs::path(std::move(native));
+    return true;
+}
+
+bool Expect(std::istream& in, const char* keyword) {
+    std::string word;
+    return static_cast<bool>(in >> word) && word == keyword;
+}
+
+std::optional<std::uint64_t> OutputOffset() {
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    const int fd = _fileno(stdout);
+    struct _stat64 st {};
+    if (_fstat64(fd, &st) != 0 || (st.st_mode & _S_IFREG) == 0) {
+        return std::nullopt;
+    }
+    const __int64 offset = _lseeki64(fd, 0, SEEK_CUR);
+#else
+    struct stat st {};
+    if (::fstat(STDOUT_FILENO, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::nullopt;
+    }
+    const off_t offset = ::lseek(STDOUT_FILENO, 0, SEEK_CUR);
+#endif
+    if (offset < 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint64_t>(offset);
+}
+
+}  // namespace
+
+ScanCheckpoint::ScanCheckpoint(fs::path file)
+    : file_(std::move(file)), last_save_(Clock::now()), interval_(kMinInterval) {}
+
+bool ScanCheckpoint::Load(State& state) const {
+    state = State{};
+    std::ifstream in(file_, std::ios::binary);
+    if (!in) {
+        std::error_code ec;
+        return !fs::exists(file_, ec);
+    }
+
+    int version = 0;
+    if (!Expect(in, kMagic) || !(in >> version) || version != kVersion) {
+        return false;
+    }
+    int fresh = 0;
+    int printed = 0;
+    std::string offset;
+    std::size_t visited = 0;
+    std::size_t pending = 0;
+    if (!Expect(in, "path") || !(in >> state.path_index >> fresh) || !Expect(in, "root") || in.get() != ' ' ||
+        !ReadPath(in, state.root) || !Expect(in, "printed") || !(in >> printed) || !Expect(in, "output") ||
+        !(in >> offset) || !Expect(in, "listed") || !(in >> state.directories_listed)) {
+        return false;
+    }
+    state.fresh = fresh != 0;
+    state.block_printed = printed != 0;
+    if (offset != "-") {
+        try {
+            state.output_offset = std::stoull(offset);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    if (!Expect(in, "visited") || !(in >> visited)) {
+        return false;
+    }
+    state.visited.resize(visited);
+    for (auto& id : state.visited) {
+        if (!(in >> id.device >> id.inode)) {
+            return false;
+        }
+    }
+
+    if (!Expect(in, "pending") || !(in >> pending)) {
+        return false;
+    }
+    state.pending.resize(pending);
+    for (auto& frame : state.pending) {
+        unsigned ownership = 0;
+        int top = 0;
+        if (!(in >> frame.depth >> ownership >> top) || in.get() != ' ' || !ReadPath(in, frame.dir)) {
+            return false;
+        }
+        frame.ownership = static_cast<std::uint8_t>(ownership);
+        frame.is_top_level = top != 0;
+    }
+    // A checkpoint cut short by a crash mid-write never gets here: saves
+    // go through a rename, and the trailer guards against truncation.
+    return Expect(in, "end");
+}
+
+bool ScanCheckpoint::Due() const {
+    return Clock::now() - last_save_ >= interval_;
+}
+
+void ScanCheckpoint::Save(State& state) {
+    const auto started = Clock::now();
+    auto& perf_manager = perf::Manager::Instance();
+    std::optional<perf::Timer> timer;
+    if (perf_manager.enabled()) {
+        timer.emplace("checkpoint::save");
+        perf_manager.IncrementCounter("checkpoint::saves");
+    }
+
+    state.output_offset = OutputOffset();
+
+    fs::path temp = file_;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "nls: cannot write checkpoint '" << temp.string() << "'\n";
+            interval_ = Clock::duration::max() / 2;
+            return;
+        }
+        out << kMagic << ' ' << kVersion << '\n';
+        out << "path " << state.path_index << ' ' << (state.fresh ? 1 : 0) << '\n';
+        out << "root ";
+        WritePath(out, state.root);
+        out << "printed " << (state.block_printed ? 1 : 0) << '\n';
+        out << "output ";
+        if (state.output_offset) {
+            out << *state.output_offset;
+        } else {
+            out << '-';
+        }
+        out << '\n';
+        out << "listed " << state.directories_listed << '\n';
+        out << "visited " << state.visited.size() << '\n';
+        for (const auto& id : state.visited) {
+            out << id.device << ' ' << id.inode << '\n';
+        }
+        out << "pending " << state.pending.size() << '\n';
+        for (const auto& frame : state.pending) {
+            out << frame.depth << ' ' << static_cast<unsigned>(frame.ownership) << ' '
+                << (frame.is_top_level ? 1 : 0) << ' ';
+            WritePath(out, frame.dir);
+        }
+        out << "end\n";
+        if (!out.flush()) {
+            std::error_code ec;
+            out.close();
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, file_, ec);
+    if (ec) {
+        std::cerr << "nls: cannot write checkpoint '" << file_.string() << "': " << ec.message() << "\n";
+        fs::remove(temp, ec);
+    }
+
+    const auto finished = Clock::now();
+    last_save_ = finished;
+    interval_ = std::max<Clock::duration>(kMinInterval, (finished - started) * kIntervalFactor);
+}
+
+void ScanCheckpoint::Remove() const {
+    std::error_code ec;
+    fs::remove(file_, ec);
+}
+
+bool ScanCheckpoint::RewindOutput(std::uint64_t offset, std::string& error) {
+#ifdef _WIN32
+    const int fd = _fileno(stdout);
+    struct _stat64 st {};
+    if (_fstat64(fd, &st) != 0 || (st.st_mode & _S_IFREG) == 0) {
+        error = "standard output is not a file; earlier output is not rewound";
+        return true;
+    }
+    const auto size = static_cast<std::uint64_t>(st.st_size);
+#else
+    struct stat st {};
+    if (::fstat(STDOUT_FILENO, &st) != 0 || !S_ISREG(st.st_mode)) {
+        error = "standard output is not a file; earlier output is not rewound";
+        return true;
+    }
+    const auto size = static_cast<std::uint64_t>(st.st_size);
+#endif
+    if (size < offset) {
+        error = "output holds " + std::to_string(size) + " bytes but the checkpoint expects " +
+                std::to_string(offset) + "; append to the same file with >>";
+        return false;
+    }
+#ifdef _WIN32
+    if (_chsize_s(fd, static_cast<__int64>(offset)) != 0 || _lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) {
+#else
+    if (::ftruncate(STDOUT_FILENO, static_cast<off_t>(offset)) != 0 ||
+        ::lseek(STDOUT_FILENO, static_cast<off_t>(offset), SEEK_SET) < 0) {
+#endif
+        error = "cannot truncate the output to the checkpoint";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace nls
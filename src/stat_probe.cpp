@@ -0,0 +1,171 @@
+#include "stat_probe.h"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace nls {
+
+namespace {
+
+// Extra threads allowed on top of the pool size to replace workers that are
+// stuck in the kernel. Once exhausted, remaining probes fail immediately.
+constexpr std::size_t kMaxStuckWorkers = 32;
+
+struct InjectedDelay {
+    std::string needle;
+    std::chrono::milliseconds delay{0};
+};
+
+// NLS_DEBUG_STAT_DELAY="<substring>:<milliseconds>" stalls probes of
+// matching paths, standing in for a hung mount in tests.
+InjectedDelay ReadInjectedDelay() {
+    InjectedDelay result;
+    const char* env = std::getenv("NLS_DEBUG_STAT_DELAY");
+    if (!env || env[0] == '\0') {
+        return result;
+    }
+    std::string_view value(env);
+    const auto colon = value.rfind(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return result;
+    }
+    try {
+        result.delay = std::chrono::milliseconds(std::stoll(std::string(value.substr(colon + 1))));
+        result.needle = std::string(value.substr(0, colon));
+    } catch (const std::exception&) {
+        result = {};
+    }
+    return result;
+}
+
+void InjectDelay(const std::filesystem::path& path, const InjectedDelay& injected) {
+    if (!injected.needle.empty() && path.string().find(injected.needle) != std::string::npos) {
+        std::this_thread::sleep_for(injected.delay);
+    }
+}
+
+}  // namespace
+
+struct StatProbePool::Job {
+    enum class State { Queued, Running, Done };
+
+    Probe probe;
+    State state = State::Queued;
+    std::chrono::steady_clock::time_point started{};
+    bool abandoned = false;
+};
+
+struct StatProbePool::Shared {
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::size_t live_workers = 0;
+    std::size_t desired_workers = 0;
+    std::size_t stuck_workers = 0;
+    bool shutting_down = false;
+    InjectedDelay injected;
+};
+
+StatProbePool::StatProbePool(std::chrono::milliseconds timeout, std::size_t workers)
+    : timeout_(timeout), shared_(std::make_shared<Shared>()) {
+    shared_->desired_workers = workers == 0 ? 1 : workers;
+    shared_->injected = ReadInjectedDelay();
+    for (std::size_t i = 0; i < shared_->desired_workers; ++i) {
+        SpawnWorker();
+    }
+}
+
+StatProbePool::~StatProbePool() {
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->shutting_down = true;
+        shared_->queue.clear();
+    }
+    shared_->work_cv.notify_all();
+}
+
+void StatProbePool::SpawnWorker() {
+    ++shared_->live_workers;
+    std::thread(&StatProbePool::WorkerLoop, shared_).detach();
+}
+
+void StatProbePool::WorkerLoop(std::shared_ptr<Shared> shared) {
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    while (true) {
+        shared->work_cv.wait(lock, [&] { return shared->shutting_down || !shared->queue.empty(); });
+        if (shared->shutting_down) {
+            --shared->live_workers;
+            return;
+        }
+        std::shared_ptr<Job> job = std::move(shared->queue.front());
+        shared->queue.pop_front();
+        job->state = Job::State::Running;
+        job->started = std::chrono::steady_clock::now();
+        lock.unlock();
+
+        InjectDelay(job->probe.path, shared->injected);
+        job->probe.read();
+
+        lock.lock();
+        job->state = Job::State::Done;
+        if (job->abandoned) {
+            // The caller gave up on us and already started a replacement.
+            --shared->stuck_workers;
+            return;
+        }
+        shared->done_cv.notify_all();
+    }
+}
+
+std::vector<bool> StatProbePool::ProbeAll(std::vector<Probe> probes) {
+    std::vector<bool> responsive(probes.size(), true);
+    std::vector<std::shared_ptr<Job>> jobs;
+    jobs.reserve(probes.size());
+
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    for (auto& probe : probes) {
+        auto job = std::make_shared<Job>();
+        job->probe = std::move(probe);
+        shared_->queue.push_back(job);
+        jobs.push_back(std::move(job));
+    }
+    shared_->work_cv.notify_all();
+
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        Job& job = *jobs[i];
+        while (job.state != Job::State::Done) {
+            if (job.state == Job::State::Running) {
+                const auto deadline = job.started + timeout_;
+                if (std::chrono::steady_clock::now() < deadline) {
+                    shared_->done_cv.wait_until(lock, deadline);
+                    continue;
+                }
+                job.abandoned = true;
+                responsive[i] = false;
+                --shared_->live_workers;
+                ++shared_->stuck_workers;
+                if (shared_->stuck_workers <= kMaxStuckWorkers) {
+                    SpawnWorker();
+                }
+                break;
+            }
+            if (shared_->live_workers == 0) {
+                // Every worker is wedged and the replacement budget is spent.
+                std::erase(shared_->queue, jobs[i]);
+                responsive[i] = false;
+                break;
+            }
+            shared_->done_cv.wait_for(lock, timeout_);
+        }
+    }
+    return responsive;
+}
+
+}  // namespace nls
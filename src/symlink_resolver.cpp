@@ -1,8 +1,59 @@
 #include "symlink_resolver.h"
 
+#include <utility>
+
+#include "perf.h"
+
 namespace nls {
 
-std::optional<std::filesystem::path> SymlinkResolver::ResolveTarget(const FileInfo& file_info) const {
+namespace {
+
+bool IsMissingError(const std::error_code& ec) {
+    if (!ec) {
+        return false;
+    }
+    return ec == std::errc::no_such_file_or_directory || ec == std::errc::not_a_directory;
+}
+
+void ReadStatus(const FileInfo& file_info,
+                const std::optional<std::filesystem::path>& resolved,
+                SymlinkResolver::TargetStat& stat) {
+    namespace fs = std::filesystem;
+    stat.status = fs::status(file_info.path, stat.status_error);
+    if (stat.status_error && !IsMissingError(stat.status_error) && resolved) {
+        std::error_code resolved_ec;
+        fs::file_status resolved_status = fs::status(*resolved, resolved_ec);
+        if (!resolved_ec || IsMissingError(resolved_ec)) {
+            stat.status = resolved_status;
+            stat.status_error = resolved_ec;
+        }
+    }
+    stat.broken = IsMissingError(stat.status_error)
+               || (!stat.status_error && stat.status.type() == fs::file_type::not_found);
+}
+
+void ReadDetails(const FileInfo& file_info, SymlinkResolver::TargetStat& stat) {
+    namespace fs = std::filesystem;
+    stat.has_details = true;
+    if (!stat.status_error && fs::is_regular_file(stat.status)) {
+        std::error_code size_ec;
+        auto size = fs::file_size(file_info.path, size_ec);
+        if (!size_ec) {
+            stat.size = size;
+            stat.has_size = true;
+        }
+    }
+    std::error_code time_ec;
+    auto mtime = fs::last_write_time(file_info.path, time_ec);
+    if (!time_ec) {
+        stat.mtime = mtime;
+        stat.has_mtime = true;
+    }
+}
+
+} // namespace
+
+std::optional<std::filesystem::path> SymlinkResolver::ResolveTarget(const FileInfo& file_info) {
     if (!file_info.is_symlink || !file_info.has_symlink_target) {
         return std::nullopt;
     }
@@ -26,4 +77,87 @@ std::optional<std::filesystem::path> SymlinkResolver::ResolveTarget(const FileIn
     return target;
 }
 
+std::filesystem::path SymlinkResolver::CacheKey(const FileInfo& file_info) const {
+    namespace fs = std::filesystem;
+    if (!file_info.is_symlink || !file_info.has_symlink_target || file_info.symlink_target.empty()) {
+        return file_info.path;
+    }
+    const fs::path& target = file_info.symlink_target;
+    if (target.is_absolute()) {
+        return target;
+    }
+
+    // A lexical key would fold "dir/link/../x" into "dir/x", but under -L the
+    // parent may itself be reached through a symlink, so resolve it once per
+    // directory. Leading ".." steps are then safe to apply; anything after the
+    // first named component is kept verbatim.
+    const fs::path parent = file_info.path.parent_path();
+    auto [parent_it, parent_inserted] = canonical_parents_.try_emplace(parent.native());
+    if (parent_inserted) {
+        std::error_code ec;
+        parent_it->second = fs::canonical(parent.empty() ? fs::path(".") : parent, ec);
+        if (ec) {
+            parent_it->second.clear();
+        }
+    }
+    if (parent_it->second.empty()) {
+        return file_info.path;
+    }
+
+    fs::path key = parent_it->second;
+    auto component = target.begin();
+    for (; component != target.end(); ++component) {
+        if (*component == "..") {
+            key = key.parent_path();
+        } else if (*component != "." && !component->empty()) {
+            break;
+        }
+    }
+    for (; component != target.end(); ++component) {
+        key /= *component;
+    }
+    return key;
+}
+
+const SymlinkResolver::TargetStat& SymlinkResolver::StatTarget(const FileInfo& file_info,
+                                                               bool with_details) const {
+    namespace fs = std::filesystem;
+    auto& perf_manager = perf::Manager::Instance();
+
+    std::optional<fs::path> resolved = ResolveTarget(file_info);
+    auto [it, inserted] = target_cache_.try_emplace(CacheKey(file_info).native());
+    TargetStat& stat = it->second;
+
+    if (inserted) {
+        if (perf_manager.enabled()) {
+            perf_manager.IncrementCounter("symlink::target_cache_misses");
+        }
+        ReadStatus(file_info, resolved, stat);
+    } else if (perf_manager.enabled()) {
+        perf_manager.IncrementCounter("symlink::target_cache_hits");
+    }
+
+    if (with_details && !stat.has_details) {
+        ReadDetails(file_info, stat);
+    }
+
+    return stat;
+}
+
+SymlinkResolver::TargetStat SymlinkResolver::ReadTarget(const FileInfo& file_info, bool with_details) {
+    TargetStat stat;
+    ReadStatus(file_info, ResolveTarget(file_info), stat);
+    if (with_details) {
+        ReadDetails(file_info, stat);
+    }
+    return stat;
+}
+
+void SymlinkResolver::Remember(const FileInfo& file_info, const TargetStat& stat) const {
+    auto [it, inserted] = target_cache_.try_emplace(CacheKey(file_info).native(), stat);
+    if (!inserted && !it->second.has_details && stat.has_details) {
+        it->second = stat;
+    }
+}
+
 } // namespace nls
@@ -150,6 +150,9 @@ struct SqliteStmtFinalizer {
 using SqliteDbPtr = std::unique_ptr<sqlite3, SqliteCloser>;
 using SqliteStmtPtr = std::unique_ptr<sqlite3_stmt, SqliteStmtFinalizer>;
 
+// Only reserves address space: SQLite never maps more than the file holds.
+static constexpr const char* kMmapPragma = "PRAGMA mmap_size=268435456;";
+
 static std::string MakeSqliteOpenPath(const std::filesystem::path& path, bool use_uri, bool immutable)
 {
     auto write_u8 = [](const std::u8string& u8) {
@@ -177,7 +180,9 @@ static std::string MakeSqliteOpenPath(const std::filesystem::path& path, bool us
 static SqliteDbPtr OpenConfigDatabase(const std::filesystem::path& path)
 {
     sqlite3* raw = nullptr;
-    const int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_URI;
+    // Connections never leave the loading thread, so every column read can
+    // skip the connection mutex.
+    const int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | SQLITE_OPEN_NOMUTEX;
     std::string open_path = MakeSqliteOpenPath(path, true, true);
     int rc = sqlite3_open_v2(open_path.c_str(), &raw, flags, nullptr);
     if (rc != SQLITE_OK) {
@@ -191,35 +196,46 @@ static SqliteDbPtr OpenConfigDatabase(const std::filesystem::path& path)
         }
         return {};
     }
+    // Candidates are opened immutable, so pages can be read straight from a
+    // shared mapping instead of being copied into SQLite's page cache.
+    sqlite3_exec(raw, kMmapPragma, nullptr, nullptr, nullptr);
     return SqliteDbPtr(raw);
 }
 
-static bool LoadThemeColors(sqlite3* db, int theme_id, ThemeColors& target, std::size_t& entries_out)
+static SqliteStmtPtr PrepareThemeColors(sqlite3* db)
 {
     static constexpr const char* kSql =
         "SELECT element, c.value FROM Theme_colors t "
         "JOIN Colors c ON t.color_id = c.id WHERE t.id = ?1;";
     sqlite3_stmt* stmt_raw = nullptr;
-    int rc = sqlite3_prepare_v2(db, kSql, -1, &stmt_raw, nullptr);
-    if (rc != SQLITE_OK) {
-        entries_out = 0;
+    if (sqlite3_prepare_v2(db, kSql, -1, &stmt_raw, nullptr) != SQLITE_OK) {
+        return {};
+    }
+    return SqliteStmtPtr(stmt_raw);
+}
+
+// Runs the statement from PrepareThemeColors for one theme; the statement is
+// reset first, so a candidate prepares it once for both schemes.
+static bool LoadThemeColors(sqlite3_stmt* stmt, int theme_id, ThemeColors& target, std::size_t& entries_out)
+{
+    entries_out = 0;
+    if (!stmt) {
         return false;
     }
-    SqliteStmtPtr stmt(stmt_raw);
-    rc = sqlite3_bind_int(stmt.get(), 1, theme_id);
+    sqlite3_reset(stmt);
+    int rc = sqlite3_bind_int(stmt, 1, theme_id);
     if (rc != SQLITE_OK) {
-        entries_out = 0;
         return false;
     }
 
     std::size_t entries = 0;
-    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
-        const unsigned char* element = sqlite3_column_text(stmt.get(), 0);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const unsigned char* element = sqlite3_column_text(stmt, 0);
         if (!element) {
             continue;
         }
         std::string key = StringUtils::ToLower(reinterpret_cast<const char*>(element));
-        std::uint32_t rgb = static_cast<std::uint32_t>(sqlite3_column_int64(stmt.get(), 1)) & 0xFFFFFFu;
+        std::uint32_t rgb = static_cast<std::uint32_t>(sqlite3_column_int64(stmt, 1)) & 0xFFFFFFu;
         target.set(std::move(key), ThemeSupport::MakeAnsiFromRgb(rgb));
         ++entries;
     }
@@ -291,17 +307,17 @@ static IconLoadStats LoadIconsFromDatabase(sqlite3* db, IconTheme& icons)
                 std::cerr << "Warning: Missing key or icon value in query '" << query << "'\n";
                 continue;
             }
-            std::string key_str(StringUtils::ToLower(reinterpret_cast<const char*>(key)));
-            std::string value_str(reinterpret_cast<const char*>(value));
-            if (is_alias) {
-                value_str = StringUtils::ToLower(value_str);
-            }
+            const char* value_text = reinterpret_cast<const char*>(value);
             // Check for malformed icon value (example: empty string)
-            if (value_str.empty()) {
-                std::cerr << "Warning: Malformed icon value for key '" << key_str << "' in query '" << query << "'\n";
+            if (value_text[0] == '\0') {
+                std::cerr << "Warning: Malformed icon value for key '"
+                          << StringUtils::ToLower(reinterpret_cast<const char*>(key)) << "' in query '" << query
+                          << "'\n";
                 continue;
             }
-            target[key_str] = value_str;
+            // Build each string once and move it into the table.
+            target[StringUtils::ToLower(reinterpret_cast<const char*>(key))] =
+                is_alias ? StringUtils::ToLower(value_text) : std::string(value_text);
             ++stats.entries;
         }
         if (rc != SQLITE_DONE) {
@@ -399,7 +415,7 @@ void Theme::initialize(ColorScheme scheme, std::optional<std::string> custom_the
                     }
                     ThemeColors loaded = fallback_;
                     std::size_t entries = 0;
-                    if (!LoadThemeColors(db.get(), *theme_id, loaded, entries)) {
+                    if (!LoadThemeColors(PrepareThemeColors(db.get()).get(), *theme_id, loaded, entries)) {
                         continue;
                     }
                     custom_theme_name_ = name;
@@ -479,6 +495,24 @@ IconResult Theme::get_icon(std::string_view name, bool is_dir, bool is_executabl
     return file_icon(name, is_executable);
 }
 
+IconResult Theme::get_type_icon(std::string_view type_key)
+{
+    ensure_loaded();
+    const std::string key(type_key);
+    auto direct = icons_.files.find(key);
+    if (direct != icons_.files.end()) {
+        return {direct->second, true};
+    }
+    auto alias = icons_.file_aliases.find(key);
+    if (alias != icons_.file_aliases.end()) {
+        auto base = icons_.files.find(alias->second);
+        if (base != icons_.files.end()) {
+            return {base->second, true};
+        }
+    }
+    return {};
+}
+
 void Theme::ensure_loaded()
 {
     if (loaded_) return;
@@ -506,14 +540,19 @@ void Theme::ensure_loaded()
     for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
         const auto& candidate = *it;
         if (candidate.empty()) continue;
+        std::optional<perf::Timer> candidate_timer;
+        if (perf_enabled) {
+            candidate_timer.emplace("theme::candidate " + candidate.string());
+        }
         if (auto db = OpenConfigDatabase(candidate)) {
+            SqliteStmtPtr colors = PrepareThemeColors(db.get());
             std::size_t dark_entries = 0;
-            if (LoadThemeColors(db.get(), 1, dark_, dark_entries)) {
+            if (LoadThemeColors(colors.get(), 1, dark_, dark_entries)) {
                 ++theme_sources;
                 theme_entries += dark_entries;
             }
             std::size_t light_entries = 0;
-            if (LoadThemeColors(db.get(), 2, light_, light_entries)) {
+            if (LoadThemeColors(colors.get(), 2, light_, light_entries)) {
                 ++theme_sources;
                 theme_entries += light_entries;
             }
@@ -0,0 +1,144 @@
+#include "xattr_resolver.h"
+
+#include <array>
+#include <cerrno>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/xattr.h>
+#endif
+
+#include "perf.h"
+
+namespace nls {
+
+namespace {
+
+#ifdef __linux__
+// Most files carry no attributes or just a security label, so the first
+// call usually fits here and no separate size query is needed.
+constexpr std::size_t kInlineNamesSize = 256;
+
+char ClassifyNames(std::string_view names) {
+    char indicator = 0;
+    while (!names.empty()) {
+        const std::size_t end = names.find('\0');
+        const std::string_view name = names.substr(0, end);
+        if (name == "system.posix_acl_access" || name == "system.posix_acl_default" ||
+            name == "system.nfs4_acl") {
+            return '+';
+        }
+        if (name == "security.selinux" || name == "security.SMACK64") {
+            indicator = '.';
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        names.remove_prefix(end + 1);
+    }
+    return indicator;
+}
+
+ssize_t ListNames(const char* path, bool follow, char* buffer, std::size_t size) {
+    return follow ? ::listxattr(path, buffer, size) : ::llistxattr(path, buffer, size);
+}
+#endif
+
+} // namespace
+
+char XattrResolver::Indicator(const FileInfo& file_info, bool dereference, const Reading* reading) const {
+#ifdef __linux__
+    // Without a successful stat there is no inode to key on, and reading the
+    // attributes of an automount point would trigger the mount.
+    if (!file_info.has_owner_id || file_info.is_automount) {
+        return 0;
+    }
+
+    auto& perf_manager = perf::Manager::Instance();
+    const bool perf_enabled = perf_manager.enabled();
+    if (perf_enabled) {
+        perf_manager.IncrementCounter("xattr::entries");
+    }
+
+    if (unsupported_devices_.contains(file_info.device)) {
+        return 0;
+    }
+
+    const InodeKey key{file_info.device, file_info.inode};
+    Reading fresh;
+    if (!reading) {
+        if (auto it = cache_.find(key); it != cache_.end() && it->second.ctime_ns == file_info.ctime_ns) {
+            if (perf_enabled) {
+                perf_manager.IncrementCounter("xattr::cache_hits");
+            }
+            return it->second.indicator;
+        }
+        fresh = Read(file_info, dereference);
+        reading = &fresh;
+    }
+    if (perf_enabled) {
+        perf_manager.IncrementCounter("xattr::syscalls", reading->syscalls);
+    }
+
+    if (reading->error != 0) {
+        if (reading->error == ENOTSUP) {
+            unsupported_devices_.insert(file_info.device);
+        }
+        return 0;
+    }
+
+    cache_[key] = CachedIndicator{file_info.ctime_ns, reading->indicator};
+    return reading->indicator;
+#else
+    (void)file_info;
+    (void)dereference;
+    (void)reading;
+    return 0;
+#endif
+}
+
+XattrResolver::Reading XattrResolver::Read(const FileInfo& file_info, bool dereference) {
+    Reading reading;
+#ifdef __linux__
+    if (!file_info.has_owner_id || file_info.is_automount) {
+        return reading;
+    }
+
+    const bool follow = dereference && file_info.is_symlink && !file_info.is_broken_symlink;
+    const char* path = file_info.path.c_str();
+    reading.syscalls = 1;
+    std::array<char, kInlineNamesSize> inline_names{};
+    std::vector<char> names;
+    ssize_t length = ListNames(path, follow, inline_names.data(), inline_names.size());
+    const char* data = inline_names.data();
+    if (length < 0 && errno == ERANGE) {
+        // The list changed size between calls at most a couple of times in
+        // practice; give up rather than loop if it keeps growing.
+        for (int attempt = 0; attempt < 2 && length < 0 && errno == ERANGE; ++attempt) {
+            const ssize_t needed = ListNames(path, follow, nullptr, 0);
+            reading.syscalls += 1;
+            if (needed <= 0) {
+                length = needed;
+                break;
+            }
+            names.resize(static_cast<std::size_t>(needed));
+            length = ListNames(path, follow, names.data(), names.size());
+            reading.syscalls += 1;
+        }
+        data = names.data();
+    }
+
+    if (length < 0) {
+        reading.error = errno;
+        return reading;
+    }
+    reading.indicator = ClassifyNames(std::string_view(data, static_cast<std::size_t>(length)));
+#else
+    (void)file_info;
+    (void)dereference;
+#endif
+    return reading;
+}
+
+} // namespace nls
@@ -5,13 +5,18 @@ from __future__ import annotations
 
 import argparse
 import ctypes
+import locale
 import os
 import platform
 import re
 import shutil
+import signal
 import sqlite3
+import struct
 import subprocess
 import sys
+import time
+import urllib.parse
 from dataclasses import dataclass
 from pathlib import Path
 from typing import Callable, Dict, Iterable, Optional
@@ -27,6 +32,11 @@ class TestCase:
     env: Optional[Dict[str, str]] = None
     cwd: Optional[Path] = None
     verify: Optional[Callable[[Path, Path], Optional[str]]] = None
+    # Run with standard output connected to a pipe whose reader has already
+    # exited, as in `nls -R / | head` after head is done.
+    closed_stdout: bool = False
+    # Minor problems such as an unreadable entry exit with 1, like GNU ls.
+    expected_returncode: int = 0
 
 
 def parse_args() -> argparse.Namespace:
@@ -103,11 +113,17 @@ def generate_fixtures(destination: Path, platform_choice: str) -> None:
     subprocess.run(cmd, check=True, cwd=REPO_ROOT)
 
 
-def _default_env() -> dict[str, str]:
+def _default_env(home: Path) -> dict[str, str]:
     env = os.environ.copy()
     env.setdefault("LC_ALL", "C.UTF-8")
     env.setdefault("LANG", "C.UTF-8")
     env.setdefault("NLS_THEME", "dark")
+    # nls keeps per-user caches under the home directory; a scratch one keeps
+    # runs independent of each other and of the user's real caches.
+    env["HOME"] = str(home)
+    if os.name == "nt":
+        env["APPDATA"] = str(home / "AppData")
+        env["USERPROFILE"] = str(home)
     return env
 
 
@@ -189,7 +205,11 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         raise RuntimeError(f"fixture root {root_dir} is missing")
 
     cases: list[TestCase] = []
-    env = _default_env()
+    scratch_home = fixture_dir / "home"
+    if scratch_home.exists():
+        shutil.rmtree(scratch_home)
+    scratch_home.mkdir(parents=True)
+    env = _default_env(scratch_home)
     cwd = REPO_ROOT
 
     def add(
@@ -198,6 +218,8 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         case_env: Optional[Dict[str, str]] = None,
         case_cwd: Optional[Path] = None,
         verify: Optional[Callable[[Path, Path], Optional[str]]] = None,
+        closed_stdout: bool = False,
+        expected_returncode: int = 0,
     ) -> None:
         args_list = list(args)
         if case_env is None:
@@ -205,7 +227,8 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         else:
             merged_env = env.copy()
             merged_env.update(case_env)
-        cases.append(TestCase(name=name, args=args_list, env=merged_env, cwd=case_cwd or cwd, verify=verify))
+        cases.append(TestCase(name=name, args=args_list, env=merged_env, cwd=case_cwd or cwd, verify=verify,
+                              closed_stdout=closed_stdout, expected_returncode=expected_returncode))
 
     def skip_case(name: str, reason: str) -> None:
         print(f"[skip] {name}: {reason}")
@@ -454,7 +477,47 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
     add("comma-separated", "-m", str(root_dir))
     add("tabsize", "-T", "4", str(root_dir))
     add("width", "-w", "120", str(root_dir))
+
+    columns_root = fixture_dir / "columns"
+    if columns_root.exists():
+        shutil.rmtree(columns_root)
+    columns_root.mkdir(parents=True)
+    column_names = [f"f{index:02d}" for index in range(24)] + ["a-rather-long-file-name.txt"]
+    for name in column_names:
+        (columns_root / name).write_text("", encoding="utf-8")
+
+    def verify_variable_columns(out_path: Path, _: Path) -> Optional[str]:
+        lines = out_path.read_text(encoding="utf-8", errors="replace").splitlines()
+        if any(len(line) >= 40 for line in lines):
+            return "a line reaches the 40 column width"
+        listed = sorted(" ".join(lines).split())
+        if listed != sorted(column_names):
+            return f"unexpected names in grid: {listed!r}"
+        if len(lines) >= len(column_names) // 2:
+            return f"one long name collapsed the grid to {len(lines)} rows"
+        return None
+
+    for layout in ("-C", "-x"):
+        add(f"variable-columns{layout}", layout, "-w", "40", "--no-icons", "--no-color", str(columns_root),
+            verify=verify_variable_columns)
     add("tree", "--tree", str(root_dir))
+
+    def verify_progress(out_path: Path, err_path: Path) -> Optional[str]:
+        if " entries (" in out_path.read_text(encoding="utf-8", errors="replace"):
+            return "progress lines leaked into stdout"
+        # A short run may finish before the first report.
+        progress_line = re.compile(r"nls: \d+ dirs, \d+ entries \(\d+/s\), ")
+        for line in err_path.read_text(encoding="utf-8", errors="replace").splitlines():
+            if " dirs, " in line and not progress_line.match(line):
+                return f"malformed progress line {line!r}"
+        return None
+
+    add("recursive-background", "-R", "--background", "--max-ops-per-sec=5000", "--no-icons", "--no-color",
+        str(root_dir))
+    add("recursive-progress", "-R", "--progress", "--no-icons", "--no-color", str(root_dir), verify=verify_progress)
+    if os.name != "nt":
+        add("recursive-closed-pipe", "-R", "--no-icons", "--no-color", str(root_dir), closed_stdout=True)
+        add("tree-closed-pipe", "--tree", "--no-icons", "--no-color", str(root_dir), closed_stdout=True)
     add("tree-depth", "--tree=2", str(root_dir))
     if root_dir.name == "lin":
         recursive_root = root_dir / "nested"
@@ -492,6 +555,115 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         str(recursive_root),
         verify=make_recursive_flat_verify(recursive_headers),
     )
+
+    def verify_checkpoint_removed(checkpoint: Path, expected_headers: Iterable[Path]) -> Callable[[Path, Path], Optional[str]]:
+        verify_headers = make_recursive_flat_verify(expected_headers)
+
+        def _verify(out_path: Path, err_path: Path) -> Optional[str]:
+            if checkpoint.exists():
+                return "checkpoint was left behind after a complete listing"
+            return verify_headers(out_path, err_path)
+
+        return _verify
+
+    # The fixture sits on one file system with no skipped mounts, so nothing is pruned.
+    add("recursive-one-file-system", "-R", "--one-file-system", "--skip-fs=proc,sysfs,fuse", "--no-icons",
+        "--no-color", "-1", str(recursive_root), verify=make_recursive_flat_verify(recursive_headers))
+
+    # /dev normally has its own mounts (devpts, a tmpfs for shm, mqueue), so
+    # -R over it has to prune a real mount point: listed, but never opened.
+    mountinfo = Path("/proc/self/mountinfo")
+    if sys.platform.startswith("linux") and mountinfo.exists():
+        mount_types: Dict[str, str] = {}
+        for line in mountinfo.read_text(encoding="utf-8", errors="replace").splitlines():
+            fields, _, tail = line.partition(" - ")
+            parts = fields.split()
+            if len(parts) < 5 or not tail:
+                continue
+            point = re.sub(r"\\([0-7]{3})", lambda match: chr(int(match.group(1), 8)), parts[4])
+            mount_types[point] = tail.split()[0]
+        dev_type = mount_types.get("/dev")
+        nested_mounts = sorted(point for point, fs_type in mount_types.items()
+                               if os.path.dirname(point) == "/dev" and fs_type != dev_type and os.path.isdir(point))
+        if nested_mounts:
+            pruned_mount = nested_mounts[0]
+            pruned_type = mount_types[pruned_mount]
+            dev_device = os.stat("/dev").st_dev
+
+            def walk_ends_cleanly(prune: Callable[[str], bool]) -> bool:
+                # The exit status depends on whether every directory nls
+                # opens is readable; find out the same way first.
+                errors: list[OSError] = []
+                for current, dirs, _ in os.walk("/dev", onerror=errors.append):
+                    dirs[:] = [name for name in dirs if not prune(os.path.join(current, name))]
+                return not errors
+
+            def make_mount_prune_verify(mount_point: str) -> Callable[[Path, Path], Optional[str]]:
+                def _verify(out_path: Path, _: Path) -> Optional[str]:
+                    blocks: dict[str, list[str]] = {}
+                    current: Optional[list[str]] = None
+                    for line in out_path.read_text(encoding="utf-8", errors="replace").splitlines():
+                        if line.endswith(":") and line.startswith("/"):
+                            current = blocks.setdefault(line[:-1], [])
+                        elif line.strip() and current is not None:
+                            current.append(line.strip().rstrip("/"))
+                    if "/dev" not in blocks:
+                        return "expected a /dev block in stdout"
+                    if os.path.basename(mount_point) not in blocks["/dev"]:
+                        return f"mount point {mount_point} missing from the /dev listing"
+                    opened = [header for header in blocks
+                              if header == mount_point or header.startswith(mount_point + "/")]
+                    if opened:
+                        return f"descended into pruned mount {opened[0]}"
+                    return None
+
+                return _verify
+
+            def skipped_type(path: str) -> bool:
+                return mount_types.get(path) == pruned_type
+
+            def other_device(path: str) -> bool:
+                try:
+                    return os.lstat(path).st_dev != dev_device
+                except OSError:
+                    return True
+
+            add("recursive-skip-fs-mount", "-R", f"--skip-fs=proc,sysfs,{pruned_type}", "--no-icons", "--no-color",
+                "-1", "/dev", verify=make_mount_prune_verify(pruned_mount),
+                expected_returncode=0 if walk_ends_cleanly(skipped_type) else 1)
+            add("recursive-one-file-system-mount", "-R", "--one-file-system", "--no-icons", "--no-color", "-1", "/dev",
+                verify=make_mount_prune_verify(pruned_mount),
+                expected_returncode=0 if walk_ends_cleanly(other_device) else 1)
+
+    checkpoint_file = fixture_dir / "recursive.checkpoint"
+    add("recursive-checkpoint", "-R", f"--checkpoint={checkpoint_file}", "--no-icons", "--no-color", "-1",
+        str(recursive_root), verify=verify_checkpoint_removed(checkpoint_file, recursive_headers))
+
+    # A checkpoint taken after the root was listed, with one subdirectory left.
+    def checkpoint_path(path: Path) -> bytes:
+        native = str(path).encode("utf-16-le" if os.name == "nt" else "utf-8", errors="surrogateescape")
+        return str(len(native)).encode() + b":" + native + b"\n"
+
+    resume_file = fixture_dir / "resume.checkpoint"
+    resume_file.write_bytes(
+        b"nls-checkpoint 1\npath 0 0\nroot " + checkpoint_path(recursive_root)
+        + b"printed 1\noutput -\nlisted 1\nvisited 0\npending 1\n1 1 0 " + checkpoint_path(recursive_headers[1])
+        + b"end\n"
+    )
+
+    def verify_resume(out_path: Path, err_path: Path) -> Optional[str]:
+        text = out_path.read_text(encoding="utf-8", errors="replace").replace("\r\n", "\n")
+        if f"{recursive_root}:\n" in text:
+            return "resumed listing repeated the already-listed root"
+        for header in recursive_headers[1:]:
+            if f"{header}:" not in text:
+                return f"expected header '{header}:' in stdout"
+        if resume_file.exists():
+            return "checkpoint was left behind after a complete listing"
+        return None
+
+    add("recursive-resume", "-R", f"--checkpoint={resume_file}", "--resume", "--no-icons", "--no-color", "-1",
+        str(recursive_root), verify=verify_resume)
     add(
         "recursive-flat-files-only",
         "-R",
@@ -523,6 +695,74 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         str(ignore_root),
         verify=make_recursive_flat_verify(ignore_headers, must_exclude=ignore_missing),
     )
+    def make_shard_verify(lists_root: bool) -> Callable[[Path, Path], Optional[str]]:
+        root_header = f"{recursive_root}:"
+
+        def _verify(out_path: Path, _: Path) -> Optional[str]:
+            lines = out_path.read_text(encoding="utf-8", errors="replace").replace("\r\n", "\n").split("\n")
+            if lists_root and root_header not in lines:
+                return f"expected header '{root_header}' in stdout"
+            if not lists_root and root_header in lines:
+                return f"did not expect header '{root_header}' in stdout"
+            return None
+
+        return _verify
+
+    add(
+        "recursive-shard-first",
+        "-R",
+        "--shard",
+        "1/2",
+        "--no-icons",
+        "--no-color",
+        "-1",
+        str(recursive_root),
+        verify=make_shard_verify(True),
+    )
+    add(
+        "recursive-shard-second",
+        "-R",
+        "--shard=2/2",
+        "--shard-depth=2",
+        "--no-icons",
+        "--no-color",
+        "-1",
+        str(recursive_root),
+        verify=make_shard_verify(False),
+    )
+
+    # Together, the slices of one --shard run must print every directory
+    # exactly once, whatever the shard depth.
+    shard_root = fixture_dir / "shards"
+    if shard_root.exists():
+        shutil.rmtree(shard_root)
+    for top in "abcdefgh":
+        for middle in range(3):
+            (shard_root / top / f"{top}{middle}" / "leaf").mkdir(parents=True)
+            (shard_root / top / f"{top}{middle}" / "leaf" / "file.txt").write_text("", encoding="utf-8")
+    shard_headers = sorted(f"{directory}:" for directory, _, _ in os.walk(shard_root))
+    shard_outputs: dict[str, list[str]] = {}
+
+    def make_shard_union_verify(group: str, last: bool) -> Callable[[Path, Path], Optional[str]]:
+        def _verify(out_path: Path, _: Path) -> Optional[str]:
+            lines = out_path.read_text(encoding="utf-8", errors="replace").replace("\r\n", "\n").split("\n")
+            listed = shard_outputs.setdefault(group, [])
+            listed.extend(line for line in lines if line.startswith(str(shard_root)) and line.endswith(":"))
+            if not last:
+                return None
+            if sorted(listed) != shard_headers:
+                missing = sorted(set(shard_headers) - set(listed))
+                repeated = sorted({header for header in listed if listed.count(header) > 1})
+                return f"shards missed {missing} and repeated {repeated}"
+            return None
+
+        return _verify
+
+    for count, depth in ((2, 1), (3, 2), (4, 3)):
+        for index in range(1, count + 1):
+            add(f"recursive-shard-union-{count}-depth-{depth}-slice-{index}", "-R", f"--shard={index}/{count}",
+                f"--shard-depth={depth}", "--no-icons", "--no-color", "-1", str(shard_root),
+                verify=make_shard_union_verify(f"{count}/{depth}", index == count))
     for report_opt in ("short", "long"):
         add(f"report-{report_opt}", f"--report={report_opt}", str(root_dir))
     add("zero-terminated", "--zero", str(root_dir))
@@ -540,10 +780,121 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
     add("sort-mod-time", "-t", str(root_dir))
     add("sort-size", "-S", str(root_dir))
     add("sort-extension", "-X", str(root_dir))
+    add("sort-version", "-v", str(root_dir))
     add("unsorted", "-U", str(root_dir))
     add("reverse", "-r", str(root_dir))
-    for sort_opt in ("size", "time", "extension", "none"):
+    for sort_opt in ("size", "time", "extension", "version", "none"):
         add(f"sort-by-{sort_opt}", "--sort", sort_opt, str(root_dir))
+    for collate_opt in ("ascii", "locale"):
+        add(f"collate-{collate_opt}", "--collate", collate_opt, str(root_dir))
+
+    order_root = fixture_dir / "sort_order"
+    if order_root.exists():
+        shutil.rmtree(order_root)
+    (order_root / "version").mkdir(parents=True)
+    (order_root / "collate").mkdir(parents=True)
+    for name in ("part-10", "part-2", "part-100", "part-9", "part-1"):
+        (order_root / "version" / name).write_text("", encoding="utf-8")
+    collate_names = ["zebra", "éclair", "eclair", "Eclair", "apple", "Zulu", "ëlan", "elan"]
+    for name in collate_names:
+        (order_root / "collate" / name).write_text("", encoding="utf-8")
+
+    def verify_order(expected: list[str]):
+        def verify(out_path: Path, _: Path) -> Optional[str]:
+            lines = out_path.read_text(encoding="utf-8").splitlines()
+            if lines != expected:
+                return f"expected order {expected}, got {lines}"
+            return None
+        return verify
+
+    version_order = ["part-1", "part-2", "part-9", "part-10", "part-100"]
+    for suffix, args in (("", ("-v",)), ("-long-option", ("--sort", "version")),
+                         ("-memory-limit", ("-v", "--memory-limit", "1K"))):
+        add(f"version-order{suffix}", "-1", "--no-icons", "--no-color", *args,
+            str(order_root / "version"), verify=verify_order(version_order))
+    add("version-order-reverse", "-1", "-r", "-v", "--no-icons", "--no-color", str(order_root / "version"),
+        verify=verify_order(version_order[::-1]))
+
+    # Expected locale order comes from Python's strxfrm() under the same
+    # LC_COLLATE; a real language locale places accented names next to their
+    # base letter, C.UTF-8 orders by code point.
+    if os.name != "nt":
+        saved_collate = locale.setlocale(locale.LC_COLLATE)
+        collate_locale: Optional[str] = None
+        for candidate in ("en_US.UTF-8", "C.UTF-8"):
+            try:
+                locale.setlocale(locale.LC_COLLATE, candidate)
+            except locale.Error:
+                continue
+            collate_locale = candidate
+            locale_order = sorted(collate_names, key=locale.strxfrm)
+            break
+        locale.setlocale(locale.LC_COLLATE, saved_collate)
+        if collate_locale is None:
+            skip_case("collate-locale-order", "no UTF-8 locale available")
+        else:
+            collate_env = {"LC_ALL": collate_locale}
+            for suffix, extra in (("", ()), ("-memory-limit", ("--memory-limit", "1K"))):
+                add(f"collate-locale-order{suffix}", "-1", "--no-icons", "--no-color", "--collate", "locale", *extra,
+                    str(order_root / "collate"), case_env=collate_env, verify=verify_order(locale_order))
+
+    def verify_ascii_order(out_path: Path, _: Path) -> Optional[str]:
+        # Names equal once case-folded (Eclair, eclair) may come in either order.
+        lines = out_path.read_text(encoding="utf-8").splitlines()
+        keys = [line.encode("utf-8").lower() for line in lines]
+        if sorted(lines) != sorted(collate_names) or keys != sorted(keys):
+            return f"expected case-folded byte order, got {lines}"
+        return None
+
+    add("collate-ascii-order", "-1", "--no-icons", "--no-color", "--collate", "ascii",
+        str(order_root / "collate"), verify=verify_ascii_order)
+    add("memory-limit-single-column", "--memory-limit", "1K", "-1", str(root_dir))
+    add("memory-limit-long", "--memory-limit", "1K", "-l", "-r", str(root_dir))
+
+    # A tiny packing threshold turns every few entries into a packed run with
+    # front-coded names, merged again while printing.
+    packed_root = fixture_dir / "packed"
+    if packed_root.exists():
+        shutil.rmtree(packed_root)
+    packed_root.mkdir(parents=True)
+    packed_names = [f"part-{index:05d}.parquet" for index in range(300)]
+    packed_names += [f"Part-{index:03d}-upper.parquet" for index in range(0, 300, 7)] + ["a", "Z"]
+    for name in packed_names:
+        (packed_root / name).write_text("", encoding="utf-8")
+    packed_env = {"NLS_DEBUG_PACK_BYTES": "4096"}
+
+    def verify_packed_order(out_path: Path, _: Path) -> Optional[str]:
+        lines = out_path.read_text(encoding="utf-8").splitlines()
+        if sorted(lines) != sorted(packed_names):
+            return "packed listing lost or changed names"
+        keys = [line.encode("utf-8").lower() for line in lines]
+        if keys != sorted(keys):
+            return "packed listing is not in name order"
+        return None
+
+    add("packed-runs-single-column", "-1", "--no-icons", "--no-color", str(packed_root),
+        case_env=packed_env, verify=verify_packed_order)
+
+    # Packed runs and --memory-limit spills must print exactly what the
+    # in-memory sort prints; the first case of each group is the reference.
+    sorted_outputs: dict[str, str] = {}
+
+    def verify_same_as_in_memory(group: str):
+        def verify(out_path: Path, _: Path) -> Optional[str]:
+            output = out_path.read_text(encoding="utf-8", errors="replace")
+            reference = sorted_outputs.setdefault(group, output)
+            if output != reference:
+                return f"{group} listing differs from the in-memory sort"
+            return None
+        return verify
+
+    for group, sort_args in (("long", ("-l",)), ("long-reverse", ("-l", "-r")), ("version", ("-1", "-v"))):
+        add(f"external-sort-{group}-in-memory", *sort_args, str(packed_root),
+            verify=verify_same_as_in_memory(group))
+        add(f"external-sort-{group}-packed", *sort_args, str(packed_root),
+            case_env=packed_env, verify=verify_same_as_in_memory(group))
+        add(f"external-sort-{group}-memory-limit", "--memory-limit", "1K", *sort_args, str(packed_root),
+            verify=verify_same_as_in_memory(group))
     add("group-directories-first", "--group-directories-first", str(root_dir))
     add("sort-files-first", "--sort-files", str(root_dir))
     add("dots-first", "--dots-first", str(root_dir))
@@ -582,6 +933,24 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
     add("full-time", "--full-time", str(root_dir))
     add("hyperlink", "--hyperlink", str(root_dir))
 
+    def verify_hyperlinks(out_path: Path, _: Path) -> Optional[str]:
+        text = out_path.read_text(encoding="utf-8", errors="replace")
+        uris = [uri for uri in re.findall(r"\x1b\]8;;([^\x1b]*)\x1b\\", text) if uri]
+        if not uris:
+            return "no hyperlinks emitted"
+        for uri in uris:
+            if not uri.startswith("file://"):
+                return f"unexpected hyperlink target {uri!r}"
+            target = Path(urllib.parse.unquote(uri[len("file://"):]))
+            if platform.system() == "Windows" and target.as_posix().startswith("/"):
+                target = Path(target.as_posix()[1:])
+            if not os.path.lexists(target):
+                return f"hyperlink {uri!r} does not resolve to an existing path"
+        return None
+
+    add("hyperlink-recursive", "--hyperlink", "-R", "-a", str(root_dir), verify=verify_hyperlinks)
+    add("hyperlink-relative", "--hyperlink", "-a", ".", case_cwd=root_dir, verify=verify_hyperlinks)
+
     # Information options.
     add("inode", "-i", str(root_dir))
     add("no-owner", "-o", str(root_dir))
@@ -592,8 +961,479 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
     add("size", "--size", str(root_dir))
     add("block-size", "--block-size", "1K", str(root_dir))
     add("dereference", "-L", str(root_dir))
+    if root_dir.name == "lin":
+        add("dereference-recursive-links", "-R", "-L", "--no-icons", "-1", str(root_dir / "links"))
+    if os.name != "nt":
+        # cycle/a/back leads back to cycle, so -L -R has to notice the repeat.
+        # lnk/probe reads "../x" from inside real/target, which must not be
+        # confused with cycle/x next to lnk.
+        deref_root = fixture_dir / "deref"
+        if deref_root.exists():
+            shutil.rmtree(deref_root)
+        cycle_root = deref_root / "cycle"
+        (cycle_root / "a").mkdir(parents=True)
+        (cycle_root / "a" / "file.txt").write_text("file\n", encoding="utf-8")
+        (cycle_root / "a" / "back").symlink_to("..")
+        (cycle_root / "x").mkdir()
+        (cycle_root / "to-x").symlink_to("x")
+        (deref_root / "real" / "target").mkdir(parents=True)
+        (deref_root / "real" / "x").write_text("file\n", encoding="utf-8")
+        (deref_root / "real" / "target" / "probe").symlink_to(Path("..") / "x")
+        (cycle_root / "lnk").symlink_to(Path("..") / "real" / "target")
+
+        def verify_cycle(out_path: Path, err_path: Path) -> Optional[str]:
+            sections: dict[str, list[str]] = {}
+            current: Optional[list[str]] = None
+            for line in out_path.read_text(encoding="utf-8", errors="replace").splitlines():
+                if line.endswith(":"):
+                    header = line[:-1]
+                    if header in sections:
+                        return f"{header} listed twice"
+                    current = sections.setdefault(header, [])
+                elif line and current is not None:
+                    current.append(line)
+            real_dirs = [os.path.realpath(header) for header in sections]
+            if len(set(real_dirs)) != len(real_dirs):
+                return f"a directory was listed under two names: {sorted(sections)!r}"
+            if os.path.realpath(cycle_root / "a") not in real_dirs:
+                return "cycle/a was not listed"
+            if sections.get(str(cycle_root / "lnk")) != ["probe"]:
+                return f"lnk/probe should follow to the file real/x: {sections.get(str(cycle_root / 'lnk'))!r}"
+            if "back: not listing already-listed directory" not in err_path.read_text(encoding="utf-8",
+                                                                                      errors="replace"):
+                return "expected the a/back cycle to be reported"
+            return None
+
+        add("dereference-recursive-cycle", "-R", "-L", "--no-icons", "--no-color", "-1", str(cycle_root),
+            verify=verify_cycle, expected_returncode=1)
+    add("sniff", "--sniff", "-1", str(root_dir))
+
+    # Extensionless files that only their leading bytes identify.
+    sniff_root = fixture_dir / "sniff"
+    if sniff_root.exists():
+        shutil.rmtree(sniff_root)
+    sniff_root.mkdir(parents=True)
+    (sniff_root / "sniff-script").write_bytes(b"#!/bin/sh\necho hello\n")
+    (sniff_root / "sniff-python").write_bytes(b"#!/usr/bin/env python3\nprint('hello')\n")
+    (sniff_root / "sniff-binary").write_bytes(b"\x7fELF\x02\x01\x01" + b"\x00" * 57)
+    (sniff_root / "sniff-text").write_bytes(b"plain words\n")
+    sniffed_icons = {
+        "sniff-script": file_icons.get("sh"),
+        "sniff-python": file_icons.get("py"),
+        "sniff-binary": file_icons.get("elf") or file_icons.get("exe"),
+        "sniff-text": fallback_file_icon,
+    }
+
+    def make_sniff_verify(sniffed: bool) -> Callable[[Path, Path], Optional[str]]:
+        def _verify(out_path: Path, _: Path) -> Optional[str]:
+            lines = out_path.read_text(encoding="utf-8", errors="replace").splitlines()
+            for name, icon in sniffed_icons.items():
+                expected = f"{icon if sniffed else fallback_file_icon} {name}"
+                if expected not in lines:
+                    return f"expected '{expected}' in stdout"
+            return None
+
+        return _verify
+
+    add("sniff-classified", "--sniff", "-1", "--no-color", str(sniff_root), verify=make_sniff_verify(True))
+    add("sniff-off-unclassified", "-1", "--no-color", str(sniff_root), verify=make_sniff_verify(False))
+    dupes_root = fixture_dir / "dupes"
+    hash_home = fixture_dir / "hash-home"
+    for stale in (dupes_root, hash_home):
+        if stale.exists():
+            shutil.rmtree(stale)
+    dupes_root.mkdir(parents=True)
+    hash_home.mkdir(parents=True)
+    (dupes_root / "first.bin").write_bytes(b"same content\n")
+    (dupes_root / "second.bin").write_bytes(b"same content\n")
+    (dupes_root / "sized.bin").write_bytes(b"same length!\n")
+    (dupes_root / "unique.txt").write_bytes(b"unique\n")
+    hash_env = {"HOME": str(hash_home), "APPDATA": str(hash_home), "USERPROFILE": str(hash_home)}
+
+    def verify_dupes(out_path: Path, _: Path) -> Optional[str]:
+        text = out_path.read_text(encoding="utf-8", errors="replace")
+        for expected in ("first.bin", "second.bin"):
+            if expected not in text:
+                return f"expected '{expected}' in stdout"
+        for unexpected in ("sized.bin", "unique.txt"):
+            if unexpected in text:
+                return f"did not expect '{unexpected}' in stdout"
+        return None
+
+    # A digest recorded for an older version of first.bin must be dropped
+    # when the cache is rewritten, not kept next to the new one.
+    hash_cache_file = hash_home / ".nicels" / "cache" / "content-hashes"
+    first_stat = (dupes_root / "first.bin").stat()
+    if os.name != "nt":
+        hash_cache_file.parent.mkdir(parents=True)
+        hash_cache_file.write_text(f"xxh3 {first_stat.st_dev} {first_stat.st_ino} 1 1 0123456789abcdef\n",
+                                   encoding="utf-8")
+
+    def verify_hash_cache(out_path: Path, _: Path) -> Optional[str]:
+        if os.name == "nt":
+            return None
+        lines = hash_cache_file.read_text(encoding="utf-8").splitlines()
+        records = [line.split() for line in lines if line.startswith("xxh3 ")]
+        files = [(record[1], record[2]) for record in records]
+        if len(files) != len(set(files)):
+            return "content hash cache kept more than one digest per file"
+        first_id = (str(first_stat.st_dev), str(first_stat.st_ino))
+        first = [record for record in records if (record[1], record[2]) == first_id]
+        if len(first) != 1 or first[0][3] != str(first_stat.st_size):
+            return "content hash cache kept the stale digest of first.bin"
+        return None
+
+    for hash_opt in ("xxh3", "sha256"):
+        add(f"hash-{hash_opt}", "-l", "--hash", hash_opt, str(dupes_root), case_env=hash_env,
+            verify=verify_hash_cache)
+    add("dupes", "--dupes", "-1", "--no-icons", "--no-color", str(dupes_root), case_env=hash_env, verify=verify_dupes)
+    add("stat-timeout-long", "--stat-timeout", "5s", "-l", "-R", str(root_dir))
+    stalled_root = fixture_dir / "stalled"
+    if stalled_root.exists():
+        shutil.rmtree(stalled_root)
+    stalled_root.mkdir(parents=True)
+    for name in ("before.txt", "hung-mount", "after.txt"):
+        (stalled_root / name).write_text(f"{name}\n", encoding="utf-8")
+
+    def verify_stalled(out_path: Path, err_path: Path) -> Optional[str]:
+        if "hung-mount: metadata timed out" not in err_path.read_text(encoding="utf-8", errors="replace"):
+            return "expected a timeout diagnostic for hung-mount on stderr"
+        lines = {line.split()[-1]: line for line in out_path.read_text(encoding="utf-8", errors="replace").splitlines()
+                 if line.strip()}
+        if sorted(lines) != ["after.txt", "before.txt", "hung-mount"]:
+            return f"unexpected entries {sorted(lines)!r}"
+        if not lines["hung-mount"].startswith("??????????"):
+            return f"timed-out entry not shown as a placeholder: {lines['hung-mount']!r}"
+        for name in ("before.txt", "after.txt"):
+            if not lines[name].startswith("-rw"):
+                return f"responsive entry {name} lost its metadata: {lines[name]!r}"
+        return None
+
+    # The injected delay stands in for an NFS server that stopped answering.
+    add("stat-timeout-stalled", "--stat-timeout", "200ms", "-l", "--no-icons", "--no-color", str(stalled_root),
+        case_env={"NLS_DEBUG_STAT_DELAY": "hung-mount:3000"}, verify=verify_stalled, expected_returncode=1)
+
+    def verify_stalled_dirs_only(out_path: Path, err_path: Path) -> Optional[str]:
+        if "hung-mount: metadata timed out" not in err_path.read_text(encoding="utf-8", errors="replace"):
+            return "expected a timeout diagnostic for hung-mount on stderr"
+        listed = out_path.read_text(encoding="utf-8", errors="replace").split()
+        if listed:
+            return f"-d listed non-directories {listed!r}"
+        return None
+
+    # The placeholder is not known to be a directory, so -d drops it too.
+    add("stat-timeout-stalled-dirs-only", "--stat-timeout", "200ms", "-d", "-1", "--no-icons", "--no-color",
+        str(stalled_root), case_env={"NLS_DEBUG_STAT_DELAY": "hung-mount:3000"}, verify=verify_stalled_dirs_only,
+        expected_returncode=1)
+
+    stalled_tree_root = fixture_dir / "stalled-tree"
+    if stalled_tree_root.exists():
+        shutil.rmtree(stalled_tree_root)
+    for name in ("ok", "hung-mount"):
+        (stalled_tree_root / name).mkdir(parents=True)
+        (stalled_tree_root / name / f"inside-{name}.txt").write_text(f"{name}\n", encoding="utf-8")
+
+    def verify_stalled_tree(out_path: Path, err_path: Path) -> Optional[str]:
+        if "hung-mount: metadata timed out" not in err_path.read_text(encoding="utf-8", errors="replace"):
+            return "expected a timeout diagnostic for hung-mount on stderr"
+        output = out_path.read_text(encoding="utf-8", errors="replace")
+        if "inside-ok.txt" not in output:
+            return "-R did not descend into the responsive directory"
+        if "inside-hung-mount.txt" in output or "hung-mount:" in output:
+            return "-R descended into the directory that did not answer"
+        return None
+
+    # -R must not ask the stalled child again when deciding where to recurse.
+    add("stat-timeout-stalled-recursive", "--stat-timeout", "200ms", "-R", "-1", "--no-icons", "--no-color",
+        str(stalled_tree_root), case_env={"NLS_DEBUG_STAT_DELAY": "hung-mount:3000"}, verify=verify_stalled_tree,
+        expected_returncode=1)
+    if os.name != "nt":
+        stalled_link_root = fixture_dir / "stalled-link"
+        if stalled_link_root.exists():
+            shutil.rmtree(stalled_link_root)
+        stalled_link_root.mkdir(parents=True)
+        (stalled_link_root / "before.txt").write_text("before\n", encoding="utf-8")
+        (stalled_link_root / "hung-mount").write_text("hung\n", encoding="utf-8")
+        (stalled_link_root / "to-target").symlink_to("hung-mount")
+
+        def verify_stalled_link(out_path: Path, err_path: Path) -> Optional[str]:
+            if "to-target: metadata timed out" not in err_path.read_text(encoding="utf-8", errors="replace"):
+                return "expected a timeout diagnostic for the link into hung-mount"
+            lines = {line.split()[-1]: line
+                     for line in out_path.read_text(encoding="utf-8", errors="replace").splitlines() if line.strip()}
+            if "to-target" not in lines or not lines["to-target"].startswith("??????????"):
+                return f"link into the stalled entry not shown as a placeholder: {lines.get('to-target')!r}"
+            if not lines.get("before.txt", "").startswith("-rw"):
+                return f"responsive entry before.txt lost its metadata: {lines.get('before.txt')!r}"
+            return None
+
+        # The link itself answers; following it is what stalls.
+        for deref_args, suffix in (((), "long"), (("-L",), "dereference")):
+            add(f"stat-timeout-stalled-link-{suffix}", "--stat-timeout", "200ms", "-l", *deref_args, "--no-icons",
+                "--no-color", str(stalled_link_root), case_env={"NLS_DEBUG_STAT_DELAY": "hung-mount:3000"},
+                verify=verify_stalled_link, expected_returncode=1)
+    if sys.platform.startswith("linux"):
+        acl_root = fixture_dir / "acl"
+        if acl_root.exists():
+            shutil.rmtree(acl_root)
+        acl_root.mkdir(parents=True)
+        (acl_root / "plain.txt").write_text("plain\n", encoding="utf-8")
+        (acl_root / "with-acl.txt").write_text("acl\n", encoding="utf-8")
+        # Minimal POSIX ACL granting uid 1000 read access (version 2 header,
+        # then user::rw-, user:1000:r--, group::r--, mask::rw-, other::r--).
+        acl_entries = [(0x01, 6, 0xFFFFFFFF), (0x02, 4, 1000), (0x04, 4, 0xFFFFFFFF),
+                       (0x10, 6, 0xFFFFFFFF), (0x20, 4, 0xFFFFFFFF)]
+        acl_value = struct.pack("<I", 2) + b"".join(struct.pack("<HHI", *entry) for entry in acl_entries)
+        try:
+            os.setxattr(acl_root / "with-acl.txt", "system.posix_acl_access", acl_value)
+        except OSError:
+            acl_value = b""
+
+        def verify_acl(out_path: Path, _: Path) -> Optional[str]:
+            lines = out_path.read_text(encoding="utf-8", errors="replace").splitlines()
+            modes = {line.split()[-1]: line.split()[0] for line in lines if line.strip()}
+            if modes.get("with-acl.txt", "")[10:] != "+":
+                return f"expected '+' after the mode of with-acl.txt, got {modes.get('with-acl.txt')!r}"
+            if len(modes.get("plain.txt", "")) != 10:
+                return f"expected a bare mode for plain.txt, got {modes.get('plain.txt')!r}"
+            return None
+
+        if acl_value:
+            add("long-acl-indicator", "-l", "--no-icons", "--no-color", str(acl_root), verify=verify_acl)
     add("git-status", "--git-status", str(root_dir))
 
+    git_exe = shutil.which("git")
+    if git_exe:
+        diffstat_repo = fixture_dir / "diffstat_repo"
+        if diffstat_repo.exists():
+            shutil.rmtree(diffstat_repo)
+        diffstat_repo.mkdir(parents=True)
+        git_env = {**os.environ, "GIT_AUTHOR_NAME": "nls", "GIT_AUTHOR_EMAIL": "nls@example.invalid",
+                   "GIT_COMMITTER_NAME": "nls", "GIT_COMMITTER_EMAIL": "nls@example.invalid"}
+        (diffstat_repo / "changed.txt").write_text("one\ntwo\nthree\n", encoding="utf-8")
+        (diffstat_repo / "same.txt").write_text("same\n", encoding="utf-8")
+        for git_args in (["init", "-q"], ["add", "."], ["commit", "-q", "-m", "fixture"]):
+            subprocess.run([git_exe, *git_args], cwd=diffstat_repo, env=git_env, check=True,
+                           stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        (diffstat_repo / "changed.txt").write_text("one\nTWO\nthree\nfour\n", encoding="utf-8")
+
+        # Saving rewrites the cache, so a damaged line and a repeated record
+        # left by older versions disappear.
+        if os.name == "nt":
+            diffstat_cache = scratch_home / "AppData" / "nicels" / "cache" / "git-diffstats"
+        else:
+            diffstat_cache = scratch_home / ".nicels" / "cache" / "git-diffstats"
+        diffstat_cache.parent.mkdir(parents=True, exist_ok=True)
+        seeded_record = "0" * 40 + " " + "1" * 40 + " 1 1 0\n"
+        diffstat_cache.write_text("truncated\n" + seeded_record * 2, encoding="utf-8")
+
+        def verify_diffstat(out_path: Path, _: Path) -> Optional[str]:
+            text = out_path.read_text(encoding="utf-8", errors="replace")
+            lines = {line.split()[-1]: line for line in text.splitlines() if line.strip()}
+            changed = lines.get("changed.txt", "")
+            # Builds without libgit2 print no git columns at all.
+            if "M" not in changed:
+                return None
+            if "+2 -1" not in changed:
+                return f"expected '+2 -1' for changed.txt, got {changed!r}"
+            if "+" in lines.get("same.txt", ""):
+                return f"unexpected diffstat for same.txt: {lines.get('same.txt')!r}"
+            records = [line.split() for line in diffstat_cache.read_text(encoding="utf-8").splitlines()]
+            if any(len(record) != 5 for record in records):
+                return "diffstat cache kept a damaged line"
+            keys = [(record[0], record[1]) for record in records]
+            if len(keys) != len(set(keys)) or len(keys) < 2:
+                return f"expected each diffstat once in the cache, got {keys!r}"
+            return None
+
+        for run in ("cold", "cached"):
+            add(f"git-diffstat-{run}", "--git-diffstat", "-l", "--no-icons", "--no-color", str(diffstat_repo),
+                verify=verify_diffstat)
+
+        # Superproject with two submodules: one with an untracked file, one clean.
+        super_root = fixture_dir / "submodule_super"
+        if super_root.exists():
+            shutil.rmtree(super_root)
+        module_src = fixture_dir / "submodule_src"
+        if module_src.exists():
+            shutil.rmtree(module_src)
+        module_src.mkdir(parents=True)
+        super_root.mkdir(parents=True)
+        (module_src / "lib.txt").write_text("lib\n", encoding="utf-8")
+        (super_root / "top.txt").write_text("top\n", encoding="utf-8")
+        git_steps = [
+            (module_src, ["init", "-q"]),
+            (module_src, ["add", "."]),
+            (module_src, ["commit", "-q", "-m", "module"]),
+            (super_root, ["init", "-q"]),
+            (super_root, ["-c", "protocol.file.allow=always", "submodule", "add", "-q", str(module_src), "dirty"]),
+            (super_root, ["-c", "protocol.file.allow=always", "submodule", "add", "-q", str(module_src), "clean"]),
+            (super_root, ["add", "."]),
+            (super_root, ["commit", "-q", "-m", "super"]),
+        ]
+        try:
+            for git_cwd, git_args in git_steps:
+                subprocess.run([git_exe, *git_args], cwd=git_cwd, env=git_env, check=True,
+                               stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            (super_root / "dirty" / "scratch.txt").write_text("scratch\n", encoding="utf-8")
+        except subprocess.CalledProcessError:
+            super_root = None
+
+        def verify_submodules(out_path: Path, _: Path) -> Optional[str]:
+            text = out_path.read_text(encoding="utf-8", errors="replace")
+            lines = {line.split()[-1]: line for line in text.splitlines() if line.strip()}
+            # Builds without libgit2 print no git columns at all.
+            if "\u2713" not in text and "?" not in text:
+                return None
+            if "?" not in lines.get("dirty", ""):
+                return f"expected the untracked file inside 'dirty' to show, got {lines.get('dirty')!r}"
+            if "?" in lines.get("clean", "") or "M" in lines.get("clean", ""):
+                return f"expected 'clean' to have no changes, got {lines.get('clean')!r}"
+            return None
+
+        if super_root is not None:
+            for jobs in ("1", "4"):
+                add(f"git-submodules-jobs{jobs}", "--git-status", f"--git-jobs={jobs}", "-l", "--no-icons",
+                    "--no-color", str(super_root), verify=verify_submodules)
+
+        # outer/mid/leaf: an untracked file in the innermost submodule has to
+        # show on "mid" in the outermost listing.
+        nested_root = fixture_dir / "submodule_nested"
+        if nested_root.exists():
+            shutil.rmtree(nested_root)
+        nested_leaf = nested_root / "leaf"
+        nested_mid = nested_root / "mid"
+        nested_outer = nested_root / "outer"
+        for directory in (nested_leaf, nested_mid, nested_outer):
+            directory.mkdir(parents=True)
+            (directory / f"{directory.name}.txt").write_text(f"{directory.name}\n", encoding="utf-8")
+        allow_file = ["-c", "protocol.file.allow=always"]
+        nested_steps = [
+            (nested_leaf, ["init", "-q"]),
+            (nested_leaf, ["add", "."]),
+            (nested_leaf, ["commit", "-q", "-m", "leaf"]),
+            (nested_mid, ["init", "-q"]),
+            (nested_mid, [*allow_file, "submodule", "add", "-q", str(nested_leaf), "leaf"]),
+            (nested_mid, ["add", "."]),
+            (nested_mid, ["commit", "-q", "-m", "mid"]),
+            (nested_outer, ["init", "-q"]),
+            (nested_outer, [*allow_file, "submodule", "add", "-q", str(nested_mid), "mid"]),
+            (nested_outer, [*allow_file, "submodule", "update", "-q", "--init", "--recursive"]),
+            (nested_outer, ["add", "."]),
+            (nested_outer, ["commit", "-q", "-m", "outer"]),
+        ]
+        try:
+            for git_cwd, git_args in nested_steps:
+                subprocess.run([git_exe, *git_args], cwd=git_cwd, env=git_env, check=True,
+                               stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            (nested_outer / "mid" / "leaf" / "scratch.txt").write_text("scratch\n", encoding="utf-8")
+            nested_ready = True
+        except subprocess.CalledProcessError:
+            nested_ready = False
+
+        def verify_nested_submodules(out_path: Path, err_path: Path) -> Optional[str]:
+            # Builds without libgit2 never look for a repository.
+            if "git_status::discovery_" not in err_path.read_text(encoding="utf-8", errors="replace"):
+                return None
+            lines = {line.split()[-1]: line for line in out_path.read_text(encoding="utf-8", errors="replace")
+                     .splitlines() if line.strip()}
+            mid = lines.get("mid", "")
+            if len(mid.split()) < 2 or mid.split()[-2] != "?":
+                return f"expected the untracked file two submodules down to show on 'mid', got {mid!r}"
+            return None
+
+        if nested_ready:
+            add("git-submodules-nested", "--git-status", "-l", "--no-icons", "--no-color", "--perf-debug",
+                str(nested_outer), verify=verify_nested_submodules)
+
+        def verify_repository_switch(out_path: Path, err_path: Path) -> Optional[str]:
+            counters = dict(re.findall(r"^\s+(git_status::discovery_\w+): (\d+)$",
+                                       err_path.read_text(encoding="utf-8", errors="replace"), re.MULTILINE))
+            # Builds without libgit2 never look for a repository and print no
+            # git columns, so there is nothing to check.
+            if not counters:
+                return None
+            lines = out_path.read_text(encoding="utf-8", errors="replace").splitlines()
+            changed = [line.split()[-2] for line in lines if line.endswith(" changed.txt")]
+            if changed != ["M", "M"]:
+                return f"expected changed.txt to stay modified after switching repositories, got {changed!r}"
+            same = [line.split()[-2] for line in lines if line.endswith(" same.txt")]
+            if same != ["\u2713", "\u2713"]:
+                return f"expected same.txt to stay clean after switching repositories, got {same!r}"
+            if counters.get("git_status::discovery_walks") != "2" or "git_status::discovery_local" in counters:
+                return f"expected one discovery per repository, got {counters!r}"
+            return None
+
+        # Moving to another repository and back reuses the repositories
+        # opened before instead of discovering them again.
+        if super_root is not None:
+            add("git-status-repository-switch", "--git-status", "-l", "--no-icons", "--no-color", "--perf-debug",
+                str(diffstat_repo), str(module_src), str(diffstat_repo), verify=verify_repository_switch)
+
+        def verify_prompt_summary(out_path: Path, _: Path) -> Optional[str]:
+            pattern = re.compile(r"entries=(\d+) dirs=(\d+) files=(\d+) links=0 other=0 hidden=(\d+) "
+                                 r"size=(\d+) git=(\w+) path=(.+)")
+            summaries = {}
+            for line in out_path.read_text(encoding="utf-8", errors="replace").splitlines():
+                match = pattern.fullmatch(line)
+                if not match:
+                    return f"unexpected summary line {line!r}"
+                summaries[Path(match.group(7)).name] = match.groups()[:6]
+            # .git, changed.txt (modified, 19 bytes) and same.txt (5 bytes).
+            if summaries.get("diffstat_repo") != ("3", "1", "2", "1", "24", "dirty"):
+                return f"unexpected summary for diffstat_repo: {summaries.get('diffstat_repo')}"
+            if summaries.get("submodule_src") != ("2", "1", "1", "1", "4", "clean"):
+                return f"unexpected summary for submodule_src: {summaries.get('submodule_src')}"
+            return None
+
+        def verify_prompt_cache_hits(out_path: Path, err_path: Path) -> Optional[str]:
+            message = verify_prompt_summary(out_path, err_path)
+            if message:
+                return message
+            if "prompt_summary::cache_hits: 2" not in err_path.read_text(encoding="utf-8", errors="replace"):
+                return "expected both directories to be served from the cache"
+            return None
+
+        # The index check reports git=unknown on Windows.
+        if super_root is not None and os.name != "nt":
+            prompt_home = fixture_dir / "prompt_home"
+            if prompt_home.exists():
+                shutil.rmtree(prompt_home)
+            # Directories modified within the last two seconds are not cached.
+            settled = time.time() - 60
+            for directory in (diffstat_repo, module_src):
+                os.utime(directory, (settled, settled))
+            for name, mode in (("plain", "--prompt-summary"), ("cache-cold", "--prompt-cache")):
+                add(f"prompt-summary-{name}", mode, str(diffstat_repo), str(module_src),
+                    case_env={"HOME": str(prompt_home)}, verify=verify_prompt_summary)
+            add("prompt-summary-cache-warm", "--prompt-cache", "--perf-debug", str(diffstat_repo), str(module_src),
+                case_env={"HOME": str(prompt_home)}, verify=verify_prompt_cache_hits)
+
+    # The second run resolves its search directories from the cache the first
+    # one wrote and must list exactly the same thing.
+    env_home = fixture_dir / "env_home"
+    if env_home.exists():
+        shutil.rmtree(env_home)
+    env_home.mkdir(parents=True)
+    env_cache_env = {"HOME": str(env_home), "NLS_ENV_CACHE": "1"}
+    if os.name == "nt":
+        env_cache_env["APPDATA"] = str(env_home / "AppData")
+        env_cache_file = env_home / "AppData" / "nicels" / "cache" / "environment"
+    else:
+        env_cache_file = env_home / ".nicels" / "cache" / "environment"
+    env_cache_outputs: list[str] = []
+
+    def verify_env_cache(out_path: Path, _: Path) -> Optional[str]:
+        if not env_cache_file.is_file():
+            return f"expected {env_cache_file} to be written"
+        env_cache_outputs.append(out_path.read_text(encoding="utf-8", errors="replace"))
+        if len(env_cache_outputs) == 2 and env_cache_outputs[0] != env_cache_outputs[1]:
+            return "listing changed once the environment cache was used"
+        return None
+
+    for name in ("cold", "warm"):
+        add(f"env-cache-{name}", "-l", str(root_dir), case_env=env_cache_env, verify=verify_env_cache)
+
     if os.name == "nt":
         special_root = root_dir / "windows_specials"
         special_root.mkdir(parents=True, exist_ok=True)
@@ -773,6 +1613,15 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
         case_env=db_env,
         verify=expect_in_stdout("(no entries)"),
     )
+    add(
+        "db-show-files-search",
+        "db",
+        "--show-files",
+        "--search",
+        "fixture",
+        case_env=db_env,
+        verify=expect_in_stdout(set_ext),
+    )
     add(
         "db-show-folders",
         "db",
@@ -874,12 +1723,43 @@ def build_cases(fixture_dir: Path, root_dir: Path) -> list[TestCase]:
     return cases
 
 
+def run_closed_stdout_case(cmd: list[str], case: TestCase) -> Optional[str]:
+    read_end, write_end = os.pipe()
+    os.close(read_end)
+    try:
+        # The default SIGPIPE disposition is restored in the child, so nls
+        # should stop at its first write and die of the signal, silently.
+        result = subprocess.run(
+            cmd,
+            cwd=case.cwd,
+            env=case.env,
+            stdout=write_end,
+            stderr=subprocess.PIPE,
+            text=True,
+            encoding="utf-8",
+            errors="replace",
+            timeout=60,
+        )
+    finally:
+        os.close(write_end)
+    if result.returncode != -signal.SIGPIPE:
+        return f"exited with {result.returncode} instead of SIGPIPE on a closed pipe"
+    if result.stderr:
+        return f"wrote to stderr on a closed pipe: {result.stderr!r}"
+    return None
+
+
 def run_cases(binary: Path, cases: list[TestCase], log_dir: Path) -> None:
     failures: list[str] = []
     for index, case in enumerate(cases, start=1):
         cmd = [str(binary), *case.args]
         step_label = f"[{index}/{len(cases)}] {case.name}"
         print(f"{step_label}: {' '.join(case.args)}")
+        if case.closed_stdout:
+            failure = run_closed_stdout_case(cmd, case)
+            if failure:
+                failures.append(f"{step_label} {failure}")
+            continue
         result = subprocess.run(
             cmd,
             cwd=case.cwd,
@@ -895,7 +1775,7 @@ def run_cases(binary: Path, cases: list[TestCase], log_dir: Path) -> None:
         out_file.write_text(result.stdout, encoding="utf-8", errors="replace")
         err_file.write_text(result.stderr, encoding="utf-8", errors="replace")
 
-        if result.returncode != 0:
+        if result.returncode != case.expected_returncode:
             failures.append(
                 f"{step_label} failed with exit code {result.returncode} "
                 f"(stdout: {out_file}, stderr: {err_file})",
@@ -0,0 +1,558 @@
+#!/usr/bin/env python3
+"""Micro-benchmarks for hot paths in the nls CLI.
+
+Each scenario materialises a synthetic directory (cached between runs under
+``--workdir``), runs the binary with ``--perf-debug`` for every variant being
+compared and prints the best wall-clock time together with the perf timers
+the binary reported on stderr and, where the platform reports it, the peak
+resident set size.
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import random
+import re
+import signal
+import sqlite3
+import subprocess
+import sys
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Callable, Dict, Iterable, List, Sequence
+
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+PERF_TIMER_RE = re.compile(r"^\s+(?P<label>.+?): total=(?P<total>[0-9.]+)")
+PERF_COUNTER_RE = re.compile(r"^\s+(?P<label>\S+): (?P<value>[0-9.]+)$")
+
+
+@dataclass
+class Variant:
+    label: str
+    args: List[str]
+    env: Dict[str, str] | None = None
+    # Standard output is a pipe whose reader already exited; "ignore" also
+    # starts nls with SIGPIPE ignored, as some service managers do.
+    closed_stdout: str | None = None
+
+
+@dataclass
+class Run:
+    wall: float
+    timers: Dict[str, float]
+    counters: Dict[str, float]
+    # Peak resident set size in bytes, or None where os.wait4 is missing.
+    peak_rss: int | None
+
+
+@dataclass
+class Scenario:
+    description: str
+    default_count: int
+    build: Callable[[Path, int, random.Random], None]
+    variants: Callable[[Path], Sequence[Variant]]
+    # Extra lines derived from the best run, e.g. a throughput.
+    summary: Callable[[Run], Iterable[str]] | None = None
+
+
+def _populate(directory: Path, names: Iterable[str]) -> None:
+    directory.mkdir(parents=True, exist_ok=True)
+    for name in names:
+        fd = os.open(directory / name, os.O_CREAT | os.O_WRONLY, 0o644)
+        os.close(fd)
+
+
+def _collation_names(count: int, rng: random.Random) -> Iterable[str]:
+    stems = ["alpha", "Beta", "cafe", "café", "Ärger", "zebra", "Øre", "éclair", "naïve", "Straße"]
+    for index in range(count):
+        stem = stems[index % len(stems)]
+        yield f"{stem}_{rng.randrange(1 << 30):08x}_{index}"
+
+
+def _build_collate(directory: Path, count: int, rng: random.Random) -> None:
+    _populate(directory, _collation_names(count, rng))
+
+
+def _collate_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-1", "--no-icons", "--color=never", str(directory)]
+    utf8 = {"LC_ALL": "en_US.UTF-8"}
+    return [
+        Variant("ascii", base, utf8),
+        Variant("locale", ["--collate=locale", *base], utf8),
+    ]
+
+
+def _build_version(directory: Path, count: int, rng: random.Random) -> None:
+    prefixes = ["part", "shard", "release-v", "chunk_"]
+    names = (
+        f"{prefixes[index % len(prefixes)]}-{rng.randrange(count)}.{index % 97}-{index}"
+        for index in range(count)
+    )
+    _populate(directory, names)
+
+
+def _version_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-1", "--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("name", base),
+        Variant("version", ["-v", *base]),
+    ]
+
+
+def _build_columns(directory: Path, count: int, rng: random.Random) -> None:
+    # Mostly short names with an occasional long one, which used to collapse
+    # the whole grid to a single column.
+    names = (
+        f"{'x' * rng.randrange(4, 20)}-{index}" if index % 5000 else f"{'long-name-' * 4}{index}"
+        for index in range(count)
+    )
+    _populate(directory, names)
+
+
+def _columns_variants(directory: Path) -> Sequence[Variant]:
+    base = ["--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("one-per-line", ["-1", *base]),
+        Variant("vertical-w80", ["-C", "-w", "80", *base]),
+        Variant("vertical-w400", ["-C", "-w", "400", *base]),
+        Variant("across-w400", ["-x", "-w", "400", *base]),
+    ]
+
+
+def _build_progress(directory: Path, count: int, rng: random.Random) -> None:
+    # A few hundred directories so the scanner publishes many directory changes.
+    per_dir = 1000
+    for index in range(0, count, per_dir):
+        subdir = directory / f"d{index // per_dir:04d}" / f"sub{rng.randrange(8)}"
+        _populate(subdir, (f"f{n:05d}" for n in range(min(per_dir, count - index))))
+
+
+def _progress_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-R", "--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("recursive", base),
+        Variant("progress", ["--progress", *base]),
+        Variant("checkpoint", [f"--checkpoint={directory.parent / (directory.name + '.checkpoint')}", *base]),
+    ]
+
+
+def _background_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-R", "--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("recursive", base),
+        Variant("background", ["--background", *base]),
+        Variant("ops-100k", ["--max-ops-per-sec=100000", *base]),
+    ]
+
+
+def _pipe_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-R", "--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("recursive", base),
+        Variant("closed-pipe", base, closed_stdout="default"),
+        Variant("closed-ignored", base, closed_stdout="ignore"),
+    ]
+
+
+def _build_startup(directory: Path, count: int, rng: random.Random) -> None:
+    _populate(directory, (f"file{index:03d}.txt" for index in range(count)))
+
+
+def _startup_variants(directory: Path) -> Sequence[Variant]:
+    # A listing this small is all start-up: loading and relocating the
+    # executable, option parsing, path resolution, theme and icon loading.
+    # --version stops right after parsing; --gs adds libgit2's initialisation.
+    base = ["-1", str(directory)]
+    return [
+        Variant("version", ["--version"]),
+        Variant("env-cache-off", base),
+        Variant("env-cache", base, {"NLS_ENV_CACHE": "1"}),
+        Variant("git-status", ["--gs", *base]),
+    ]
+
+
+def _build_hyperlink(directory: Path, count: int, rng: random.Random) -> None:
+    stems = ["report", "photo 2024", "notes#draft", "résumé", "data_set"]
+    _populate(directory, (f"{stems[index % len(stems)]}-{index:07d}.txt" for index in range(count)))
+
+
+def _hyperlink_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-1", "--no-icons", "--color=never", str(directory)]
+    return [
+        Variant("plain", base),
+        Variant("hyperlink", ["--hyperlink", *base]),
+    ]
+
+
+_SNIFF_HEADS = [
+    b"\x7fELF\x02\x01\x01" + b"\0" * 9,
+    b"#!/usr/bin/env python3\nprint('hi')\n",
+    b"#!/bin/sh\nexit 0\n",
+    b"\x1f\x8b\x08\x00",
+    b"\x89PNG\r\n\x1a\n",
+    b"%PDF-1.7\n",
+    b"SQLite format 3\x00",
+    b"plain text without any signature\n",
+]
+
+
+def _build_sniff(directory: Path, count: int, rng: random.Random) -> None:
+    directory.mkdir(parents=True, exist_ok=True)
+    for index in range(count):
+        head = _SNIFF_HEADS[rng.randrange(len(_SNIFF_HEADS))]
+        (directory / f"blob{index:07d}").write_bytes(head)
+
+
+def _sniff_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-1", "--color=never", str(directory)]
+    return [
+        Variant("names-only", base),
+        Variant("sniff", ["--sniff", *base]),
+    ]
+
+
+def _build_hash(directory: Path, count: int, rng: random.Random) -> None:
+    directory.mkdir(parents=True, exist_ok=True)
+    block = rng.randbytes(1 << 20)
+    for index in range(count):
+        # Every file has the same size; a quarter of them share content.
+        payload = block if index % 4 == 0 else rng.randbytes(len(block))
+        (directory / f"file{index:05d}.bin").write_bytes(payload)
+
+
+def _hash_variants(directory: Path) -> Sequence[Variant]:
+    base = ["-l", "--no-icons", "--color=never", str(directory)]
+    # An unwritable HOME keeps the digest cache from persisting between runs.
+    cold = {"HOME": "/nonexistent/nls-bench"}
+    warm = {"HOME": str(directory.parent / f"{directory.name}-home")}
+    return [
+        Variant("no-hash", base),
+        Variant("xxh3-cold", ["--hash=xxh3", *base], cold),
+        Variant("sha256-cold", ["--hash=sha256", *base], cold),
+        Variant("xxh3-cached", ["--hash=xxh3", *base], warm),
+        Variant("dupes-cold", ["--dupes", *base], cold),
+    ]
+
+
+def _build_prompt(directory: Path, count: int, rng: random.Random) -> None:
+    directory.mkdir(parents=True, exist_ok=True)
+    for index in range(count):
+        name = f".hidden{index:07d}" if index % 10 == 0 else f"file{index:07d}.txt"
+        (directory / name).write_bytes(b"x" * rng.randrange(64))
+    git = ["git", "-c", "user.name=bench", "-c", "user.email=bench@example.invalid"]
+    for args in (["init", "-q"], ["add", "."], ["commit", "-q", "-m", "bench"]):
+        subprocess.run([*git, *args], cwd=directory, check=True)
+    # Backdate the directory so --prompt-cache may store its counts.
+    old = time.time() - 60
+    os.utime(directory, (old, old))
+
+
+def _prompt_variants(directory: Path) -> Sequence[Variant]:
+    home = {"HOME": str(directory.parent / f"{directory.name}-home")}
+    return [
+        Variant("long-report", ["-l", "--gs", "--report=short", "--no-icons", "--color=never", str(directory)]),
+        Variant("summary", ["--prompt-summary", str(directory)]),
+        Variant("summary-cached", ["--prompt-cache", str(directory)], home),
+    ]
+
+
+def _build_db(directory: Path, count: int, rng: random.Random) -> None:
+    directory.mkdir(parents=True, exist_ok=True)
+    schema = (REPO_ROOT / "DB" / "NLS_sqlite_schema.sql").read_text(encoding="utf-8")
+    conn = sqlite3.connect(directory / "NLS.sqlite3")
+    conn.executescript(schema)
+    words = ["archive", "image", "project", "script", "document", "scene", "binary", "config"]
+    conn.executemany(
+        "INSERT INTO Files(id, name, description, used_by, icon, icon_class_name) VALUES (?, ?, ?, ?, ?, ?)",
+        (
+            (
+                index,
+                f"ext{index:07d}",
+                f"{rng.choice(words)} {rng.choice(words)} format {index}",
+                "bench",
+                "x",
+                "nf-fa-file_o",
+            )
+            for index in range(count)
+        ),
+    )
+    conn.execute("INSERT INTO Files_fts(Files_fts) VALUES ('rebuild')")
+    conn.commit()
+    conn.close()
+
+
+def _db_variants(directory: Path) -> Sequence[Variant]:
+    env = {"NLS_DATA_DIR": str(directory)}
+    return [
+        Variant("exact", ["db", "--show-files", "--name", "ext0012345"], env),
+        Variant("prefix", ["db", "--show-files", "--name", "ext00123*"], env),
+        Variant("search", ["db", "--show-files", "--search", "scene archive"], env),
+        Variant("all", ["db", "--show-files"], env),
+    ]
+
+
+def _build_packed(directory: Path, count: int, rng: random.Random) -> None:
+    # Generated data sets: neighbours in sorted order share most of the name.
+    def names() -> Iterable[str]:
+        for index in range(count):
+            if index % 2:
+                yield f"part-{index:09d}-c000.snappy.parquet"
+            else:
+                yield f"sha256-{rng.getrandbits(64):016x}{index:08x}"
+
+    _populate(directory, names())
+
+
+def _packed_variants(directory: Path) -> Sequence[Variant]:
+    base = ["--no-icons", "--color=never", str(directory)]
+    # An unreachable threshold keeps every entry as an Entry object.
+    unpacked = {"NLS_DEBUG_PACK_BYTES": str(1 << 62)}
+    return [
+        Variant("entries", ["-1", *base], unpacked),
+        Variant("packed", ["-1", *base]),
+        Variant("long-entries", ["-l", *base], unpacked),
+        Variant("long-packed", ["-l", *base]),
+        Variant("spill-64M", ["-1", "--memory-limit=64M", *base]),
+    ]
+
+
+def _packed_summary(run: Run) -> Iterable[str]:
+    entries = run.counters.get("external_sort::packed::entries")
+    merge = run.timers.get("external_sort::merge")
+    if not entries or merge is None:
+        return
+    # The merge timer includes printing each batch; what remains is decoding
+    # the packed runs and the k-way merge itself.
+    decode = max(merge - run.timers.get("renderer::RenderStreamBatch", 0.0), 1e-3)
+    yield f"decode+merge: {entries / decode / 1000.0:.2f} M entries/s"
+
+
+SCENARIOS: Dict[str, Scenario] = {
+    "collate": Scenario(
+        "byte-wise name sort versus --collate=locale (strxfrm keys)",
+        1_000_000,
+        _build_collate,
+        _collate_variants,
+    ),
+    "version": Scenario(
+        "name sort versus -v on numbered shard names (segment keys)",
+        1_000_000,
+        _build_version,
+        _version_variants,
+    ),
+    "columns": Scenario(
+        "-C/-x variable-width column fitting (renderer::column_layout) versus -1",
+        1_000_000,
+        _build_columns,
+        _columns_variants,
+    ),
+    "progress": Scenario(
+        "-R over a deep tree with and without --progress or --checkpoint (overhead)",
+        500_000,
+        _build_progress,
+        _progress_variants,
+    ),
+    "background": Scenario(
+        "-R with --background and a --max-ops-per-sec budget (pacing accuracy)",
+        200_000,
+        _build_progress,
+        _background_variants,
+    ),
+    "pipe": Scenario(
+        "-R into a pipe whose reader has exited (cancellation latency)",
+        200_000,
+        _build_progress,
+        _pipe_variants,
+    ),
+    "startup": Scenario(
+        "start-up cost of listing a tiny directory (compare build profiles with --compare)",
+        10,
+        _build_startup,
+        _startup_variants,
+    ),
+    "hyperlink": Scenario(
+        "plain names versus --hyperlink (per-directory URI prefix)",
+        1_000_000,
+        _build_hyperlink,
+        _hyperlink_variants,
+    ),
+    "sniff": Scenario(
+        "extensionless files with and without --sniff (magic-byte icons)",
+        10_000,
+        _build_sniff,
+        _sniff_variants,
+    ),
+    "hash": Scenario(
+        "--hash=xxh3|sha256 over 1 MiB files, cold and with the digest cache",
+        1_000,
+        _build_hash,
+        _hash_variants,
+    ),
+    "prompt": Scenario(
+        "-l --gs --report=short versus --prompt-summary and --prompt-cache in a git work tree",
+        100_000,
+        _build_prompt,
+        _prompt_variants,
+    ),
+    "db": Scenario(
+        "nls db --show-files lookups against a large icon database",
+        500_000,
+        _build_db,
+        _db_variants,
+    ),
+    "packed": Scenario(
+        "one huge directory as Entry objects versus packed front-coded runs (memory per entry, decode rate)",
+        2_000_000,
+        _build_packed,
+        _packed_variants,
+        _packed_summary,
+    ),
+}
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("scenario", choices=sorted(SCENARIOS), help="Benchmark scenario to run")
+    parser.add_argument(
+        "--binary",
+        default="build/nls",
+        help="Path to the nls executable under test (default: build/nls)",
+    )
+    parser.add_argument(
+        "--compare",
+        action="append",
+        default=[],
+        metavar="[LABEL=]PATH",
+        help="Also run every variant with this executable, e.g. a linux-clang-static build (repeatable)",
+    )
+    parser.add_argument("--count", type=int, help="Number of entries to generate")
+    parser.add_argument("--runs", type=int, default=3, help="Repetitions per variant (default: 3)")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed for generated names")
+    parser.add_argument(
+        "--workdir",
+        type=Path,
+        default=REPO_ROOT / "build" / "bench",
+        help="Directory that caches generated trees (default: build/bench)",
+    )
+    return parser.parse_args()
+
+
+def _profile_label(binary: Path) -> str:
+    # build/<preset>/<config>/nls is labelled by its preset.
+    parent = binary.resolve().parent
+    if parent.name in ("Debug", "Release", "RelWithDebInfo", "MinSizeRel"):
+        parent = parent.parent
+    return parent.name
+
+
+def _binaries(args: argparse.Namespace) -> List[tuple[str, Path]]:
+    binaries = [(_profile_label(Path(args.binary)), Path(args.binary))]
+    for spec in args.compare:
+        label, sep, path = spec.partition("=")
+        binary = Path(path if sep else spec)
+        binaries.append((label if sep else _profile_label(binary), binary))
+    return binaries
+
+
+def _run_once(command: List[str], env: Dict[str, str], stdout, preexec) -> tuple[int, str, int | None]:
+    process = subprocess.Popen(
+        command,
+        env=env,
+        stdout=stdout,
+        stderr=subprocess.PIPE,
+        text=True,
+        preexec_fn=preexec,
+    )
+    if not hasattr(os, "wait4"):
+        _, stderr = process.communicate()
+        return process.returncode, stderr, None
+    stderr = process.stderr.read()
+    process.stderr.close()
+    _, status, usage = os.wait4(process.pid, 0)
+    process.returncode = os.waitstatus_to_exitcode(status)
+    # ru_maxrss is in kilobytes on Linux and in bytes on macOS.
+    scale = 1 if sys.platform == "darwin" else 1024
+    return process.returncode, stderr, usage.ru_maxrss * scale
+
+
+def run_variant(binary: Path, variant: Variant, runs: int) -> Run:
+    env = os.environ.copy()
+    env.setdefault("NLS_THEME", "dark")
+    if variant.env:
+        env.update(variant.env)
+    best = Run(float("inf"), {}, {}, None)
+    accepted = (0, 1)
+    if variant.closed_stdout == "default":
+        accepted = (-signal.SIGPIPE,)
+    elif variant.closed_stdout == "ignore":
+        accepted = (2,)
+    for _ in range(max(1, runs)):
+        stdout = subprocess.DEVNULL
+        if variant.closed_stdout:
+            read_end, stdout = os.pipe()
+            os.close(read_end)
+        preexec = None
+        if variant.closed_stdout == "ignore":
+            preexec = lambda: signal.signal(signal.SIGPIPE, signal.SIG_IGN)  # noqa: E731
+        start = time.perf_counter()
+        try:
+            returncode, stderr, peak_rss = _run_once(
+                [str(binary), "--perf-debug", *variant.args], env, stdout, preexec
+            )
+        finally:
+            if variant.closed_stdout:
+                os.close(stdout)
+        elapsed = time.perf_counter() - start
+        if returncode not in accepted:
+            raise RuntimeError(f"{variant.label}: nls exited with {returncode}\n{stderr}")
+        if elapsed < best.wall:
+            best = Run(elapsed, {}, {}, peak_rss)
+            for line in stderr.splitlines():
+                match = PERF_TIMER_RE.match(line)
+                if match:
+                    best.timers[match.group("label").strip()] = float(match.group("total"))
+                    continue
+                match = PERF_COUNTER_RE.match(line)
+                if match:
+                    best.counters[match.group("label")] = float(match.group("value"))
+    return best
+
+
+def main() -> int:
+    args = parse_args()
+    scenario = SCENARIOS[args.scenario]
+    count = args.count or scenario.default_count
+    binaries = _binaries(args)
+    for _, binary in binaries:
+        if not binary.exists():
+            print(f"nls binary not found at {binary}", file=sys.stderr)
+            return 1
+
+    directory = args.workdir / f"{args.scenario}-{count}-{args.seed}"
+    if not directory.exists():
+        print(f"Generating {count} entries in {directory} ...", file=sys.stderr)
+        scenario.build(directory, count, random.Random(args.seed))
+
+    print(f"{args.scenario}: {scenario.description} ({count} entries, best of {args.runs})")
+    width = 16 if len(binaries) == 1 else 36
+    for variant in scenario.variants(directory):
+        for profile, binary in binaries:
+            run = run_variant(binary, variant, args.runs)
+            label = variant.label if len(binaries) == 1 else f"{variant.label} [{profile}]"
+            line = f"  {label:<{width}} wall={run.wall * 1000.0:10.1f} ms"
+            if run.peak_rss is not None:
+                line += f"  rss={run.peak_rss / (1 << 20):8.1f} MiB ({run.peak_rss / count:.0f} B/entry)"
+            print(line)
+            for timer in sorted(run.timers):
+                print(f"    {timer}: {run.timers[timer]:.3f} ms")
+            if scenario.summary:
+                for extra in scenario.summary(run):
+                    print(f"    {extra}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())